@@ -0,0 +1,193 @@
+#include "change_tracker.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+
+namespace {
+
+  uint64_t fnv1a(const void* data, size_t len) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < len; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+  }
+
+  /// @brief splitmix64 finalizer, spreads every input bit over the result, so sums of fingerprints don't cancel
+  uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  /// @brief volume in whole percent, so a volume the board set reads back the same
+  uint8_t quantize(float volume) {
+    return static_cast<uint8_t>(std::lround(std::clamp(volume, 0.f, 100.f)));
+  }
+
+}  // namespace
+
+
+uint64_t ChangeTracker::fingerprint(Key key, uint64_t name_hash, uint8_t volume, bool muted) {
+  const uint64_t state = (static_cast<uint64_t>(static_cast<uint16_t>(key.first)) << 16) |
+                         (static_cast<uint64_t>(key.second) << 8) | (volume << 1) | muted;
+  return mix(name_hash ^ mix(state));
+}
+
+ChangeTracker::State ChangeTracker::make_state(const VolumeControl::SessionSnapshot& sessions, size_t i) {
+  const std::wstring& filename = sessions.filename(i);
+  State state{};
+  state.name_hash_ = fnv1a(filename.data(), filename.size() * sizeof(wchar_t));
+  state.volume_ = quantize(sessions.volume(i));
+  state.muted_ = sessions.muted(i);
+  state.count_ = 1;
+  state.fingerprint_ =
+      fingerprint({ sessions.pids()[i], sessions.endpoint(i) }, state.name_hash_, state.volume_, state.muted_);
+  return state;
+}
+
+void ChangeTracker::reset() {
+  sessions_.clear();
+  digest_ = 0;
+  valid_ = false;
+}
+
+void ChangeTracker::update(const VolumeControl::SessionSnapshot& sessions) {
+  if (seen_generation_ != 0 && sessions.generation() == seen_generation_) {
+    return;
+  }
+
+  // both are sorted by pid and endpoint, a session keeps its generation as long as it doesn't change
+  std::vector<Seen> seen;
+  seen.reserve(sessions.size());
+  seen_digest_ = 0;
+  size_t j = 0;
+  for (size_t i = 0; i < sessions.size();) {
+    // the sessions of a key are adjacent. A new, changed or removed one changes the count or the newest generation
+    const Key key{ sessions.pids()[i], sessions.endpoint(i) };
+    size_t end = i + 1;
+    uint64_t generation = sessions.generation(i);
+    while (end < sessions.size() && Key{ sessions.pids()[end], sessions.endpoint(end) } == key) {
+      generation = std::max(generation, sessions.generation(end++));
+    }
+    while (j < seen_.size() && seen_[j].key_ < key) {
+      ++j;
+    }
+    const bool same = j < seen_.size() && seen_[j].key_ == key && seen_[j].generation_ == generation &&
+                      seen_[j].state_.count_ == end - i;
+    State state;
+    if (same) {
+      state = seen_[j].state_;
+    } else {
+      state = make_state(sessions, i);
+      for (size_t k = i + 1; k < end; ++k) {
+        state.fingerprint_ += make_state(sessions, k).fingerprint_;
+        ++state.count_;
+      }
+    }
+    seen.push_back({ key, generation, state });
+    seen_digest_ += state.fingerprint_;
+    i = end;
+  }
+  seen_ = std::move(seen);
+  seen_generation_ = sessions.generation();
+}
+
+void ChangeTracker::acknowledge(const VolumeControl::SessionSnapshot& sessions) {
+  update(sessions);
+  sessions_.clear();
+  digest_ = 0;
+  for (const auto& session : seen_) {
+    sessions_.emplace_hint(sessions_.end(), session.key_, session.state_);
+    digest_ += session.state_.fingerprint_;
+  }
+  valid_ = true;
+}
+
+void ChangeTracker::refresh(Key key, State& state) {
+  digest_ -= state.fingerprint_;
+  state.fingerprint_ = state.count_ * fingerprint(key, state.name_hash_, state.volume_, state.muted_);
+  digest_ += state.fingerprint_;
+}
+
+void ChangeTracker::set_volume(int16_t pid, float volume) {
+  for (auto it = sessions_.lower_bound({ pid, 0 }); it != sessions_.end() && it->first.first == pid; ++it) {
+    it->second.volume_ = quantize(volume);
+    refresh(it->first, it->second);
+  }
+}
+
+void ChangeTracker::set_muted(int16_t pid, bool muted) {
+  for (auto it = sessions_.lower_bound({ pid, 0 }); it != sessions_.end() && it->first.first == pid; ++it) {
+    it->second.muted_ = muted;
+    refresh(it->first, it->second);
+  }
+}
+
+bool ChangeTracker::changed(const VolumeControl::SessionSnapshot& sessions) {
+  if (not valid_) {
+    return true;
+  }
+  update(sessions);
+  return seen_.size() != sessions_.size() || seen_digest_ != digest_;
+}
+
+std::vector<ChangeTracker::Entry> ChangeTracker::diff(const VolumeControl::SessionSnapshot& sessions) {
+  update(sessions);
+  std::vector<Entry> ret;
+  size_t matched = 0;
+  for (const auto& session : seen_) {
+    const auto it = sessions_.find(session.key_);
+    const auto pid = static_cast<int16_t>(session.key_.first);
+    if (it == sessions_.end()) {
+      ret.push_back({ pid, session.key_.second, Change::ADDED });
+      continue;
+    }
+    ++matched;
+    if (session.state_.fingerprint_ != it->second.fingerprint_) {
+      ret.push_back({ pid, session.key_.second, Change::MODIFIED });
+    }
+  }
+
+  if (matched != sessions_.size()) {
+    // look up the gone sessions only when there are any
+    std::set<Key> current;
+    for (const auto& session : seen_) {
+      current.insert(session.key_);
+    }
+    for (const auto& [key, state] : sessions_) {
+      if (current.count(key) == 0) {
+        ret.push_back({ static_cast<int16_t>(key.first), key.second, Change::REMOVED });
+      }
+    }
+  }
+  return ret;
+}
+
+std::vector<ChangeTracker::Entry> ChangeTracker::diff_pids(const VolumeControl::SessionSnapshot& sessions) {
+  const auto changes = diff(sessions);
+  std::vector<Entry> ret;
+  if (changes.empty()) {
+    return ret;
+  }
+
+  std::set<int16_t> current;
+  for (const auto& session : seen_) {
+    current.insert(static_cast<int16_t>(session.key_.first));
+  }
+  std::set<int16_t> reported;
+  for (const auto& change : changes) {
+    if (not reported.insert(change.pid_).second) {
+      continue;
+    }
+    const auto it = sessions_.lower_bound({ change.pid_, 0 });
+    const bool acknowledged = it != sessions_.end() && it->first.first == change.pid_;
+    const Change kind = not acknowledged                   ? Change::ADDED
+                        : current.count(change.pid_) == 0 ? Change::REMOVED
+                                                          : Change::MODIFIED;
+    ret.push_back({ change.pid_, change.endpoint_, kind });
+  }
+  return ret;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+
+/// @brief Tracks the session list the board last acknowledged, to tell what changed since.
+///
+/// Each session has a 64 bit fingerprint of its pid, device, name, volume and mute state. The digest of the list is
+/// the sum of the fingerprints, so it doesn't depend on the order of the sessions, and a change the PC makes itself,
+/// like a volume set by the board, updates it in O(1). Sessions are keyed by their pid as sent to the board and their
+/// device, a process can play on several devices. Several sessions of a process on one device count as one, with
+/// the sum of their fingerprints.
+///
+/// The fingerprints of the last queried snapshot are kept with the generation of each session, a query only hashes
+/// the sessions which changed since, and nothing if the snapshot is the same.
+class ChangeTracker {
+public:
+  enum class Change : uint8_t {
+    ADDED = 1,
+    REMOVED = 2,
+    MODIFIED = 3,
+  };
+
+  struct Entry {
+    int16_t pid_;
+    uint8_t endpoint_;  ///< with diff_pids(), the device of the first changed session of the pid
+    Change change_;
+  };
+
+  /// @brief The board knows no sessions, everything counts as changed
+  void reset();
+
+  /// @brief The board received @p sessions
+  void acknowledge(const VolumeControl::SessionSnapshot& sessions);
+
+  /// @brief The volume of @p pid was set on request of the board, on all its devices, so the board knows it already
+  void set_volume(int16_t pid, float volume);
+
+  /// @brief The mute state of @p pid was set on request of the board
+  void set_muted(int16_t pid, bool muted);
+
+  /// @brief Check if @p sessions differ from the acknowledged list, without building the difference
+  [[nodiscard]] bool changed(const VolumeControl::SessionSnapshot& sessions);
+
+  /// @brief The sessions which were added, removed or modified since the acknowledged list
+  [[nodiscard]] std::vector<Entry> diff(const VolumeControl::SessionSnapshot& sessions);
+
+  /// @brief diff() for the boards, which know the sessions by pid only. A process on several devices is one entry: it
+  /// is added with its first session, removed with its last one, and modified by any other change
+  [[nodiscard]] std::vector<Entry> diff_pids(const VolumeControl::SessionSnapshot& sessions);
+
+  [[nodiscard]] uint64_t digest() const {
+    return digest_;
+  }
+
+private:
+  using Key = std::pair<int, uint8_t>;  ///< pid and endpoint
+
+  /// @brief The sessions of one key
+  struct State {
+    uint64_t name_hash_;
+    uint8_t volume_;  ///< of the first session, a volume the board sets applies to all of them
+    bool muted_;
+    uint32_t count_;  ///< sessions of the pid on the device
+    uint64_t fingerprint_;
+  };
+
+  /// @brief The sessions of one key in the last queried snapshot, in the order of the snapshot
+  struct Seen {
+    Key key_;
+    uint64_t generation_;  ///< the newest generation of the sessions, any change of them gets a newer one
+    State state_;
+  };
+
+  static State make_state(const VolumeControl::SessionSnapshot& sessions, size_t i);
+  static uint64_t fingerprint(Key key, uint64_t name_hash, uint8_t volume, bool muted);
+
+  /// @brief Recompute the fingerprint of @p state, after the volume or mute state of all its sessions changed
+  void refresh(Key key, State& state);
+
+  /// @brief Bring seen_ to @p sessions, hashing only the sessions with a new generation
+  void update(const VolumeControl::SessionSnapshot& sessions);
+
+  std::map<Key, State> sessions_;  ///< ordered, so the sessions of a pid are adjacent
+  uint64_t digest_ = 0;
+  bool valid_ = false;  ///< the board acknowledged a list since the last reset
+
+  std::vector<Seen> seen_;
+  uint64_t seen_digest_ = 0;
+  uint64_t seen_generation_ = 0;  ///< generation of the snapshot in seen_, 0 before the first
+};
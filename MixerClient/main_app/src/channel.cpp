@@ -0,0 +1,108 @@
+#include "channel.h"
+#include <algorithm>
+#include <cstring>
+#include "CommSupervisor/supervisor.h"
+
+
+FrameBuffer::FrameBuffer() : buffer_(max_encoded + 1) {
+}
+
+size_t FrameBuffer::append(const uint8_t* data, size_t len) {
+  const size_t n = std::min(len, max_payload - len_);
+  std::memcpy(buffer_.data() + head_room + len_, data, n);
+  len_ += n;
+  return n;
+}
+
+void FrameBuffer::send(SerialLink& port) {
+  uint8_t* payload = buffer_.data() + head_room;
+  const uint32_t crc = CRC::crc32mpeg2(payload, len_);
+  std::memcpy(payload + len_, &crc, crc_size);
+
+  const size_t len = len_ + crc_size;
+  uint8_t* frame = payload - COBS::max_overhead(len);
+  const size_t encoded = COBS::encode(payload, len, frame);
+  frame[encoded] = COBS::delimiter;
+  port.write(frame, encoded + 1);
+  len_ = 0;
+}
+
+
+PortChannel::PortChannel(SerialLink& port) : port_(port), decoder_(FrameBuffer::max_encoded) {
+}
+
+int PortChannel::write(const uint8_t* data, size_t len) {
+  if (not framed_) {
+    return port_.write(data, len);
+  }
+
+  for (size_t done = 0; done < len;) {
+    if (out_.full()) {
+      flush();
+    }
+    done += out_.append(data + done, len - done);
+  }
+  return static_cast<int>(len);
+}
+
+void PortChannel::flush() {
+  if (framed_ && out_.size()) {
+    out_.send(port_);
+  }
+}
+
+bool PortChannel::receive_frame() {
+  uint8_t byte;
+  while (port_.read(&byte, 1)) {
+    switch (decoder_.push(byte)) {
+      case COBS::FrameDecoder::Result::NONE:
+        break;
+
+      case COBS::FrameDecoder::Result::FRAME:
+        if (decoder_.size() > crc_size && CRC::verify_crc(decoder_.data(), decoder_.size())) {
+          in_pos_ = 0;
+          in_len_ = decoder_.size() - crc_size;
+          return true;
+        }
+        error_ = true;
+        return false;
+
+      case COBS::FrameDecoder::Result::ERROR:
+        error_ = true;
+        return false;
+    }
+  }
+  return false;
+}
+
+int PortChannel::read(uint8_t* data, size_t len) {
+  if (not framed_) {
+    return port_.read(data, len);
+  }
+
+  flush();
+  if (in_pos_ == in_len_ && not receive_frame()) {
+    return error_ ? -1 : 0;
+  }
+  const size_t n = std::min(len, in_len_ - in_pos_);
+  std::memcpy(data, decoder_.data() + in_pos_, n);
+  in_pos_ += n;
+  return static_cast<int>(n);
+}
+
+void PortChannel::end_message() {
+  flush();
+  in_pos_ = in_len_;
+}
+
+void PortChannel::set_framed(bool framed) {
+  flush();
+  framed_ = framed;
+  in_pos_ = in_len_ = 0;
+}
+
+bool PortChannel::take_error() {
+  const bool error = error_;
+  error_ = false;
+  return error;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "CommSupervisor/cobs.h"
+
+
+/// @brief Byte stream to the board: the serial port, or a simulated board in the examples
+class SerialLink {
+public:
+  virtual ~SerialLink() = default;
+
+  /// @brief Write @p len bytes
+  /// @return the number of bytes written
+  virtual int write(const uint8_t* data, size_t len) = 0;
+
+  /// @brief Read up to @p len bytes, waiting a little for the first one
+  /// @return bytes read, 0 if none arrived
+  virtual int read(uint8_t* data, size_t len) = 0;
+};
+
+
+/// @brief Byte stream of one exchange with the board, the command handlers read and write through it
+class Channel {
+public:
+  virtual ~Channel() = default;
+
+  /// @brief Write @p len bytes
+  /// @return the number of bytes written or queued
+  virtual int write(const uint8_t* data, size_t len) = 0;
+
+  /// @brief Read up to @p len bytes, that are available
+  /// @return bytes read, -1 if a corrupted frame was dropped
+  virtual int read(uint8_t* data, size_t len) = 0;
+
+  /// @brief Send the queued bytes
+  virtual void flush() = 0;
+
+  /// @brief Finish the exchange of one command: flush, and drop what's left of the received frame
+  virtual void end_message() = 0;
+
+  /// @brief Check for dropped frames since the last call
+  /// @return true if a frame was dropped
+  virtual bool take_error() = 0;
+
+  /// @brief Wait until bytes are received or @p deadline passes, without reading them. Streams pace their ticks
+  /// with it, and stop once the board sends something. Only tagged requests stream, the others just wait
+  /// @return true if received bytes are waiting, or the channel was closed
+  virtual bool wait_input(std::chrono::steady_clock::time_point deadline) {
+    std::this_thread::sleep_until(deadline);
+    return false;
+  }
+};
+
+
+/// @brief Outgoing frame, built in place: head room for the COBS overhead, the payload, its CRC and the delimiter
+class FrameBuffer {
+  static constexpr size_t crc_size = 4;
+
+public:
+  static constexpr size_t max_payload = 4096;
+  static constexpr size_t head_room = COBS::max_overhead(max_payload + crc_size);
+  static constexpr size_t max_encoded = head_room + max_payload + crc_size;  ///< longest frame, without delimiter
+
+  FrameBuffer();
+
+  /// @brief Append up to @p len bytes
+  /// @return the bytes appended, less than @p len if the frame is full
+  size_t append(const uint8_t* data, size_t len);
+
+  [[nodiscard]] size_t size() const {
+    return len_;
+  }
+
+  [[nodiscard]] bool full() const {
+    return len_ == max_payload;
+  }
+
+  /// @brief Add the CRC, encode the frame and write it to @p port, then start a new frame
+  void send(SerialLink& port);
+
+private:
+  std::vector<uint8_t> buffer_;
+  size_t len_ = 0;
+};
+
+
+/// @brief The link to the board as a Channel.
+///
+/// In raw mode, bytes go straight to the port. In framed mode, which the board enables with ENABLE_FRAMING, the
+/// bytes are carried in COBS frames, each followed by a CRC. Written bytes are collected and sent as one frame
+/// before the next read, so the existing request/response exchanges map to frames without changes. A corrupted
+/// frame fails the current read at once, and the stream picks up again at the next frame.
+class PortChannel : public Channel {
+public:
+  explicit PortChannel(SerialLink& port);
+
+  PortChannel(const PortChannel&) = delete;
+  PortChannel& operator=(const PortChannel&) = delete;
+
+  int write(const uint8_t* data, size_t len) override;
+  int read(uint8_t* data, size_t len) override;
+  void flush() override;
+  void end_message() override;
+  bool take_error() override;
+
+  void set_framed(bool framed);
+
+  [[nodiscard]] bool is_framed() const {
+    return framed_;
+  }
+
+  /// @brief Read from the port until a frame is complete, for the multiplexer, which routes whole frames
+  /// @return false if no frame is available yet, or it was dropped
+  bool receive_frame();
+
+  /// @brief payload of the last received frame
+  [[nodiscard]] const uint8_t* frame_data() const {
+    return decoder_.data();
+  }
+
+  [[nodiscard]] size_t frame_size() const {
+    return in_len_;
+  }
+
+  [[nodiscard]] SerialLink& port() {
+    return port_;
+  }
+
+private:
+  static constexpr size_t crc_size = 4;
+
+  SerialLink& port_;
+  bool framed_ = false;
+  bool error_ = false;
+
+  FrameBuffer out_;
+
+  COBS::FrameDecoder decoder_;
+  size_t in_pos_ = 0;  ///< bytes of the received frame consumed
+  size_t in_len_ = 0;  ///< payload bytes in the received frame
+};
@@ -0,0 +1,39 @@
+#include "chunk_controller.h"
+#include <algorithm>
+
+
+ChunkController::ChunkController(uint32_t min_size, uint32_t step) : min_size_(min_size), step_(step) {
+}
+
+void ChunkController::begin(uint32_t board_max) {
+  std::lock_guard lock(mutex_);
+  max_ = board_max;
+  // start optimistic, shrink once the link shows errors
+  if (size_ == 0) {
+    size_ = max_;
+  }
+  size_ = std::clamp(size_, std::min(min_size_, max_), max_);
+}
+
+uint32_t ChunkController::chunk_size() const {
+  std::lock_guard lock(mutex_);
+  return size_;
+}
+
+ChunkController::Stats ChunkController::stats() const {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
+void ChunkController::on_success(uint32_t bytes) {
+  std::lock_guard lock(mutex_);
+  ++stats_.acked_;
+  stats_.bytes_ += bytes;
+  size_ = std::min(max_, size_ + step_);
+}
+
+void ChunkController::on_failure() {
+  std::lock_guard lock(mutex_);
+  ++stats_.failed_;
+  size_ = std::max(std::min(min_size_, max_), size_ / 2);
+}
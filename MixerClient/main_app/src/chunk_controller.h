@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+
+
+/// @brief AIMD controller of the image chunk size.
+/// The chunks grow by a fixed step while the board acknowledges them, and are halved after a failure, within the
+/// limit the board advertises. The state is kept across transfers, so a noisy link starts with small chunks.
+/// Concurrent transfers share it, as they share the link.
+class ChunkController {
+public:
+  /// @brief Counters since start
+  struct Stats {
+    uint32_t acked_;   ///< chunks acknowledged by the board
+    uint32_t failed_;  ///< chunks rejected or timed out
+    uint64_t bytes_;   ///< bytes acknowledged
+  };
+
+  /// @param min_size chunks aren't shrunk below this
+  /// @param step growth after each acknowledged chunk
+  explicit ChunkController(uint32_t min_size = 16, uint32_t step = 32);
+
+  /// @brief Start a transfer to a board, which accepts chunks up to @p board_max bytes
+  void begin(uint32_t board_max);
+
+  /// @brief size of the next chunk
+  [[nodiscard]] uint32_t chunk_size() const;
+
+  void on_success(uint32_t bytes);
+  void on_failure();
+
+  [[nodiscard]] Stats stats() const;
+
+private:
+  const uint32_t min_size_;
+  const uint32_t step_;
+  mutable std::mutex mutex_;
+  uint32_t max_ = 0;
+  uint32_t size_ = 0;  ///< 0 until the first transfer
+  Stats stats_{};
+};
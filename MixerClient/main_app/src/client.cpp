@@ -32,7 +32,28 @@ static constexpr size_t num_events = static_cast<size_t>(event_t::NUM_EVENTS);
 using fcn_t = event_t (*)(void);
 
 
+/// @brief The COM port of the board as a SerialLink
+class SerialPortLink : public SerialLink {
+public:
+  explicit SerialPortLink(SerialPortWrapper& port) : port_(port) {
+  }
+
+  int write(const uint8_t* data, size_t len) override {
+    return port_.write(data, len);
+  }
+
+  int read(uint8_t* data, size_t len) override {
+    return port_.read(data, len);
+  }
+
+private:
+  SerialPortWrapper& port_;
+};
+
+
 std::unique_ptr<SerialPortWrapper> gPort{ nullptr };
+std::unique_ptr<SerialPortLink> gLink{ nullptr };
+std::unique_ptr<PortChannel> gChannel{ nullptr };  ///< stream over gPort, starts in raw mode on every connection
 
 static const fcn_t state_table[] = { port_close_handler, port_searching_handler, port_open_handler };
 static const state_t transition_table[num_states][num_events] = { { PORT_SEARCHING, PORT_SEARCHING },
@@ -53,6 +74,9 @@ int client_init() {
 
 int client_deinit() {
   curr_state = state_t::PORT_SEARCHING;
+  serial_close();
+  gChannel = nullptr;
+  gLink = nullptr;
   gPort = nullptr;
   return 0;
 }
@@ -82,9 +106,13 @@ event_t port_searching_handler() {
 
   for (const auto& port : ports) {
     if (port.bus_reported_dev_descr_ == target_descr) {
+      gChannel = nullptr;
+      gLink = nullptr;
       gPort = std::make_unique<SerialPortWrapper>(port.port_str_, 115200);
       gPort->open();
       if ((*gPort)()) {
+        gLink = std::make_unique<SerialPortLink>(*gPort);
+        gChannel = std::make_unique<PortChannel>(*gLink);
         return event_t::EVENT_SUCCESS;
       }
     }
@@ -95,7 +123,7 @@ event_t port_searching_handler() {
 }
 
 event_t port_open_handler() {
-  if (serial_comm(*gPort)) {
+  if (serial_comm(*gChannel)) {
     return event_t::EVENT_SUCCESS;
   } else {
     return event_t::EVENT_FAILURE;
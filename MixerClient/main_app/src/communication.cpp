@@ -1,33 +1,147 @@
 #include "communication.h"
 #include "VolumeAPI/VolumeAPI.h"
 #include "CommSupervisor/supervisor.h"
+#include "CommSupervisor/varint.h"
 #include <chrono>
 #include <string>
 #include <thread>
-#include <codecvt>
+#include <algorithm>
 #include <array>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include "chunk_controller.h"
+#include "latency_stats.h"
+#include "change_tracker.h"
+#include "frame_cache.h"
+#include "meter_stream.h"
+#include "multiplexer.h"
+#include "name_dictionary.h"
+#include "session_ranking.h"
 
 
-static uint32_t glob_last_crc = 0;
-static uint32_t compute_session_checksum(const std::vector<VolumeControl::AudioSessionInfo>&);
+static ChangeTracker session_tracker;  ///< sessions the board acknowledged last
+static std::mutex tracker_mutex;
+static LatencyStats img_first_byte_latency;  ///< READ_IMG command to first byte of the response
+static std::mutex latency_mutex;             ///< guards img_first_byte_latency, tagged requests run concurrently
+static ChunkController chunk_controller;     ///< chunk sizes of the link, kept across transfers
+static std::unique_ptr<Multiplexer> multiplexer;  ///< set while the board uses tagged requests
+static std::mutex multiplexer_mutex;  ///< guards replacing multiplexer, only the client thread uses it otherwise
+static NameDictionary load_names;                 ///< filenames the board received on this link
+static std::mutex load_names_mutex;
+static FrameCache load_cache;  ///< encoded session lists of the current snapshot
+static SessionRanking session_ranking(mixer::ACTIVITY_HALF_LIFE);  ///< sessions for the slots of LOAD_TOP
+static std::unique_ptr<ActivitySampler> activity_sampler;  ///< set once the board asked for the top sessions
+static std::mutex activity_mutex;                          ///< guards activity_sampler
+static void dispatch(Channel& port, uint8_t c);
+static FramePriority priority_of(uint8_t c);
 
 
 
-template <class T>
-static inline T mem2T(const uint8_t* mem) {
-  return *reinterpret_cast<const T*>(mem);
+/// @brief Wait for a message with the layout @p M, and check its CRC
+/// @return the received bytes, empty on timeout or CRC error
+template <class M>
+static std::vector<uint8_t> wait_message(Channel& port) {
+  auto data = wait_data(port, M::wire_size);
+  if (data.size() < M::wire_size) {
+    DEBUG_PRINT("\t No data\n");
+    return {};
+  }
+  if (not M::verify(data.data())) {
+    DEBUG_PRINT("\tCRC error\n");
+    return {};
+  }
+  return data;
 }
 
+/// @brief Wait for the board to acknowledge
+/// @return the status, 0 on timeout or CRC error
+static uint8_t wait_ack(Channel& port) {
+  const auto data = wait_message<mixer::Ack>(port);
+  return data.empty() ? 0 : mixer::Ack::View(data.data()).get<mixer::fields::Status>();
+}
+
+/// @brief Write message @p M with @p values
+template <class M, class... Values>
+static void write_message(Channel& port, const Values&... values) {
+  const auto data = M::encode(values...);
+  port.write(data.data(), data.size());
+}
+
+
+bool serial_comm(PortChannel& port) {
+  if (multiplexer) {
+    if (multiplexer->poll()) {
+      return true;
+    }
+    serial_close();
+    DEBUG_PRINT("No data\n");
+    return false;
+  }
 
-bool serial_comm(SerialPortWrapper& port) {
   const auto buffer = wait_data(port, 1);
   if (buffer.size() < 1) {
-    glob_last_crc = 0;
+    if (port.take_error()) {
+      // framed link, the next frame starts clean
+      return true;
+    }
+    serial_close();
     DEBUG_PRINT("No data\n");
     return false;
   }
 
-  const uint8_t c = mem2T<uint8_t>(buffer.data());
+  const uint8_t c = buffer[0];
+
+  // these change the transport, they are handled here and not by the multiplexer
+  if (c == mixer::commands::ENABLE_FRAMING) {
+    DEBUG_PRINT("respond_enable_framing()\n");
+    respond_enable_framing(port);
+    DEBUG_PRINT("respond_enable_framing() DONE\n");
+  } else if (c == mixer::commands::ENABLE_TAGS) {
+    DEBUG_PRINT("respond_enable_tags()\n");
+    respond_enable_tags(port);
+    DEBUG_PRINT("respond_enable_tags() DONE\n");
+  } else if (c == mixer::commands::STREAM_METERS) {
+    // a stream would hold the link, until the board stops it. Only tagged requests can run next to it
+    DEBUG_PRINT("stream refused, tags are off\n");
+    if (not wait_message<mixer::MeterStreamRequest>(port).empty()) {
+      write_message<mixer::Ack>(port, mixer::commands::RESPONSE_FAIL);
+    }
+  } else {
+    dispatch(port, c);
+  }
+
+  port.end_message();
+  if (port.take_error()) {
+    DEBUG_PRINT("\tframe dropped, waiting for the next command\n");
+  }
+  return true;
+}
+
+void serial_close() {
+  {
+    // destroyed outside the lock, it waits for the requests
+    std::unique_ptr<Multiplexer> closed;
+    std::lock_guard lock(multiplexer_mutex);
+    closed.swap(multiplexer);
+  }
+  {
+    // the ranking is kept for the next board, it starts sampling again with its first LOAD_TOP
+    std::lock_guard lock(activity_mutex);
+    activity_sampler = nullptr;
+  }
+  {
+    std::lock_guard lock(load_names_mutex);
+    load_names.reset();
+  }
+  std::lock_guard lock(tracker_mutex);
+  session_tracker.reset();
+}
+
+/// @brief Call the handler of command @p c
+static void dispatch(Channel& port, uint8_t c) {
+  // the counters are global, tagged requests running at the same time are counted too
+  const auto before = VolumeControl::get_resolve_stats();
 
   switch (c) {
     case mixer::commands::LOAD_ALL: {
@@ -37,6 +151,13 @@ bool serial_comm(SerialPortWrapper& port) {
       break;
     }
 
+    case mixer::commands::LOAD_ALL_COMPACT: {
+      DEBUG_PRINT("respond_load_compact()\n");
+      respond_load_compact(port);
+      DEBUG_PRINT("respond_load_compact() DONE\n");
+      break;
+    }
+
     case mixer::commands::READ_IMG: {
       DEBUG_PRINT("respond_img()\n");
       respond_img(port);
@@ -44,6 +165,34 @@ bool serial_comm(SerialPortWrapper& port) {
       break;
     }
 
+    case mixer::commands::READ_IMG_RAW: {
+      DEBUG_PRINT("respond_img_raw()\n");
+      respond_img_raw(port);
+      DEBUG_PRINT("respond_img_raw() DONE\n");
+      break;
+    }
+
+    case mixer::commands::READ_ALL_IMG: {
+      DEBUG_PRINT("respond_img_all()\n");
+      respond_img_all(port);
+      DEBUG_PRINT("respond_img_all() DONE\n");
+      break;
+    }
+
+    case mixer::commands::QUERY_ICON_HASH: {
+      DEBUG_PRINT("respond_query_icon_hash()\n");
+      respond_query_icon_hash(port);
+      DEBUG_PRINT("respond_query_icon_hash() DONE\n");
+      break;
+    }
+
+    case mixer::commands::READ_IMG_RESUME: {
+      DEBUG_PRINT("respond_img_resume()\n");
+      respond_img_resume(port);
+      DEBUG_PRINT("respond_img_resume() DONE\n");
+      break;
+    }
+
     case mixer::commands::SET_VOLUME: {
       DEBUG_PRINT("respond_set_volume()\n");
       respond_set_volume(port);
@@ -72,137 +221,568 @@ bool serial_comm(SerialPortWrapper& port) {
       break;
     }
 
+    case mixer::commands::QUERY_CHANGED_SESSIONS: {
+      DEBUG_PRINT("respond_query_changed_sessions()\n");
+      respond_query_changed_sessions(port);
+      DEBUG_PRINT("respond_query_changed_sessions() DONE\n");
+      break;
+    }
+
+    case mixer::commands::STREAM_METERS: {
+      DEBUG_PRINT("respond_stream_meters()\n");
+      respond_stream_meters(port);
+      DEBUG_PRINT("respond_stream_meters() DONE\n");
+      break;
+    }
+
+    case mixer::commands::LOAD_TOP: {
+      DEBUG_PRINT("respond_load_top()\n");
+      respond_load_top(port);
+      DEBUG_PRINT("respond_load_top() DONE\n");
+      break;
+    }
+
+    case mixer::commands::PIN_SESSION: {
+      DEBUG_PRINT("respond_pin_session()\n");
+      respond_pin_session(port);
+      DEBUG_PRINT("respond_pin_session() DONE\n");
+      break;
+    }
+
+    case mixer::commands::LOAD_ENDPOINTS: {
+      DEBUG_PRINT("respond_load_endpoints()\n");
+      respond_load_endpoints(port);
+      DEBUG_PRINT("respond_load_endpoints() DONE\n");
+      break;
+    }
+
     default:
       DEBUG_PRINT("Err: unknown " << static_cast<int>(c) << "\n");
       break;
   }
 
-  return true;
+  const auto after = VolumeControl::get_resolve_stats();
+  if (after.paths_ != before.paths_ || after.icons_ != before.icons_) {
+    DEBUG_PRINT("\tresolved " << after.paths_ - before.paths_ << " paths, " << after.icons_ - before.icons_
+                               << " icons\n");
+  }
 }
 
 
-void respond_load(SerialPortWrapper& port) {
-  namespace VC = VolumeControl;
+/// @brief Record the session list the board received, or with nullptr that it may have lost it
+static void acknowledge_sessions(const VolumeControl::SessionSnapshot* sessions) {
+  std::lock_guard lock(tracker_mutex);
+  if (sessions) {
+    session_tracker.acknowledge(*sessions);
+  } else {
+    session_tracker.reset();
+  }
+}
+
+/// @brief The first session of each pid in @p snapshot, for the boards which know the sessions by pid only. A process
+/// on several devices is listed once, the pid commands set all of its sessions
+static std::vector<size_t> pid_rows(const VolumeControl::SessionSnapshot& snapshot) {
+  std::vector<size_t> rows;
+  rows.reserve(snapshot.size());
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    if (i == 0 || snapshot.pids()[i] != snapshot.pids()[i - 1]) {
+      rows.push_back(i);
+    }
+  }
+  return rows;
+}
 
+/// @brief Length of @p name in a message with a one byte length, which counts the terminating 0 too. Longer names
+/// are cut at a UTF-8 character boundary
+static size_t clamped_size(const std::string& name) {
+  constexpr size_t max_size = 254;
+  if (name.size() <= max_size) {
+    return name.size();
+  }
+  size_t n = max_size;
+  while (n > 0 && (static_cast<uint8_t>(name[n]) & 0xC0) == 0x80) {
+    --n;
+  }
+  return n;
+}
+
+/// @brief Append @p name with its one byte length and the terminating 0, clamped to 254 bytes
+static void append_name(Hasher& sv, const std::string& name) {
+  const size_t n = clamped_size(name);
+  sv.append(static_cast<uint8_t>(n + 1));
+  sv.compute_crc();
+
+  sv.append_buff(name.c_str(), n);
+  sv.append(static_cast<uint8_t>(0));
+  sv.compute_crc();
+}
+
+/// @brief Encode the sessions @p rows of @p snapshot for LOAD_ALL, in the order of @p rows
+static std::vector<uint8_t> encode_load(const VolumeControl::SessionSnapshot& snapshot,
+                                        const std::vector<size_t>& rows) {
   Hasher sv;
-  auto sessions = VC::get_all_sessions_info();
+  sv.append(static_cast<uint8_t>(rows.size()));
+  sv.compute_crc();
 
+  for (const size_t i : rows) {
+    sv.append(static_cast<int16_t>(snapshot.pids()[i]));
+    sv.append(static_cast<uint8_t>(snapshot.volume(i)));
+    sv.append(static_cast<uint8_t>(snapshot.muted(i)));
+    append_name(sv, snapshot.name_utf8(i));
+  }
+  return sv.get_buffer();
+}
+
+/// @brief Encode the sessions @p rows of @p snapshot for LOAD_ALL_COMPACT, staging their new names in load_names
+/// @param clear the board has to clear its dictionary first
+/// @param endpoints add the device of each session
+static std::vector<uint8_t> encode_load_compact(const VolumeControl::SessionSnapshot& snapshot,
+                                                const std::vector<size_t>& rows, bool clear, bool endpoints) {
+  // beyond the capacity of the board's dictionary, the names go without an index and aren't kept
+  const bool inline_names = load_names.inline_names();
+
+  // one CRC for the whole message, frames carry their own CRC too
+  Hasher sv;
+  sv.append(static_cast<uint8_t>((clear ? mixer::load_flags::CLEAR_NAMES : 0) |
+                                 (endpoints ? mixer::load_flags::WITH_ENDPOINTS : 0) |
+                                 (inline_names ? mixer::load_flags::INLINE_NAMES : 0)));
+  sv.append_varint(rows.size());
+  for (const size_t i : rows) {
+    sv.append_varint(Varint::zigzag(static_cast<int16_t>(snapshot.pids()[i])));
+    if (endpoints) {
+      sv.append(snapshot.endpoint(i));
+    }
+    const auto volume = static_cast<uint8_t>(std::clamp(snapshot.volume(i), 0.f, 100.f));
+    sv.append(static_cast<uint8_t>(volume | (snapshot.muted(i) ? mixer::MUTED_BIT : 0)));
 
-  sv.append(static_cast<uint8_t>(sessions.size()));
+    const std::string& name = snapshot.name_utf8(i);
+    if (inline_names) {
+      sv.append_varint(name.size());
+      sv.append_buff(name.data(), name.size());
+      continue;
+    }
+    // the index of a known name, or the new index with the name
+    const auto entry = load_names.find(name);
+    sv.append_varint((static_cast<uint64_t>(entry.index_) << 1) | entry.is_new_);
+    if (entry.is_new_) {
+      sv.append_varint(name.size());
+      sv.append_buff(name.data(), name.size());
+    }
+  }
   sv.compute_crc();
+  return sv.get_buffer();
+}
 
-  for (const auto& session : sessions) {
-    // std::wcout << session << '\n';
+FrameCache::Stats get_load_cache_stats() {
+  return load_cache.stats();
+}
+
+LatencyStats get_img_latency_stats() {
+  std::lock_guard lock(latency_mutex);
+  return img_first_byte_latency;
+}
+
+LatencyStats get_control_delay_stats() {
+  std::lock_guard lock(multiplexer_mutex);
+  return multiplexer ? multiplexer->control_delay() : LatencyStats();
+}
+
+/// @brief Print the counters of the session list cache
+static void print_load_cache_stats() {
+  const auto stats = load_cache.stats();
+  DEBUG_PRINT("\tcache hits: " << stats.hits_ << ", misses: " << stats.misses_
+                               << ", generations: " << stats.generations_ << '\n');
+}
+
+void respond_load(Channel& port) {
+  using Encoding = FrameCache::Encoding;
+  const auto snapshot = VolumeControl::get_session_snapshot();
+  const uint64_t generation = load_cache.update(snapshot.generation());
+
+  auto frame = load_cache.find(generation, Encoding::LOAD_ALL, 0);
+  if (not frame) {
+    frame = load_cache.put(generation, Encoding::LOAD_ALL, 0, encode_load(snapshot, pid_rows(snapshot)));
+  }
+  DEBUG_PRINT("\t data length: " << frame->size() << '\n');
+  print_load_cache_stats();
+  port.write(frame->data(), frame->size());
+
+  const bool ok = wait_ack(port) == mixer::commands::RESPONSE_OK;
+  DEBUG_PRINT((ok ? "\tsend success\n" : "\tsend failure\n"));
+  acknowledge_sessions(ok ? &snapshot : nullptr);
+}
+
+void respond_load_compact(Channel& port) {
+  using Encoding = FrameCache::Encoding;
+  const auto request = wait_message<mixer::LoadCompactRequest>(port);
+  if (request.empty()) {
+    return;
+  }
+  const uint8_t flags = mixer::LoadCompactRequest::View(request.data()).get<mixer::fields::LoadFlags>();
+  const auto snapshot = VolumeControl::get_session_snapshot();
+  const uint64_t generation = load_cache.update(snapshot.generation());
 
-    sv.append(static_cast<int16_t>(session.pid_));
-    sv.append(static_cast<uint8_t>(session.volume_));
-    sv.append(static_cast<uint8_t>(session.muted_));
-    sv.append(static_cast<uint8_t>(session.filename_.size() + 1));
-    sv.compute_crc();
+  // the names of the sessions are staged until the board acknowledges them
+  std::lock_guard lock(load_names_mutex);
+  if (flags & mixer::load_flags::CLEAR_NAMES) {
+    load_names.reset();
+  }
+  const bool endpoints = flags & mixer::load_flags::WITH_ENDPOINTS;
+  // without the devices, the board can't tell the sessions of a process apart
+  std::vector<size_t> rows(snapshot.size());
+  if (endpoints) {
+    std::iota(rows.begin(), rows.end(), size_t{ 0 });
+  } else {
+    rows = pid_rows(snapshot);
+  }
+  std::vector<const std::string*> names;
+  names.reserve(rows.size());
+  for (const size_t i : rows) {
+    names.push_back(&snapshot.name_utf8(i));
+  }
+  const bool clear = load_names.begin(names);
 
-    const std::string s = std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().to_bytes(session.filename_);
-    for (char c : s) {
-      sv.append(c);
+  // with every name known, the encoding only depends on the dictionary version and the flags
+  const uint64_t variant = (load_names.version() << 1) | endpoints;
+  auto frame = clear ? nullptr : load_cache.find(generation, Encoding::LOAD_ALL_COMPACT, variant);
+  if (not frame) {
+    auto data = encode_load_compact(snapshot, rows, clear, endpoints);
+    if (not clear && not load_names.has_staged()) {
+      frame = load_cache.put(generation, Encoding::LOAD_ALL_COMPACT, variant, std::move(data));
+    } else {
+      frame = std::make_shared<const std::vector<uint8_t>>(std::move(data));
     }
-    sv.append('\0');
-    sv.compute_crc();
   }
-  DEBUG_PRINT("\t data length: " << sv.get_buffer().size() << '\n');
-  port.write(sv.get_buffer().data(), sv.get_buffer().size());
+  DEBUG_PRINT("\t data length: " << frame->size() << '\n');
+  print_load_cache_stats();
+  port.write(frame->data(), frame->size());
 
-  auto data = wait_data(port, 5);
-  if (data.size() >= 5 && CRC::verify_crc(data.data(), 5) && data[0] == mixer::commands::RESPONSE_OK) {
-    DEBUG_PRINT("\tsend success\n");
-    glob_last_crc = compute_session_checksum(sessions);
+  const bool ok = wait_ack(port) == mixer::commands::RESPONSE_OK;
+  DEBUG_PRINT((ok ? "\tsend success\n" : "\tsend failure\n"));
+  if (ok) {
+    load_names.commit();
   } else {
-    DEBUG_PRINT("\tsend failure\n");
-    glob_last_crc = 0;
+    load_names.rollback();
   }
+  acknowledge_sessions(ok ? &snapshot : nullptr);
 }
 
-void respond_img(SerialPortWrapper& port) {
-  namespace VC = VolumeControl;
+/// @brief Find the session of @p pid
+/// @return true if found
+static bool find_session(int16_t pid, VolumeControl::AudioSessionInfo& info) {
+  // the board asks for the sessions it loaded, only a session started since needs a new enumeration
+  auto snapshot = VolumeControl::get_cached_snapshot();
+  size_t i = snapshot.find(pid);
+  if (i == snapshot.npos) {
+    snapshot = VolumeControl::get_session_snapshot();
+    i = snapshot.find(pid);
+  }
+  if (i == snapshot.npos) {
+    return false;
+  }
+  info = snapshot.info(i);
+  return true;
+}
 
-  const auto sessions = VC::get_all_sessions_info();
-  Hasher hasher;
-  DeHasher dehasher;
+/// @brief Wait for the board to send the largest chunk it accepts
+/// @param max_chunk_size the chunk size, with mixer::ADAPTIVE_CHUNKS set if the board accepts length-prefixed chunks
+/// @return true on success
+static bool wait_chunk_size(Channel& port, uint32_t& max_chunk_size) {
+  const auto chunk_data = wait_message<mixer::ChunkSizeMessage>(port);
+  if (chunk_data.empty()) {
+    DEBUG_PRINT("\t No chunk size\n");
+    return false;
+  }
+  max_chunk_size = mixer::ChunkSizeMessage::View(chunk_data.data()).get<mixer::fields::ChunkSize>();
+  DEBUG_PRINT("\tChunk size is: " << (max_chunk_size & ~mixer::ADAPTIVE_CHUNKS) << '\n');
+  return (max_chunk_size & ~mixer::ADAPTIVE_CHUNKS) != 0;
+}
+
+/// @brief Send @p img_data in length-prefixed chunks sized by chunk_controller. Rejected chunks are sent again
+/// @return true on success
+static bool send_adaptive_chunks(Channel& port, const VolumeControl::IconData& img_data,
+                                 uint32_t max_chunk_size, uint32_t offset) {
+  constexpr unsigned max_retries = 8;
+  chunk_controller.begin(max_chunk_size);
 
+  const uint32_t img_sz = img_data.size();
+  unsigned retries = 0;
+  for (uint32_t bytes_written = offset; bytes_written < img_sz;) {
+    const uint32_t chunk_size = std::min(chunk_controller.chunk_size(), img_sz - bytes_written);
 
-  const auto pid_data = wait_data(port, sizeof(int16_t) + 4);
-  if (pid_data.size() < sizeof(int16_t) + 4) {
-    DEBUG_PRINT("\t No PID\n");
+    // the CRC covers the length too
+    uint8_t length[4], trailer[4];
+    Schema::store(length, chunk_size);
+    const uint32_t crc = CRC::crc32mpeg2(length, sizeof(length));
+    Schema::store(trailer, CRC::crc32mpeg2(img_data.data() + bytes_written, chunk_size, crc));
+    port.write(length, sizeof(length));
+    port.write(img_data.data() + bytes_written, chunk_size);
+    port.write(trailer, sizeof(trailer));
+
+    const uint8_t ack = wait_ack(port);
+    if (ack == mixer::commands::RESPONSE_OK) {
+      chunk_controller.on_success(chunk_size);
+      bytes_written += chunk_size;
+      retries = 0;
+      continue;
+    }
+
+    chunk_controller.on_failure();
+    DEBUG_PRINT("\tchunk fail at offset " << bytes_written << ", next size: " << chunk_controller.chunk_size()
+                                          << '\n');
+    // without an explicit rejection the board may still be reading, so the stream can't be resumed
+    if (ack != mixer::commands::RESPONSE_FAIL || ++retries > max_retries) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Send @p img_data in chunks of @p max_chunk_size, each followed by its CRC and acknowledged by the board
+/// @param offset start sending from this byte
+/// @return true on success
+static bool send_chunks(Channel& port, const VolumeControl::IconData& img_data, uint32_t max_chunk_size,
+                        uint32_t offset = 0) {
+  if (max_chunk_size & mixer::ADAPTIVE_CHUNKS) {
+    return send_adaptive_chunks(port, img_data, max_chunk_size & ~mixer::ADAPTIVE_CHUNKS, offset);
+  }
+
+  const uint32_t img_sz = img_data.size();
+  for (uint32_t bytes_written = offset; bytes_written < img_sz;) {
+    uint32_t chunk_size = std::min(max_chunk_size, img_sz - bytes_written);
+
+    auto written = port.write(img_data.data() + bytes_written, chunk_size);
+    uint32_t crc = CRC::crc32mpeg2(img_data.data() + bytes_written, chunk_size);
+
+    port.write(reinterpret_cast<uint8_t*>(&crc), 4);
+
+    bytes_written += written;
+
+    if (wait_ack(port) != mixer::commands::RESPONSE_OK) {
+      DEBUG_PRINT("\tchunk fail at offset " << bytes_written - written << '\n');
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Record the time from @p start to now as first byte latency
+static void record_latency(std::chrono::steady_clock::time_point start) {
+  std::lock_guard lock(latency_mutex);
+  img_first_byte_latency.add(
+      std::chrono::duration_cast<LatencyStats::duration_t>(std::chrono::steady_clock::now() - start));
+}
+
+/// @brief Send the size of @p img_data, wait for the chunk size, and send @p img_data in chunks
+/// @param start time the request was received, for the latency statistics
+static void send_image(Channel& port, const VolumeControl::IconData& img_data,
+                       std::chrono::steady_clock::time_point start) {
+  // send size of image
+  const uint32_t img_sz = img_data.size();
+  DEBUG_PRINT("\tIMG size: " << img_sz << '\n');
+  write_message<mixer::ImageSizeMessage>(port, img_sz);
+
+  record_latency(start);
+
+  uint32_t max_chunk_size = 0;
+  if (not wait_chunk_size(port, max_chunk_size) || not send_chunks(port, img_data, max_chunk_size)) {
     return;
   }
-  if (not CRC::verify_crc(pid_data.data(), 6)) {
-    DEBUG_PRINT("\tPID CRC Error\n");
+  DEBUG_PRINT("\tSend IMG success\n");
+}
+
+void respond_img(Channel& port) {
+  namespace VC = VolumeControl;
+  const auto start = std::chrono::steady_clock::now();
+
+  const auto pid_data = wait_message<mixer::ImgRequest>(port);
+  if (pid_data.empty()) {
     return;
   }
-  const int16_t pid = mem2T<int16_t>(pid_data.data());
+  const int16_t pid = mixer::ImgRequest::View(pid_data.data()).get<mixer::fields::Pid>();
 
   DEBUG_PRINT("\tPID: " << pid << '\n');
 
   VC::AudioSessionInfo info;
-  bool found = false;
-  for (const auto& sess : sessions) {
-    if (sess.pid_ == pid) {
-      found = true;
-      info = sess;
-      break;
-    }
+  if (not find_session(pid, info)) {
+    DEBUG_PRINT("\t session not found\n");
+    return;
+  }
+  DEBUG_WPRINT("\tSession: " << info.filename_ << '\n');
+
+  send_image(port, info.get_icon_data(), start);
+}
+
+void respond_img_raw(Channel& port) {
+  namespace VC = VolumeControl;
+  const auto start = std::chrono::steady_clock::now();
+
+  const auto req_data = wait_message<mixer::ImgRawRequest>(port);
+  if (req_data.empty()) {
+    return;
   }
-  if (not found) {
+
+  namespace F = mixer::fields;
+  const mixer::ImgRawRequest::View req(req_data.data());
+  const int16_t pid = req.get<F::Pid>();
+  const uint8_t format = req.get<F::PixelFormat>();
+  const uint8_t flags = req.get<F::RawFlags>();
+
+  VC::RawIconFormat raw_format{};
+  raw_format.format_ = static_cast<VC::PixelFormat>(format);
+  raw_format.width_ = req.get<F::Width>();
+  raw_format.height_ = req.get<F::Height>();
+  raw_format.background_ = req.get<F::Background>();
+  raw_format.keep_alpha_ = flags & mixer::raw_flags::KEEP_ALPHA;
+  raw_format.swap_bytes_ = flags & mixer::raw_flags::SWAP_BYTES;
+
+  DEBUG_PRINT("\tPID: " << pid << " format: " << static_cast<int>(format) << ' ' << raw_format.width_ << 'x'
+                        << raw_format.height_ << '\n');
+
+  if (format > static_cast<uint8_t>(VC::PixelFormat::RGB888) || raw_format.width_ == 0 || raw_format.height_ == 0 ||
+      raw_format.width_ > 256 || raw_format.height_ > 256) {
+    DEBUG_PRINT("\t invalid format\n");
+    return;
+  }
+
+  VC::AudioSessionInfo info;
+  if (not find_session(pid, info)) {
     DEBUG_PRINT("\t session not found\n");
     return;
   }
   DEBUG_WPRINT("\tSession: " << info.filename_ << '\n');
 
-  // send size of image
-  const auto png_data = info.get_icon_data();
-  uint32_t png_sz = png_data.size();
-  DEBUG_PRINT("\tPNG size: " << png_sz);
-  hasher.append(png_sz);
-  hasher.compute_crc();
-  DEBUG_PRINT("\tWriting bytes: " << hasher.get_buffer().size() << '\n');
-  port.write(hasher.get_buffer().data(), hasher.get_buffer().size());
-  hasher.begin_message();
+  send_image(port, info.get_icon_raw(raw_format), start);
+}
+
 
 
-  const auto chunk_data = wait_data(port, sizeof(uint32_t) + 4);
-  if (chunk_data.size() < sizeof(uint32_t) + 4) {
-    DEBUG_PRINT("\t No chunk_data\n");
+void respond_img_resume(Channel& port) {
+  namespace VC = VolumeControl;
+  const auto start = std::chrono::steady_clock::now();
+
+  const auto req_data = wait_message<mixer::ImgResumeRequest>(port);
+  if (req_data.empty()) {
     return;
   }
-  if (not CRC::verify_crc(chunk_data.data(), 8)) {
-    DEBUG_PRINT("\tChunk CRC error\n");
+
+  namespace F = mixer::fields;
+  const mixer::ImgResumeRequest::View req(req_data.data());
+  const int16_t pid = req.get<F::Pid>();
+  const uint32_t hash = req.get<F::IconHash>();
+  const uint32_t offset = req.get<F::Offset>();
+  DEBUG_PRINT("\tPID: " << pid << " offset: " << offset << '\n');
+
+  // the icon only depends on the pid, and the hash tells if it's still the same, so skip enumerating the sessions
+  VC::AudioSessionInfo info{};
+  info.pid_ = pid;
+  const auto img_data = info.get_icon_data();
+
+  // the board starts over with READ_IMG, if the icon changed since
+  const bool valid = not img_data.empty() && img_data.hash() == hash && offset <= img_data.size();
+  write_message<mixer::ImgResumeReply>(port, valid ? mixer::commands::RESPONSE_OK : mixer::commands::RESPONSE_FAIL,
+                                      static_cast<uint32_t>(img_data.size()));
+  if (not valid) {
+    DEBUG_PRINT("\ticon changed\n");
     return;
   }
-  const uint32_t max_chunk_size = mem2T<uint32_t>(chunk_data.data());
-  DEBUG_PRINT("\tChunk size is: " << max_chunk_size << '\n');
 
+  record_latency(start);
 
-  for (uint32_t bytes_written = 0; bytes_written < png_sz;) {
-    uint32_t chunk_size = std::min(max_chunk_size, static_cast<uint32_t>(png_data.size() - bytes_written));
+  uint32_t max_chunk_size = 0;
+  if (not wait_chunk_size(port, max_chunk_size) || not send_chunks(port, img_data, max_chunk_size, offset)) {
+    return;
+  }
+  DEBUG_PRINT("\tResume IMG success\n");
+}
 
-    auto written = port.write(reinterpret_cast<const uint8_t*>(png_data.data()) + bytes_written, chunk_size);
-    uint32_t crc = CRC::crc32mpeg2(png_data.data() + bytes_written, chunk_size);
+void respond_img_all(Channel& port) {
+  namespace VC = VolumeControl;
+  const auto start = std::chrono::steady_clock::now();
 
-    port.write(reinterpret_cast<uint8_t*>(&crc), 4);
+  const auto snapshot = VC::get_session_snapshot();
+  const auto rows = pid_rows(snapshot);
+  const size_t n_sessions = std::min<size_t>(rows.size(), 255);
 
-    bytes_written += written;
+  // sessions of the same executable share the icon, send each distinct icon once
+  std::vector<VC::IconData> icons;
+  std::vector<uint8_t> icon_ids(n_sessions, mixer::NO_ICON);
+  for (size_t i = 0; i < n_sessions; ++i) {
+    auto icon = snapshot.record(rows[i])->icon();
+    if (icon.empty()) {
+      continue;
+    }
+    const auto same = [&](size_t k) {
+      return icons[k].data() == icon.data() ||
+             (icons[k].hash() == icon.hash() && icons[k].size() == icon.size() &&
+              std::equal(icon.begin(), icon.end(), icons[k].begin()));
+    };
+    size_t id = 0;
+    while (id < icons.size() && not same(id)) ++id;
+    if (id == icons.size()) {
+      if (icons.size() == mixer::NO_ICON) {
+        continue;
+      }
+      icons.push_back(std::move(icon));
+    }
+    icon_ids[i] = static_cast<uint8_t>(id);
+  }
+  DEBUG_PRINT("\tSessions: " << n_sessions << " icons: " << icons.size() << '\n');
 
-    auto data = wait_data(port, 5);
-    if (data.size() >= 5 && CRC::verify_crc(data.data(), 5) && data[0] == mixer::commands::RESPONSE_OK) {
-    } else {
-      DEBUG_PRINT("\tchunk fail");
+  // counts, then the pid -> icon id table, then the size of each icon
+  Hasher hasher;
+  hasher.append(static_cast<uint8_t>(n_sessions));
+  hasher.append(static_cast<uint8_t>(icons.size()));
+  hasher.compute_crc();
+  for (size_t i = 0; i < n_sessions; ++i) {
+    hasher.append(static_cast<int16_t>(snapshot.pids()[rows[i]]));
+    hasher.append(icon_ids[i]);
+  }
+  hasher.compute_crc();
+  for (const auto& icon : icons) {
+    hasher.append(static_cast<uint32_t>(icon.size()));
+  }
+  hasher.compute_crc();
+  port.write(hasher.get_buffer().data(), hasher.get_buffer().size());
+
+  record_latency(start);
+
+  uint32_t max_chunk_size = 0;
+  if (not wait_chunk_size(port, max_chunk_size)) {
+    return;
+  }
+  for (const auto& icon : icons) {
+    if (not send_chunks(port, icon, max_chunk_size)) {
       return;
     }
   }
-  DEBUG_PRINT("\tSend IMG success\n");
+  DEBUG_PRINT("\tSend all IMG success\n");
+}
+
+
+
+void respond_query_icon_hash(Channel& port) {
+  const auto snapshot = VolumeControl::get_session_snapshot();
+  const auto rows = pid_rows(snapshot);
+  const size_t n_sessions = std::min<size_t>(rows.size(), 255);
+
+  // only the hashes stored with the cached icons are sent, nothing is extracted or encoded here. An icon that isn't
+  // cached yet gets the hash 0 and is fetched in the background, the board asks again later
+  Hasher hasher;
+  hasher.append(static_cast<uint8_t>(n_sessions));
+  hasher.compute_crc();
+  for (size_t i = 0; i < n_sessions; ++i) {
+    hasher.append(static_cast<int16_t>(snapshot.pids()[rows[i]]));
+    hasher.append(snapshot.record(rows[i])->icon_hash());
+  }
+  hasher.compute_crc();
+  DEBUG_PRINT("\t data length: " << hasher.get_buffer().size() << '\n');
+  port.write(hasher.get_buffer().data(), hasher.get_buffer().size());
 }
 
 
 
-std::vector<uint8_t> wait_data(SerialPortWrapper& port, size_t n) {
+std::vector<uint8_t> wait_data(Channel& port, size_t n) {
   std::vector<uint8_t> buff;
   using namespace std::chrono_literals;
 
@@ -211,7 +791,12 @@ std::vector<uint8_t> wait_data(SerialPortWrapper& port, size_t n) {
 
   while (buff.size() < n) {
     uint8_t b;
-    if (port.read(&b, 1)) {
+    const int read = port.read(&b, 1);
+    if (read < 0) {
+      DEBUG_PRINT("Frame dropped\n");
+      return {};
+    }
+    if (read) {
       buff.push_back(b);
     }
 
@@ -225,72 +810,222 @@ std::vector<uint8_t> wait_data(SerialPortWrapper& port, size_t n) {
 }
 
 
-void respond_set_volume(SerialPortWrapper& port) {
-  constexpr size_t expected_length = sizeof(int16_t) + sizeof(uint8_t) + 4;
-  const auto vol_data = wait_data(port, expected_length);
-  if (vol_data.size() < expected_length) {
-    DEBUG_PRINT("\t No data\n");
-    return;
-  }
-
-  if (not CRC::verify_crc(vol_data.data(), expected_length)) {
-    DEBUG_PRINT("\tCRC error\n");
+void respond_set_volume(Channel& port) {
+  const auto vol_data = wait_message<mixer::SetVolumeRequest>(port);
+  if (vol_data.empty()) {
     return;
   }
 
-  const int16_t pid = mem2T<int16_t>(vol_data.data());
-  const uint8_t vol = mem2T<uint8_t>(vol_data.data() + 2);
+  const mixer::SetVolumeRequest::View req(vol_data.data());
+  const int16_t pid = req.get<mixer::fields::Pid>();
+  const uint8_t vol = req.get<mixer::fields::Volume>();
 
   VolumeControl::set_volume(pid, vol);
+  {
+    // the board knows the volume it set, it's no change to report
+    std::lock_guard lock(tracker_mutex);
+    session_tracker.set_volume(pid, vol);
+  }
 
   DEBUG_PRINT("\tDone\n");
 }
 
-void respond_echo(SerialPortWrapper& port) {
+void respond_echo(Channel& port) {
   uint8_t c = '\0';
-  while (port.read(&c, 1)) {
+  while (port.read(&c, 1) > 0) {
     std::cout << static_cast<char>(c);
   }
 }
 
-void respond_mute(SerialPortWrapper& port) {
-  const auto mute_data = wait_data(port, 2 + 1 + 4);  // pid, muted, crc
-  if (mute_data.size() < 2 + 1 + 4) {
-    DEBUG_PRINT("\t No data\n");
-    return;
-  }
-  if (not CRC::verify_crc(mute_data.data(), 2 + 1 + 4)) {
-    DEBUG_PRINT("\tCRC error\n");
+void respond_mute(Channel& port) {
+  const auto mute_data = wait_message<mixer::SetMuteRequest>(port);
+  if (mute_data.empty()) {
     return;
   }
 
-  const int16_t pid = mem2T<int16_t>(mute_data.data());
-  const bool mute = mem2T<uint8_t>(mute_data.data() + 2);
+  const mixer::SetMuteRequest::View req(mute_data.data());
+  const int16_t pid = req.get<mixer::fields::Pid>();
+  const bool mute = req.get<mixer::fields::Muted>();
 
   VolumeControl::set_muted(pid, mute);
+  std::lock_guard lock(tracker_mutex);
+  session_tracker.set_muted(pid, mute);
 }
 
 
 
-void respond_query_changes(SerialPortWrapper& port) {
-  bool changed = glob_last_crc != compute_session_checksum(VolumeControl::get_all_sessions_info());
-  Hasher crc;
+void respond_query_changes(Channel& port) {
+  const auto sessions = VolumeControl::get_session_snapshot();
+  bool changed;
+  {
+    std::lock_guard lock(tracker_mutex);
+    changed = session_tracker.changed(sessions);
+  }
   DEBUG_PRINT("\tchange: " << changed << '\n');
-  crc.append(static_cast<uint8_t>(changed));
-  crc.compute_crc();
-  port.write(crc.get_buffer().data(), crc.get_buffer().size());
+  write_message<mixer::ChangesReply>(port, changed);
+}
+
+void respond_query_changed_sessions(Channel& port) {
+  const auto sessions = VolumeControl::get_session_snapshot();
+  std::vector<ChangeTracker::Entry> changes;
+  {
+    std::lock_guard lock(tracker_mutex);
+    changes = session_tracker.diff_pids(sessions);
+  }
+  DEBUG_PRINT("\tchanged sessions: " << changes.size() << '\n');
+
+  // a long list costs more than loading all sessions again
+  Hasher hasher;
+  if (changes.size() > mixer::MAX_CHANGED_SESSIONS) {
+    hasher.append(mixer::TOO_MANY_CHANGES);
+  } else {
+    hasher.append(static_cast<uint8_t>(changes.size()));
+    for (const auto& change : changes) {
+      hasher.append(change.pid_);
+      hasher.append(change.change_);
+    }
+  }
+  hasher.compute_crc();
+  port.write(hasher.get_buffer().data(), hasher.get_buffer().size());
+}
+
+void respond_stream_meters(Channel& port) {
+  const auto data = wait_message<mixer::MeterStreamRequest>(port);
+  if (data.empty()) {
+    return;
+  }
+  const unsigned rate = std::clamp(mixer::MeterStreamRequest::View(data.data()).get<mixer::fields::MeterRate>(),
+                                   mixer::MIN_METER_RATE, mixer::MAX_METER_RATE);
+  write_message<mixer::Ack>(port, mixer::commands::RESPONSE_OK);
+  port.end_message();
+
+  MeterStream stream(rate);
+  const auto period = std::chrono::microseconds(1'000'000 / rate);
+  auto next = std::chrono::steady_clock::now();
+  do {
+    const auto frame = stream.tick(VolumeControl::get_meter_samples());
+    if (not frame.empty()) {
+      // sending blocks behind control frames, a slow link gets fewer ticks instead of a backlog
+      port.write(frame.data(), frame.size());
+      port.end_message();
+    }
+    next = std::max(next + period, std::chrono::steady_clock::now());
+  } while (not port.wait_input(next));
+
+  const uint8_t end = MeterStream::END;
+  port.write(&end, 1);
+  const auto& stats = stream.stats();
+  DEBUG_PRINT("\tmeter ticks: " << stats.ticks_ << ", frames: " << stats.frames_ << ", bytes: " << stats.bytes_
+                                << '\n');
+}
+
+void respond_load_top(Channel& port) {
+  using Encoding = FrameCache::Encoding;
+  const auto request = wait_message<mixer::LoadTopRequest>(port);
+  if (request.empty()) {
+    return;
+  }
+  const uint8_t slots = mixer::LoadTopRequest::View(request.data()).get<mixer::fields::Slots>();
+  {
+    std::lock_guard lock(activity_mutex);
+    if (not activity_sampler) {
+      // the first request ranks by what is playing now, the sampler takes over from there
+      session_ranking.update(VolumeControl::get_meter_samples());
+      activity_sampler =
+          std::make_unique<ActivitySampler>(session_ranking, mixer::ACTIVITY_PERIOD, mixer::ACTIVITY_IDLE);
+    } else {
+      activity_sampler->request();
+    }
+  }
+  const auto ranked = session_ranking.top(slots);
+  const auto snapshot = VolumeControl::get_session_snapshot();
+  const uint64_t generation = load_cache.update(snapshot.generation());
+
+  // the first session of each ranked pid, in their order. A session the ranking doesn't know yet waits for the
+  // sampler
+  std::vector<size_t> selected;
+  std::vector<int16_t> order;
+  for (const int pid : ranked) {
+    const size_t i = snapshot.find(pid);
+    if (i != snapshot.npos && selected.size() < slots) {
+      selected.push_back(i);
+      order.push_back(static_cast<int16_t>(pid));
+    }
+  }
+
+  // keyed on the order itself, a hash of it could return the frame of other sessions
+  auto frame = load_cache.find(generation, Encoding::LOAD_TOP, 0, order);
+  if (not frame) {
+    frame = load_cache.put(generation, Encoding::LOAD_TOP, 0, encode_load(snapshot, selected), order);
+  }
+  DEBUG_PRINT("\t top " << selected.size() << " of " << snapshot.size() << " sessions, data length: "
+                        << frame->size() << '\n');
+  print_load_cache_stats();
+  port.write(frame->data(), frame->size());
+
+  // the board doesn't hold every session, QUERY_CHANGED_SESSIONS keeps comparing against the last full list
+  const bool ok = wait_ack(port) == mixer::commands::RESPONSE_OK;
+  DEBUG_PRINT((ok ? "\tsend success\n" : "\tsend failure\n"));
 }
 
+void respond_pin_session(Channel& port) {
+  const auto data = wait_message<mixer::PinRequest>(port);
+  if (data.empty()) {
+    return;
+  }
+  const mixer::PinRequest::View req(data.data());
+  session_ranking.set_pinned(req.get<mixer::fields::Pid>(), req.get<mixer::fields::Pinned>());
+  write_message<mixer::Ack>(port, mixer::commands::RESPONSE_OK);
+}
 
-static uint32_t compute_session_checksum(const std::vector<VolumeControl::AudioSessionInfo>& sessions) {
-  Hasher crc;
-  for (const auto& session : sessions) {
-    crc.append(session.pid_);
-    crc.append(session.volume_);
-    crc.append(session.muted_);
-    const wchar_t* c_str = session.filename_.c_str();
-    crc.append_buff(c_str, sizeof(wchar_t) * (1 + session.filename_.size()));
+void respond_load_endpoints(Channel& port) {
+  const auto endpoints = VolumeControl::get_endpoints();
+
+  // laid out like LOAD_ALL, the name is sent in UTF-8
+  Hasher sv;
+  sv.append(static_cast<uint8_t>(endpoints.size()));
+  sv.compute_crc();
+  for (const auto& endpoint : endpoints) {
+    sv.append(endpoint.id_);
+    sv.append(static_cast<uint8_t>(endpoint.default_));
+    append_name(sv, endpoint.name_utf8_);
   }
+  DEBUG_PRINT("\t endpoints: " << endpoints.size() << '\n');
+  port.write(sv.get_buffer().data(), sv.get_buffer().size());
+}
+
 
-  return crc.compute_crc();
+/// @brief Scheduling class of the responses to command @p c
+static FramePriority priority_of(uint8_t c) {
+  switch (c) {
+    case mixer::commands::LOAD_ALL:
+    case mixer::commands::LOAD_ALL_COMPACT:
+    case mixer::commands::READ_IMG:
+    case mixer::commands::READ_IMG_RAW:
+    case mixer::commands::READ_ALL_IMG:
+    case mixer::commands::READ_IMG_RESUME:
+    case mixer::commands::STREAM_METERS:
+    case mixer::commands::LOAD_TOP:
+      return FramePriority::BULK;
+    default:
+      return FramePriority::CONTROL;
+  }
+}
+
+void respond_enable_framing(PortChannel& port) {
+  // acknowledged in raw mode, everything after is framed
+  write_message<mixer::Ack>(port, mixer::commands::RESPONSE_OK);
+  port.set_framed(true);
+}
+
+void respond_enable_tags(PortChannel& port) {
+  // tags need frames, to tell the requests apart
+  const bool ok = port.is_framed();
+  write_message<mixer::Ack>(port, ok ? mixer::commands::RESPONSE_OK : mixer::commands::RESPONSE_FAIL);
+  port.end_message();
+  if (ok) {
+    auto created = std::make_unique<Multiplexer>(port, dispatch, priority_of);
+    std::lock_guard lock(multiplexer_mutex);
+    multiplexer.swap(created);
+  }
 }
\ No newline at end of file
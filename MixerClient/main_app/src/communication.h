@@ -1,6 +1,10 @@
 #pragma once
+#include <chrono>
 #include <cstdint>
-#include "SerialPortWrapper/SerialPortWrapper.h"
+#include "channel.h"
+#include "CommSupervisor/schema.h"
+#include "frame_cache.h"
+#include "latency_stats.h"
 #include <vector>
 #include <iostream>
 
@@ -20,18 +24,136 @@ namespace mixer {
     ECHO = 0x04,
     SET_MUTE = 0x05,
     QUERY_CHANGES = 0x06,
+    READ_IMG_RAW = 0x07,
+    READ_ALL_IMG = 0x08,
+    QUERY_ICON_HASH = 0x09,  ///< the CRC of each session's icon, 0 if it isn't known yet
+    READ_IMG_RESUME = 0x0A,
+    ENABLE_FRAMING = 0x0B,
+    ENABLE_TAGS = 0x0C,
+    LOAD_ALL_COMPACT = 0x0D,
+    QUERY_CHANGED_SESSIONS = 0x0E,
+    STREAM_METERS = 0x0F,
+    LOAD_TOP = 0x10,
+    PIN_SESSION = 0x11,
+    LOAD_ENDPOINTS = 0x12,
     RESPONSE_OK = 0xA0,
     RESPONSE_FAIL = 0xB0,
   };
+
+  /// @brief flags of READ_IMG_RAW
+  enum raw_flags : uint8_t {
+    KEEP_ALPHA = 0x01,  ///< append alpha to each pixel, instead of blending over the background
+    SWAP_BYTES = 0x02,  ///< RGB565 pixels are sent big-endian
+  };
+
+  /// @brief set in the chunk size sent by the board, if it accepts chunks of any size up to the limit.
+  /// Each chunk is then preceded by its length, and a rejected chunk is sent again
+  constexpr uint32_t ADAPTIVE_CHUNKS = 0x80000000;
+
+  /// @brief icon id of sessions without an icon, in the READ_ALL_IMG table
+  constexpr uint8_t NO_ICON = 0xFF;
+
+  /// @brief flags of LOAD_ALL_COMPACT, in the request and in the response
+  enum load_flags : uint8_t {
+    CLEAR_NAMES = 0x01,  ///< request: the board lost its filename dictionary, response: clear it before reading
+    WITH_ENDPOINTS = 0x02,  ///< request and response: each session carries the id of its device, see LOAD_ENDPOINTS
+    INLINE_NAMES = 0x04,    ///< response: more names than the dictionary holds, each is sent without an index
+  };
+
+  /// @brief set in the packed volume byte of LOAD_ALL_COMPACT, the volume is in the low 7 bits
+  constexpr uint8_t MUTED_BIT = 0x80;
+
+  /// @brief most sessions listed by QUERY_CHANGED_SESSIONS, the board loads all sessions again beyond that
+  constexpr uint8_t MAX_CHANGED_SESSIONS = 32;
+
+  /// @brief count of the QUERY_CHANGED_SESSIONS response, if more sessions changed
+  constexpr uint8_t TOO_MANY_CHANGES = 0xFF;
+
+  /// @brief ticks per second of STREAM_METERS, the requested rate is clamped to these
+  constexpr uint8_t MIN_METER_RATE = 20;
+  constexpr uint8_t MAX_METER_RATE = 60;
+
+  /// @brief half-life of the audio activity, which ranks the sessions of LOAD_TOP
+  constexpr auto ACTIVITY_HALF_LIFE = std::chrono::seconds(10);
+
+  /// @brief period of the meter readings, which feed the ranking of LOAD_TOP
+  constexpr auto ACTIVITY_PERIOD = std::chrono::milliseconds(100);
+
+  /// @brief the meters aren't read for the ranking, after this long without LOAD_TOP
+  constexpr auto ACTIVITY_IDLE = std::chrono::seconds(30);
+
+  /// @brief fields of the fixed layout messages
+  namespace fields {
+    struct Pid : Schema::Field<int16_t> {};
+    struct Status : Schema::Field<uint8_t> {};  ///< RESPONSE_OK or RESPONSE_FAIL
+    struct Volume : Schema::Field<uint8_t> {};
+    struct Muted : Schema::Field<bool> {};
+    struct Changed : Schema::Field<bool> {};
+    struct PixelFormat : Schema::Field<uint8_t> {};
+    struct RawFlags : Schema::Field<uint8_t> {};  ///< raw_flags
+    struct Width : Schema::Field<uint16_t> {};
+    struct Height : Schema::Field<uint16_t> {};
+    struct Background : Schema::Field<uint32_t> {};
+    struct IconHash : Schema::Field<uint32_t> {};
+    struct Offset : Schema::Field<uint32_t> {};
+    struct ImageSize : Schema::Field<uint32_t> {};
+    struct ChunkSize : Schema::Field<uint32_t> {};  ///< may have ADAPTIVE_CHUNKS set
+    struct LoadFlags : Schema::Field<uint8_t> {};   ///< load_flags
+    struct MeterRate : Schema::Field<uint8_t> {};   ///< ticks per second
+    struct Slots : Schema::Field<uint8_t> {};       ///< sessions the board can show
+    struct Pinned : Schema::Field<bool> {};
+  }  // namespace fields
+
+  using Ack = Schema::Message<fields::Status>;
+  using ChunkSizeMessage = Schema::Message<fields::ChunkSize>;
+  using ImageSizeMessage = Schema::Message<fields::ImageSize>;
+  using ImgRequest = Schema::Message<fields::Pid>;
+  using ImgRawRequest = Schema::Message<fields::Pid, fields::PixelFormat, fields::RawFlags, fields::Width,
+                                        fields::Height, fields::Background>;
+  using ImgResumeRequest = Schema::Message<fields::Pid, fields::IconHash, fields::Offset>;
+  using ImgResumeReply = Schema::Message<fields::Status, fields::ImageSize>;
+  using SetVolumeRequest = Schema::Message<fields::Pid, fields::Volume>;
+  using SetMuteRequest = Schema::Message<fields::Pid, fields::Muted>;
+  using ChangesReply = Schema::Message<fields::Changed>;
+  using LoadCompactRequest = Schema::Message<fields::LoadFlags>;
+  using MeterStreamRequest = Schema::Message<fields::MeterRate>;
+  using LoadTopRequest = Schema::Message<fields::Slots>;
+  using PinRequest = Schema::Message<fields::Pid, fields::Pinned>;
 }
 
-std::vector<uint8_t> wait_data(SerialPortWrapper&, size_t);
+std::vector<uint8_t> wait_data(Channel&, size_t);
+
+/// @brief Receive and handle a command, or with tagged requests, route a frame
+/// @return false if the board stopped responding
+bool serial_comm(PortChannel&);
+
+/// @brief Stop the requests in progress, before the port is closed
+void serial_close();
+
+/// @brief Counters of the cache of encoded session lists
+FrameCache::Stats get_load_cache_stats();
+
+/// @brief First byte latency of the last icon requests, from the command to the first byte of the response
+LatencyStats get_img_latency_stats();
 
-bool serial_comm(SerialPortWrapper&);
+/// @brief Queuing delay of the last control frames with tagged requests, empty while the board doesn't use them
+LatencyStats get_control_delay_stats();
 
-void respond_load(SerialPortWrapper&);
-void respond_img(SerialPortWrapper&);
-void respond_set_volume(SerialPortWrapper&);
-void respond_echo(SerialPortWrapper&);
-void respond_mute(SerialPortWrapper&);
-void respond_query_changes(SerialPortWrapper&);
\ No newline at end of file
+void respond_load(Channel&);
+void respond_load_compact(Channel&);
+void respond_img(Channel&);
+void respond_img_raw(Channel&);
+void respond_img_resume(Channel&);
+void respond_img_all(Channel&);
+void respond_query_icon_hash(Channel&);
+void respond_set_volume(Channel&);
+void respond_echo(Channel&);
+void respond_mute(Channel&);
+void respond_query_changes(Channel&);
+void respond_query_changed_sessions(Channel&);
+void respond_stream_meters(Channel&);
+void respond_load_top(Channel&);
+void respond_pin_session(Channel&);
+void respond_load_endpoints(Channel&);
+void respond_enable_framing(PortChannel&);
+void respond_enable_tags(PortChannel&);
\ No newline at end of file
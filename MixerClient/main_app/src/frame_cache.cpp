@@ -0,0 +1,40 @@
+#include "frame_cache.h"
+
+
+uint64_t FrameCache::update(uint64_t generation) {
+  std::lock_guard lock(mutex_);
+  if (generation != generation_) {
+    generation_ = generation;
+    ++stats_.generations_;
+    frames_.clear();
+  }
+  return generation_;
+}
+
+FrameCache::frame_t FrameCache::find(uint64_t generation, Encoding encoding, uint64_t variant,
+                                     const std::vector<int16_t>& pids) {
+  std::lock_guard lock(mutex_);
+  if (generation == generation_) {
+    if (const auto it = frames_.find({ encoding, variant, pids }); it != frames_.end()) {
+      ++stats_.hits_;
+      return it->second;
+    }
+  }
+  ++stats_.misses_;
+  return nullptr;
+}
+
+FrameCache::frame_t FrameCache::put(uint64_t generation, Encoding encoding, uint64_t variant,
+                                    std::vector<uint8_t> frame, const std::vector<int16_t>& pids) {
+  auto stored = std::make_shared<const std::vector<uint8_t>>(std::move(frame));
+  std::lock_guard lock(mutex_);
+  if (generation == generation_) {
+    frames_[{ encoding, variant, pids }] = stored;
+  }
+  return stored;
+}
+
+FrameCache::Stats FrameCache::stats() const {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+
+/// @brief Encoded session list responses, kept while the sessions don't change.
+///
+/// The frames are keyed on the generation of the session snapshot, which changes whenever a session is added,
+/// removed or changed. Responses are cached per encoding and variant, the state the encoding depends on besides the
+/// sessions, and per list of pids, if the request selects the sessions. All of them are dropped with a new
+/// generation. A repeated request then costs an enumeration of the sessions, without resolving or hashing them, and a
+/// single write.
+class FrameCache {
+public:
+  enum class Encoding : uint8_t {
+    LOAD_ALL,
+    LOAD_ALL_COMPACT,
+    LOAD_TOP,  ///< keyed on the selected pids, in order
+  };
+
+  /// @brief Counters since start
+  struct Stats {
+    uint32_t hits_;
+    uint32_t misses_;
+    uint32_t generations_;  ///< snapshots seen, each one invalidated the cache
+  };
+
+  using frame_t = std::shared_ptr<const std::vector<uint8_t>>;
+
+  /// @brief Switch to the snapshot of @p generation, dropping the cached frames if it changed
+  /// @param generation SessionSnapshot::generation() of the sessions the frames encode
+  /// @return @p generation, for find() and put()
+  uint64_t update(uint64_t generation);
+
+  /// @brief Get the frame cached for @p generation, counts a hit or a miss
+  /// @param pids the sessions the frame lists, in order, for the encodings which select them
+  /// @return nullptr if there is none, or the generation is outdated
+  frame_t find(uint64_t generation, Encoding encoding, uint64_t variant, const std::vector<int16_t>& pids = {});
+
+  /// @brief Keep @p frame for @p generation, it isn't kept if the generation is outdated
+  /// @return the frame
+  frame_t put(uint64_t generation, Encoding encoding, uint64_t variant, std::vector<uint8_t> frame,
+              const std::vector<int16_t>& pids = {});
+
+  [[nodiscard]] Stats stats() const;
+
+private:
+  mutable std::mutex mutex_;
+  uint64_t generation_ = 0;  ///< 0 before the first snapshot
+  std::map<std::tuple<Encoding, uint64_t, std::vector<int16_t>>, frame_t> frames_;
+  Stats stats_{};
+};
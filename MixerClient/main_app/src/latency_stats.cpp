@@ -0,0 +1,28 @@
+#include "latency_stats.h"
+#include <algorithm>
+#include <cmath>
+
+
+LatencyStats::LatencyStats(size_t capacity) : capacity_(capacity) {
+  samples_.reserve(capacity);
+}
+
+void LatencyStats::add(duration_t sample) {
+  if (samples_.size() < capacity_) {
+    samples_.push_back(sample);
+  } else {
+    samples_[next_] = sample;
+    next_ = (next_ + 1) % capacity_;
+  }
+}
+
+LatencyStats::duration_t LatencyStats::percentile(double p) const {
+  if (samples_.empty()) {
+    return duration_t::zero();
+  }
+  auto sorted = samples_;
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  const size_t idx = std::min(sorted.size() - 1, rank ? rank - 1 : 0);
+  std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+  return sorted[idx];
+}
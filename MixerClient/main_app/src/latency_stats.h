@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+
+/// @brief Keeps the most recent latency samples, and computes percentiles over them
+class LatencyStats {
+public:
+  using duration_t = std::chrono::microseconds;
+
+  explicit LatencyStats(size_t capacity = 256);
+
+  void add(duration_t sample);
+
+  /// @brief Get the @p p th percentile of the kept samples
+  /// @param p percentile in [0, 100]
+  /// @return the percentile, 0 if there are no samples
+  [[nodiscard]] duration_t percentile(double p) const;
+
+  [[nodiscard]] size_t count() const {
+    return samples_.size();
+  }
+
+private:
+  const size_t capacity_;
+  size_t next_ = 0;  ///< slot of the next sample, once full
+  std::vector<duration_t> samples_;
+};
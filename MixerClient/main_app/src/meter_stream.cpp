@@ -0,0 +1,114 @@
+#include "meter_stream.h"
+#include "CommSupervisor/varint.h"
+#include <algorithm>
+#include <cmath>
+
+
+MeterStream::MeterStream(unsigned rate)
+    : smoothing_(1.0f - std::exp(-1.0f / (0.3f * static_cast<float>(rate)))),
+      key_interval_(rate),
+      idle_interval_(std::max(1u, rate / 4)) {
+}
+
+uint8_t MeterStream::quantize(float peak) {
+  if (not (peak > 0.001f)) {
+    return 0;
+  }
+  const float db = 20.0f * std::log10(peak);
+  return static_cast<uint8_t>(std::clamp(1 + static_cast<int>((db + 60.0f) / 4.0f), 1, 15));
+}
+
+void MeterStream::rekey(const std::vector<VolumeControl::MeterSample>& samples) {
+  pids_.resize(samples.size());
+  mean_square_.resize(samples.size());
+  for (size_t i = 0; i < samples.size(); ++i) {
+    pids_[i] = samples[i].pid_;
+    mean_square_[i] = samples[i].peak_ * samples[i].peak_;
+  }
+  levels_.assign(samples.size(), 0);
+  sent_.clear();
+}
+
+std::vector<uint8_t> MeterStream::tick(const std::vector<VolumeControl::MeterSample>& samples) {
+  ++stats_.ticks_;
+  ++since_key_;
+  ++since_frame_;
+
+  const bool same_sessions = samples.size() == pids_.size() &&
+      std::equal(samples.begin(), samples.end(), pids_.begin(), [](const auto& s, int pid) { return s.pid_ == pid; });
+  if (not same_sessions) {
+    rekey(samples);
+  }
+
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const float peak = samples[i].peak_;
+    mean_square_[i] += smoothing_ * (peak * peak - mean_square_[i]);
+    levels_[i] = static_cast<uint8_t>(quantize(peak) << 4 | quantize(std::sqrt(mean_square_[i])));
+  }
+
+  std::vector<uint8_t> frame;
+  const bool changed = levels_ != sent_;
+  changed_since_key_ = changed_since_key_ || changed;
+  if (sent_.empty() || (changed_since_key_ && since_key_ >= key_interval_)) {
+    // a board that lost a frame is in sync again after the next key frame
+    encode_key(frame);
+    since_key_ = 0;
+    changed_since_key_ = false;
+  } else if (changed) {
+    encode_changes(frame);
+  } else if (since_frame_ >= idle_interval_) {
+    frame.push_back(IDLE);
+  } else {
+    return frame;
+  }
+
+  sent_ = levels_;
+  since_frame_ = 0;
+  ++stats_.frames_;
+  stats_.bytes_ += frame.size();
+  return frame;
+}
+
+void MeterStream::encode_key(std::vector<uint8_t>& frame) const {
+  const size_t n = pids_.size();
+  frame.reserve(1 + Varint::max_size + 3 * n);
+  frame.push_back(KEY);
+  // one byte up to 127 sessions, a longer list doesn't wrap the count
+  uint8_t count[Varint::max_size];
+  frame.insert(frame.end(), count, count + Varint::encode(n, count));
+  for (const int pid : pids_) {
+    frame.push_back(static_cast<uint8_t>(pid));
+    frame.push_back(static_cast<uint8_t>(pid >> 8));
+  }
+  frame.insert(frame.end(), levels_.begin(), levels_.end());
+}
+
+void MeterStream::encode_changes(std::vector<uint8_t>& frame) const {
+  const size_t n = levels_.size();
+  frame.push_back(DELTA);
+  // stops early, once the runs are longer than all levels
+  for (size_t i = 0; i < n && frame.size() <= n + 1;) {
+    size_t skip = 0;
+    while (i + skip < n && skip < 255 && levels_[i + skip] == sent_[i + skip]) {
+      ++skip;
+    }
+    if (i + skip == n) {
+      break;
+    }
+    i += skip;
+    size_t count = 0;
+    while (i + count < n && count < 255 && levels_[i + count] != sent_[i + count]) {
+      ++count;
+    }
+    frame.push_back(static_cast<uint8_t>(skip));
+    frame.push_back(static_cast<uint8_t>(count));
+    frame.insert(frame.end(), levels_.begin() + i, levels_.begin() + i + count);
+    i += count;
+  }
+
+  // one byte per session is the most a tick costs
+  if (frame.size() > n + 1) {
+    frame.assign(1, LEVELS);
+    frame.insert(frame.end(), levels_.begin(), levels_.end());
+  }
+}
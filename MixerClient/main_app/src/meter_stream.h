@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+
+/// @brief Turns meter samples into the compact frames of STREAM_METERS.
+///
+/// Each session gets one level byte per tick, the peak in the high nibble and the RMS in the low nibble. Both are in
+/// 4 dB steps above -60 dB, 0 is silence. The audio API only meters peaks, the RMS is that of the peaks over about
+/// 300 ms. A key frame lists the pids, the frames after it refer to the sessions by their position in it:
+///
+///     KEY     count (varint), count x pid (int16), count x level
+///     LEVELS  count x level
+///     DELTA   runs of: sessions to skip, n changed sessions, n x level. Sessions after the last run didn't change
+///     IDLE    nothing changed, sent now and then, so the board knows the stream is alive
+///     END     the stream stopped
+///
+/// Each frame starts with its kind. Ticks without changes send nothing, apart from the IDLE frames.
+class MeterStream {
+public:
+  enum Kind : uint8_t {
+    KEY = 0x01,
+    LEVELS = 0x02,
+    DELTA = 0x03,
+    IDLE = 0x04,
+    END = 0x05,
+  };
+
+  struct Stats {
+    uint64_t ticks_;
+    uint64_t frames_;
+    uint64_t bytes_;  ///< payload of the frames
+  };
+
+  /// @param rate ticks per second
+  explicit MeterStream(unsigned rate);
+
+  /// @brief Encode the levels of one tick
+  /// @param samples sorted by pid, as get_meter_samples() returns them
+  /// @return the frame, empty if there is nothing to send
+  std::vector<uint8_t> tick(const std::vector<VolumeControl::MeterSample>& samples);
+
+  /// @brief Level of @p peak as a nibble: 0 below -60 dB, then 4 dB steps up to 15
+  [[nodiscard]] static uint8_t quantize(float peak);
+
+  [[nodiscard]] const Stats& stats() const {
+    return stats_;
+  }
+
+private:
+  /// @brief Start over with the sessions of @p samples
+  void rekey(const std::vector<VolumeControl::MeterSample>& samples);
+
+  void encode_key(std::vector<uint8_t>& frame) const;
+
+  /// @brief Encode the levels, which differ from the ones sent before, or all of them if that's shorter
+  void encode_changes(std::vector<uint8_t>& frame) const;
+
+  const float smoothing_;           ///< weight of a new peak in the mean square
+  const uint32_t key_interval_;     ///< ticks between key frames, while the levels change
+  const uint32_t idle_interval_;    ///< ticks between IDLE frames
+  std::vector<int> pids_;           ///< sessions of the last key frame
+  std::vector<float> mean_square_;  ///< smoothed square of the peaks, parallel to pids_
+  std::vector<uint8_t> levels_;     ///< levels of this tick, parallel to pids_
+  std::vector<uint8_t> sent_;       ///< levels the board has, parallel to pids_
+  uint32_t since_key_ = 0;
+  uint32_t since_frame_ = 0;
+  bool changed_since_key_ = false;
+  Stats stats_{};
+};
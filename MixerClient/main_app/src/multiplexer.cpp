@@ -0,0 +1,209 @@
+#include "multiplexer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "communication.h"
+
+
+TaggedChannel::TaggedChannel(Multiplexer& mux, uint8_t tag, FramePriority priority)
+    : mux_(mux),
+      tag_(tag),
+      priority_(priority),
+      frame_limit_(priority == FramePriority::BULK ? Multiplexer::bulk_frame_size : FrameBuffer::max_payload) {
+}
+
+int TaggedChannel::write(const uint8_t* data, size_t len) {
+  for (size_t done = 0; done < len;) {
+    if (out_.size() == frame_limit_) {
+      flush();
+    }
+    if (out_.size() == 0) {
+      out_.append(&tag_, 1);
+    }
+    done += out_.append(data + done, std::min(len - done, frame_limit_ - out_.size()));
+  }
+  return static_cast<int>(len);
+}
+
+void TaggedChannel::flush() {
+  if (out_.size()) {
+    mux_.send(out_, priority_);
+  }
+}
+
+int TaggedChannel::read(uint8_t* data, size_t len) {
+  using namespace std::chrono_literals;
+  flush();
+
+  if (in_pos_ == in_.size()) {
+    std::unique_lock lock(mutex_);
+    // wait_data() polls, so block a little instead of spinning
+    cv_.wait_for(lock, 100ms, [this]() { return closed_ || not mailbox_.empty(); });
+    if (mailbox_.empty()) {
+      return closed_ ? -1 : 0;
+    }
+    in_ = std::move(mailbox_.front());
+    mailbox_.pop_front();
+    in_pos_ = 0;
+  }
+
+  const size_t n = std::min(len, in_.size() - in_pos_);
+  std::memcpy(data, in_.data() + in_pos_, n);
+  in_pos_ += n;
+  return static_cast<int>(n);
+}
+
+void TaggedChannel::end_message() {
+  flush();
+  in_pos_ = in_.size();
+}
+
+bool TaggedChannel::take_error() {
+  // dropped frames can't be attributed to a tag, the request times out instead
+  return false;
+}
+
+bool TaggedChannel::wait_input(std::chrono::steady_clock::time_point deadline) {
+  if (in_pos_ < in_.size()) {
+    return true;
+  }
+  std::unique_lock lock(mutex_);
+  return cv_.wait_until(lock, deadline, [this]() { return closed_ || not mailbox_.empty(); });
+}
+
+void TaggedChannel::deliver(const uint8_t* data, size_t len) {
+  {
+    std::lock_guard lock(mutex_);
+    mailbox_.emplace_back(data, data + len);
+  }
+  cv_.notify_one();
+}
+
+void TaggedChannel::close() {
+  {
+    std::lock_guard lock(mutex_);
+    closed_ = true;
+  }
+  cv_.notify_one();
+}
+
+
+Multiplexer::Multiplexer(PortChannel& port, handler_t handler, classifier_t classify)
+    : port_(port), handler_(std::move(handler)), classify_(std::move(classify)) {
+}
+
+Multiplexer::~Multiplexer() {
+  for (auto& [tag, request] : requests_) {
+    request->channel_->close();
+  }
+  for (auto& [tag, request] : requests_) {
+    request->worker_.join();
+  }
+}
+
+bool Multiplexer::is_turn(FramePriority priority, uint64_t ticket) const {
+  constexpr auto control = static_cast<size_t>(FramePriority::CONTROL);
+  constexpr auto bulk = static_cast<size_t>(FramePriority::BULK);
+  const auto p = static_cast<size_t>(priority);
+  if (writing_ || serving_[p] != ticket) {
+    return false;
+  }
+  const bool control_waiting = next_ticket_[control] != serving_[control];
+  const bool bulk_waiting = next_ticket_[bulk] != serving_[bulk];
+  if (priority == FramePriority::CONTROL) {
+    return not bulk_waiting || control_streak_ < bulk_share;
+  }
+  return not control_waiting || control_streak_ >= bulk_share;
+}
+
+void Multiplexer::send(FrameBuffer& frame, FramePriority priority) {
+  const auto p = static_cast<size_t>(priority);
+  const auto queued = std::chrono::steady_clock::now();
+
+  std::unique_lock lock(write_mutex_);
+  const uint64_t ticket = next_ticket_[p]++;
+  write_cv_.wait(lock, [&]() { return is_turn(priority, ticket); });
+  writing_ = true;
+
+  if (priority == FramePriority::CONTROL) {
+    const auto delay =
+        std::chrono::duration_cast<LatencyStats::duration_t>(std::chrono::steady_clock::now() - queued);
+    control_delay_.add(delay);
+    const auto bulk = static_cast<size_t>(FramePriority::BULK);
+    control_streak_ = next_ticket_[bulk] != serving_[bulk] ? control_streak_ + 1 : 0;
+  } else {
+    control_streak_ = 0;
+  }
+
+  // the port is written without the lock, so frames can queue up meanwhile
+  lock.unlock();
+  frame.send(port_.port());
+  lock.lock();
+
+  writing_ = false;
+  ++serving_[p];
+  write_cv_.notify_all();
+}
+
+LatencyStats Multiplexer::control_delay() {
+  std::lock_guard lock(write_mutex_);
+  return control_delay_;
+}
+
+void Multiplexer::reap() {
+  for (auto it = requests_.begin(); it != requests_.end();) {
+    if (it->second->done_) {
+      it->second->worker_.join();
+      it = requests_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool Multiplexer::poll() {
+  using namespace std::chrono_literals;
+  reap();
+
+  const auto start = std::chrono::steady_clock::now();
+  while (not port_.receive_frame()) {
+    if (port_.take_error()) {
+      DEBUG_PRINT("Frame dropped\n");
+      return true;
+    }
+    if ((std::chrono::steady_clock::now() - start) > 10s) {
+      reap();
+      return not requests_.empty();
+    }
+  }
+
+  const uint8_t* data = port_.frame_data();
+  const size_t size = port_.frame_size();
+  if (size == 0) {
+    return true;
+  }
+
+  const uint8_t tag = data[0];
+  reap();
+  if (const auto it = requests_.find(tag); it != requests_.end()) {
+    it->second->channel_->deliver(data + 1, size - 1);
+    return true;
+  }
+  if (size < 2) {
+    return true;
+  }
+
+  auto request = std::make_unique<Request>();
+  const uint8_t command = data[1];
+  request->channel_ = std::make_unique<TaggedChannel>(*this, tag, classify_(command));
+  request->channel_->deliver(data + 2, size - 2);
+  Request& req = *request;
+  req.worker_ = std::thread([this, &req, command]() {
+    handler_(*req.channel_, command);
+    // done before the last response leaves, the board may reuse the tag as soon as it arrives
+    req.done_ = true;
+    req.channel_->end_message();
+  });
+  requests_.emplace(tag, std::move(request));
+  return true;
+}
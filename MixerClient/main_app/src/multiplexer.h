@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "channel.h"
+#include "latency_stats.h"
+
+
+class Multiplexer;
+
+/// @brief Scheduling class of the frames of a request
+enum class FramePriority : uint8_t {
+  CONTROL,  ///< short responses, the board waits on them to update the UI
+  BULK,     ///< icons and session lists, sent in small frames so control frames can go in between
+};
+
+/// @brief Channel of one tagged request. Frames for the tag are queued by the multiplexer, written bytes are sent in
+/// frames starting with the tag
+class TaggedChannel : public Channel {
+public:
+  TaggedChannel(Multiplexer& mux, uint8_t tag, FramePriority priority);
+
+  int write(const uint8_t* data, size_t len) override;
+  int read(uint8_t* data, size_t len) override;
+  void flush() override;
+  void end_message() override;
+  bool take_error() override;
+  bool wait_input(std::chrono::steady_clock::time_point deadline) override;
+
+  /// @brief Queue the payload of a received frame, without the tag
+  void deliver(const uint8_t* data, size_t len);
+
+  /// @brief Wake up a pending read, and fail the ones after
+  void close();
+
+private:
+  Multiplexer& mux_;
+  const uint8_t tag_;
+  const FramePriority priority_;
+  const size_t frame_limit_;  ///< payload of the frames, including the tag
+  FrameBuffer out_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::vector<uint8_t>> mailbox_;
+  bool closed_ = false;
+
+  std::vector<uint8_t> in_;  ///< frame being read
+  size_t in_pos_ = 0;
+};
+
+
+/// @brief Runs tagged requests concurrently, so cheap commands don't wait behind image transfers.
+///
+/// Once the board enables tags, the first byte of every frame is a request tag chosen by the board. A frame with an
+/// unknown tag starts a request, its next byte is the command. The handler runs on its own thread, and reads the
+/// following frames with the same tag. The responses carry the tag too, and are sent as the requests complete.
+/// A tag can be reused, once the last response of its request was received.
+///
+/// Outgoing frames are scheduled by priority: a waiting control frame goes before the waiting bulk frames, so it
+/// is delayed by one bulk frame at most. After @ref bulk_share control frames in a row, a waiting bulk frame gets
+/// its turn, so transfers can't starve.
+class Multiplexer {
+public:
+  using handler_t = std::function<void(Channel&, uint8_t)>;
+  using classifier_t = std::function<FramePriority(uint8_t)>;
+
+  static constexpr size_t bulk_frame_size = 256;  ///< about 25 ms on the wire at 115200 baud
+  static constexpr unsigned bulk_share = 4;       ///< control frames sent in a row, before a waiting bulk frame
+
+  /// @param port framed channel of the board
+  /// @param handler called on a worker thread with the channel of the request and the command
+  /// @param classify priority of the frames of a request, by its command
+  Multiplexer(PortChannel& port, handler_t handler, classifier_t classify);
+
+  Multiplexer(const Multiplexer&) = delete;
+  Multiplexer& operator=(const Multiplexer&) = delete;
+
+  /// @brief Fail the pending reads of the requests and wait for them to finish
+  ~Multiplexer();
+
+  /// @brief Receive a frame and route it to its request, or start a new one
+  /// @return false if nothing was received for a while and no request is running
+  bool poll();
+
+  /// @brief Send @p frame, from any thread. Blocks until the frames of higher priority are sent
+  void send(FrameBuffer& frame, FramePriority priority);
+
+  /// @brief Queuing delay of the last control frames, from send() until they are written
+  [[nodiscard]] LatencyStats control_delay();
+
+private:
+  struct Request {
+    std::unique_ptr<TaggedChannel> channel_;
+    std::thread worker_;
+    std::atomic<bool> done_ = false;
+  };
+
+  /// @brief Join the requests, which are done
+  void reap();
+
+  /// @brief Check if the frame with @p ticket may be sent now, write_mutex_ must be held
+  [[nodiscard]] bool is_turn(FramePriority priority, uint64_t ticket) const;
+
+  PortChannel& port_;
+  handler_t handler_;
+  classifier_t classify_;
+  std::map<uint8_t, std::unique_ptr<Request>> requests_;
+
+  std::mutex write_mutex_;  ///< guards the scheduler state below
+  std::condition_variable write_cv_;
+  bool writing_ = false;
+  uint64_t next_ticket_[2] = {};  ///< per priority, frames are sent in the order they were queued
+  uint64_t serving_[2] = {};
+  unsigned control_streak_ = 0;  ///< control frames sent, while bulk frames were waiting
+  LatencyStats control_delay_;   ///< queuing delay of the control frames
+};
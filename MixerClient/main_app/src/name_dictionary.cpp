@@ -0,0 +1,53 @@
+#include "name_dictionary.h"
+#include <string_view>
+#include <unordered_set>
+
+
+bool NameDictionary::begin(const std::vector<const std::string*>& names) {
+  staged_.clear();
+  std::unordered_set<std::string_view> distinct;
+  size_t unknown = 0;
+  for (const std::string* name : names) {
+    if (distinct.insert(*name).second && names_.count(*name) == 0) {
+      ++unknown;
+    }
+  }
+  inline_ = distinct.size() > capacity;
+  if (names_.size() + unknown > capacity) {
+    reset();
+  }
+  return reset_pending_;
+}
+
+NameDictionary::Entry NameDictionary::find(const std::string& name) {
+  if (const auto it = names_.find(name); it != names_.end()) {
+    return { it->second, false };
+  }
+  if (const auto it = staged_.find(name); it != staged_.end()) {
+    // the board learns the name earlier in the same message
+    return { it->second, false };
+  }
+  const auto index = static_cast<uint32_t>(names_.size() + staged_.size());
+  staged_.emplace(name, index);
+  return { index, true };
+}
+
+void NameDictionary::commit() {
+  if (not staged_.empty() || reset_pending_) {
+    ++version_;
+  }
+  names_.merge(staged_);
+  staged_.clear();
+  reset_pending_ = false;
+}
+
+void NameDictionary::rollback() {
+  staged_.clear();
+}
+
+void NameDictionary::reset() {
+  names_.clear();
+  staged_.clear();
+  reset_pending_ = true;
+  ++version_;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/// @brief Filenames the board already received on this link, so repeated names are sent as an index.
+///
+/// Names added during a message are staged, and only kept once the board acknowledged the message. New names are
+/// sent with their index, so a board that applied a message the PC considers lost just overwrites the entries.
+class NameDictionary {
+public:
+  static constexpr size_t capacity = 256;  ///< entries the board has to keep
+
+  struct Entry {
+    uint32_t index_;
+    bool is_new_;  ///< the name has to be sent with the index
+  };
+
+  /// @brief Start a message with @p names, a name can repeat
+  /// @return true if the board has to clear its dictionary first, the dictionary is cleared when the names the board
+  /// doesn't know yet would overflow it. More different names than the capacity are sent inline, see inline_names()
+  bool begin(const std::vector<const std::string*>& names);
+
+  /// @brief Check if the names of the message don't fit into the dictionary, and have to be sent without an index.
+  /// The dictionary stays empty then
+  [[nodiscard]] bool inline_names() const {
+    return inline_;
+  }
+
+  /// @brief Get the index of @p name, staging it if the board doesn't know it yet. Not for inline names
+  Entry find(const std::string& name);
+
+  /// @brief The board acknowledged the message, keep the staged names
+  void commit();
+
+  /// @brief The message was lost, drop the staged names
+  void rollback();
+
+  /// @brief Forget all names, when the board lost its dictionary
+  void reset();
+
+  /// @brief Check if names were staged since begin()
+  [[nodiscard]] bool has_staged() const {
+    return not staged_.empty();
+  }
+
+  /// @brief Changes whenever the known names do, messages with only known names encode the same until then
+  [[nodiscard]] uint64_t version() const {
+    return version_;
+  }
+
+private:
+  std::unordered_map<std::string, uint32_t> names_;
+  std::unordered_map<std::string, uint32_t> staged_;
+  bool reset_pending_ = true;  ///< the board hasn't acknowledged a clear yet
+  bool inline_ = false;        ///< the current message sends its names inline
+  uint64_t version_ = 0;
+};
@@ -0,0 +1,244 @@
+#include "session_ranking.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+  /// @brief peaks below -60 dB are silence, like on the meters of the board
+  constexpr float silence = 0.001f;
+
+  /// @brief the activities are scaled back to the landmark, before the weights of new peaks get this large
+  constexpr double max_weight = 1e12;
+
+}  // namespace
+
+
+SessionRanking::SessionRanking(std::chrono::milliseconds half_life)
+    : decay_rate_(std::log(2.0) / std::chrono::duration<double>(half_life).count()),
+      landmark_(std::chrono::steady_clock::now()) {
+  pins_.insert(-1);
+}
+
+bool SessionRanking::better(int l, int r) const {
+  const Entry& a = entries_.at(l);
+  const Entry& b = entries_.at(r);
+  if (a.pinned_ != b.pinned_) return a.pinned_;
+  if (a.activity_ != b.activity_) return a.activity_ > b.activity_;
+  if (a.last_active_ != b.last_active_) return a.last_active_ > b.last_active_;
+  if (a.seen_ != b.seen_) return a.seen_ > b.seen_;
+  return l < r;
+}
+
+bool SessionRanking::before(bool top, int l, int r) const {
+  return top ? better(r, l) : better(l, r);
+}
+
+void SessionRanking::place(bool top, size_t i, int pid) {
+  (top ? top_ : rest_)[i] = pid;
+  Entry& entry = entries_.at(pid);
+  entry.in_top_ = top;
+  entry.index_ = i;
+}
+
+void SessionRanking::sift_up(bool top, size_t i) {
+  auto& heap = top ? top_ : rest_;
+  const int pid = heap[i];
+  while (i > 0 && before(top, pid, heap[(i - 1) / 2])) {
+    place(top, i, heap[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+  place(top, i, pid);
+}
+
+void SessionRanking::sift_down(bool top, size_t i) {
+  auto& heap = top ? top_ : rest_;
+  const int pid = heap[i];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap.size()) {
+      break;
+    }
+    if (child + 1 < heap.size() && before(top, heap[child + 1], heap[child])) {
+      ++child;
+    }
+    if (not before(top, heap[child], pid)) {
+      break;
+    }
+    place(top, i, heap[child]);
+    i = child;
+  }
+  place(top, i, pid);
+}
+
+void SessionRanking::push(bool top, int pid) {
+  auto& heap = top ? top_ : rest_;
+  heap.push_back(pid);
+  sift_up(top, heap.size() - 1);
+}
+
+int SessionRanking::pop(bool top, size_t i) {
+  auto& heap = top ? top_ : rest_;
+  const int pid = heap[i];
+  const int last = heap.back();
+  heap.pop_back();
+  if (i < heap.size()) {
+    place(top, i, last);
+    sift_down(top, i);
+    sift_up(top, entries_.at(last).index_);
+  }
+  return pid;
+}
+
+void SessionRanking::rebalance() {
+  while (top_.size() > slots_) {
+    push(false, pop(true, 0));
+  }
+  while (top_.size() < slots_ && not rest_.empty()) {
+    push(true, pop(false, 0));
+  }
+  // after a single change, one exchange restores the order
+  while (not top_.empty() && not rest_.empty() && better(rest_[0], top_[0])) {
+    const int demoted = pop(true, 0);
+    push(true, pop(false, 0));
+    push(false, demoted);
+  }
+}
+
+void SessionRanking::reorder(int pid) {
+  const Entry& entry = entries_.at(pid);
+  const bool top = entry.in_top_;
+  sift_up(top, entry.index_);
+  sift_down(top, entry.index_);
+  rebalance();
+}
+
+void SessionRanking::erase(int pid) {
+  const Entry& entry = entries_.at(pid);
+  pop(entry.in_top_, entry.index_);
+  entries_.erase(pid);
+  rebalance();
+}
+
+void SessionRanking::update(const std::vector<VolumeControl::MeterSample>& samples) {
+  std::lock_guard lock(mutex_);
+  ++updates_;
+
+  const auto now = std::chrono::steady_clock::now();
+  double weight = std::exp(decay_rate_ * std::chrono::duration<double>(now - landmark_).count());
+  if (weight > max_weight) {
+    // the same factor for every session keeps the order, only ties could flip, so the heaps are fixed up
+    for (auto& [pid, entry] : entries_) {
+      entry.activity_ /= weight;
+    }
+    landmark_ = now;
+    weight = 1;
+    for (const bool top : { true, false }) {
+      for (size_t i = (top ? top_ : rest_).size(); i-- > 0;) {
+        sift_down(top, i);
+      }
+    }
+    rebalance();
+  }
+
+  for (const auto& sample : samples) {
+    const auto [it, added] = entries_.try_emplace(sample.pid_);
+    Entry& entry = it->second;
+    entry.stamp_ = updates_;
+    const bool active = sample.peak_ > silence;
+    if (active) {
+      entry.activity_ += sample.peak_ * weight;
+      entry.last_active_ = updates_;
+    }
+    if (added) {
+      entry.seen_ = updates_;
+      entry.pinned_ = pins_.count(sample.pid_) != 0;
+      push(false, sample.pid_);
+      rebalance();
+    } else if (active) {
+      reorder(sample.pid_);
+    }
+  }
+
+  // sessions which ended
+  std::vector<int> gone;
+  for (const auto& [pid, entry] : entries_) {
+    if (entry.stamp_ != updates_) {
+      gone.push_back(pid);
+    }
+  }
+  for (const int pid : gone) {
+    erase(pid);
+  }
+}
+
+void SessionRanking::set_pinned(int pid, bool pinned) {
+  std::lock_guard lock(mutex_);
+  if (pinned) {
+    pins_.insert(pid);
+  } else {
+    pins_.erase(pid);
+  }
+  if (const auto it = entries_.find(pid); it != entries_.end() && it->second.pinned_ != pinned) {
+    it->second.pinned_ = pinned;
+    reorder(pid);
+  }
+}
+
+std::vector<int> SessionRanking::top(size_t slots) {
+  std::lock_guard lock(mutex_);
+  if (slots != slots_) {
+    slots_ = slots;
+    rebalance();
+  }
+  std::vector<int> ret = top_;
+  std::sort(ret.begin(), ret.end(), [this](int l, int r) { return better(l, r); });
+  return ret;
+}
+
+size_t SessionRanking::size() const {
+  std::lock_guard lock(mutex_);
+  return entries_.size();
+}
+
+
+ActivitySampler::ActivitySampler(SessionRanking& ranking, std::chrono::milliseconds period,
+                                 std::chrono::milliseconds idle_after)
+    : ranking_(ranking), idle_after_(idle_after), last_request_(clock::now()) {
+  thread_ = std::thread([this, period]() {
+    std::unique_lock lock(mutex_);
+    while (not stop_) {
+      if (idle(clock::now())) {
+        cv_.wait(lock, [this]() { return stop_ || not idle(clock::now()); });
+        continue;
+      }
+      lock.unlock();
+      ranking_.update(VolumeControl::get_meter_samples());
+      lock.lock();
+      cv_.wait_for(lock, period, [this]() { return stop_; });
+    }
+  });
+}
+
+void ActivitySampler::request() {
+  const auto now = clock::now();
+  bool was_idle;
+  {
+    std::lock_guard lock(mutex_);
+    was_idle = idle(now);
+    last_request_ = now;
+  }
+  if (was_idle) {
+    ranking_.update(VolumeControl::get_meter_samples());
+    cv_.notify_one();
+  }
+}
+
+ActivitySampler::~ActivitySampler() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+
+/// @brief Ranks the sessions for the few slots of the board: pinned ones first, then by recent audio activity, then
+/// by when they were last heard, newer sessions first.
+///
+/// Activity is the sum of the meter peaks, decayed with a half-life. The decay is applied forward, new peaks weigh
+/// more the later they come, so the activity of a silent session never has to be touched and the order only
+/// changes for the sessions, which are heard. The best sessions are kept in a min-heap bounded to the number of
+/// slots, the others in a max-heap, and a change costs O(log n). Thread safe.
+class SessionRanking {
+public:
+  /// @param half_life time after which a peak counts half
+  explicit SessionRanking(std::chrono::milliseconds half_life);
+
+  /// @brief Take one meter reading. Sessions missing from @p samples are dropped, new ones are added
+  /// @param samples sorted by pid, as get_meter_samples() returns them
+  void update(const std::vector<VolumeControl::MeterSample>& samples);
+
+  /// @brief Keep @p pid in the top slots, while it exists. The master is pinned from the start
+  void set_pinned(int pid, bool pinned);
+
+  /// @brief Get the best @p slots sessions, best first
+  std::vector<int> top(size_t slots);
+
+  [[nodiscard]] size_t size() const;
+
+private:
+  struct Entry {
+    bool pinned_ = false;
+    double activity_ = 0;       ///< forward decayed, relative to landmark_
+    uint64_t last_active_ = 0;  ///< update() count, when the session was last heard
+    uint64_t seen_ = 0;         ///< update() count, when the session appeared
+    uint64_t stamp_ = 0;        ///< update() count, when the session was last sampled
+    bool in_top_ = false;
+    size_t index_ = 0;  ///< position in its heap
+  };
+
+  /// @brief Check if session @p l ranks before @p r
+  [[nodiscard]] bool better(int l, int r) const;
+
+  // heap operations, @p top selects top_ (min-heap, the worst on top) or rest_ (max-heap, the best on top)
+  void sift_up(bool top, size_t i);
+  void sift_down(bool top, size_t i);
+  void push(bool top, int pid);
+  int pop(bool top, size_t i);
+  void place(bool top, size_t i, int pid);
+  [[nodiscard]] bool before(bool top, int l, int r) const;
+
+  /// @brief Restore the order of @p pid after its key changed, and the bound of the top heap
+  void reorder(int pid);
+  void rebalance();
+
+  void erase(int pid);
+
+  const double decay_rate_;  ///< per second
+  mutable std::mutex mutex_;
+  std::unordered_map<int, Entry> entries_;
+  std::unordered_set<int> pins_;  ///< pinned pids, also the ones which don't exist yet
+  std::vector<int> top_;
+  std::vector<int> rest_;
+  size_t slots_ = 0;
+  uint64_t updates_ = 0;
+  std::chrono::steady_clock::time_point landmark_;  ///< start of the forward decay
+};
+
+
+/// @brief Feeds the meters to a SessionRanking from a thread, while the board asks for the top sessions. Once the
+/// board hasn't asked for a while, the thread waits for the next request without reading the meters
+class ActivitySampler {
+public:
+  /// @param period time between two meter readings
+  /// @param idle_after stop reading the meters after this long without request()
+  ActivitySampler(SessionRanking& ranking, std::chrono::milliseconds period, std::chrono::milliseconds idle_after);
+  ActivitySampler(const ActivitySampler&) = delete;
+  ActivitySampler& operator=(const ActivitySampler&) = delete;
+  ~ActivitySampler();
+
+  /// @brief The board asked for the top sessions. An idle sampler takes a reading first, so the answer doesn't rank
+  /// by what played before the pause, and starts again
+  void request();
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  [[nodiscard]] bool idle(clock::time_point now) const {
+    return now - last_request_ >= idle_after_;
+  }
+
+  SessionRanking& ranking_;
+  const std::chrono::milliseconds idle_after_;
+  std::mutex mutex_;  ///< guards the state below
+  std::condition_variable cv_;
+  clock::time_point last_request_;
+  bool stop_ = false;
+  std::thread thread_;
+};
@@ -0,0 +1,142 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "change_tracker.h"
+
+// Runs the ChangeTracker against hand built snapshots:
+// - a process with two sessions on one device, which the tracker has to count as one
+// - a volume the board set, which must not show as a change
+// - sessions added, removed and modified on one of several devices
+
+
+namespace {
+
+  namespace VC = VolumeControl;
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  struct Session {
+    int pid_;
+    uint8_t endpoint_;
+    float volume_;
+    bool muted_;
+  };
+
+  /// @brief The records are kept between the snapshots, like the scan does, so unchanged sessions keep their
+  /// generation
+  class Snapshots {
+  public:
+    VC::SessionSnapshot build(const std::vector<Session>& sessions) {
+      VC::SessionSnapshot::Builder builder;
+      for (const auto& session : sessions) {
+        builder.add(session.pid_, session.endpoint_, session.volume_, session.muted_, record(session.pid_));
+      }
+      previous_ = builder.build(previous_);
+      return previous_;
+    }
+
+  private:
+    VC::SessionSnapshot::record_t record(int pid) {
+      for (const auto& record : records_) {
+        if (record->pid() == pid) {
+          return record;
+        }
+      }
+      records_.push_back(std::make_shared<const VC::SessionRecord>(pid, L"app" + std::to_wstring(pid)));
+      return records_.back();
+    }
+
+    std::vector<VC::SessionSnapshot::record_t> records_;
+    VC::SessionSnapshot previous_;
+  };
+
+  void test_duplicate_sessions() {
+    Snapshots snapshots;
+    ChangeTracker tracker;
+    const auto first = snapshots.build({ { 10, 0, 50, false }, { 20, 0, 30, false }, { 20, 0, 30, false } });
+    check(tracker.changed(first), "duplicates: not changed before the first acknowledge");
+    tracker.acknowledge(first);
+    check(not tracker.changed(first), "duplicates: changed after acknowledge");
+    check(tracker.diff(first).empty(), "duplicates: diff after acknowledge");
+
+    // a rebuilt snapshot with the same sessions
+    const auto same = snapshots.build({ { 10, 0, 50, false }, { 20, 0, 30, false }, { 20, 0, 30, false } });
+    check(not tracker.changed(same), "duplicates: changed on the same sessions");
+
+    // one of the two sessions goes away, the pid stays
+    const auto one = snapshots.build({ { 10, 0, 50, false }, { 20, 0, 30, false } });
+    check(tracker.changed(one), "duplicates: a removed second session not seen");
+    const auto diff = tracker.diff_pids(one);
+    check(diff.size() == 1 && diff[0].pid_ == 20 && diff[0].change_ == ChangeTracker::Change::MODIFIED,
+          "duplicates: a removed second session not reported as modified");
+    tracker.acknowledge(one);
+    check(not tracker.changed(one), "duplicates: changed after the second acknowledge");
+
+    // a second session starts again
+    const auto two = snapshots.build({ { 10, 0, 50, false }, { 20, 0, 30, false }, { 20, 0, 30, false } });
+    check(tracker.changed(two), "duplicates: an added second session not seen");
+  }
+
+  void test_board_volume() {
+    Snapshots snapshots;
+    ChangeTracker tracker;
+    tracker.acknowledge(snapshots.build({ { 10, 0, 50, false }, { 20, 0, 30, false }, { 20, 0, 30, false } }));
+
+    // the board sets pid 20, apply() sets both of its sessions
+    tracker.set_volume(20, 70);
+    tracker.set_muted(20, true);
+    const auto set = snapshots.build({ { 10, 0, 50, false }, { 20, 0, 70, true }, { 20, 0, 70, true } });
+    check(not tracker.changed(set), "board volume: changed");
+    check(tracker.diff(set).empty(), "board volume: in the diff");
+
+    // another program sets pid 10
+    const auto other = snapshots.build({ { 10, 0, 20, false }, { 20, 0, 70, true }, { 20, 0, 70, true } });
+    const auto diff = tracker.diff(other);
+    check(diff.size() == 1 && diff[0].pid_ == 10 && diff[0].change_ == ChangeTracker::Change::MODIFIED,
+          "board volume: a volume set elsewhere not reported");
+  }
+
+  void test_devices() {
+    Snapshots snapshots;
+    ChangeTracker tracker;
+    tracker.acknowledge(snapshots.build({ { 10, 0, 50, false }, { 10, 1, 50, false }, { 20, 1, 30, false } }));
+
+    // pid 10 leaves device 1, pid 30 starts, pid 20 ends
+    const auto next = snapshots.build({ { 10, 0, 50, false }, { 30, 0, 40, false } });
+    check(tracker.diff(next).size() == 3, "devices: wrong session diff");
+    const auto diff = tracker.diff_pids(next);
+    check(diff.size() == 3, "devices: wrong pid diff size");
+    for (const auto& entry : diff) {
+      const auto expected = entry.pid_ == 10   ? ChangeTracker::Change::MODIFIED
+                            : entry.pid_ == 20 ? ChangeTracker::Change::REMOVED
+                                               : ChangeTracker::Change::ADDED;
+      check(entry.change_ == expected, "devices: wrong change of pid " + std::to_string(entry.pid_));
+    }
+    tracker.reset();
+    check(tracker.changed(next), "devices: not changed after reset");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_duplicate_sessions();
+  test_board_volume();
+  test_devices();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <string>
+#include "chunk_controller.h"
+
+// Steps the ChunkController through the acknowledgements of a link, which starts clean and turns noisy:
+// - the first transfer starts with the largest chunk the board accepts
+// - a failure halves the chunk, down to the minimum and no further
+// - each acknowledged chunk grows it by the step, up to the limit of the board
+// - the size is kept across transfers, and clamped to the limit of the next board
+// - the statistics count the chunks and the acknowledged bytes
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  void check_size(const ChunkController& controller, uint32_t expected, const std::string& what) {
+    check(controller.chunk_size() == expected, what + ": chunk size " + std::to_string(controller.chunk_size()) +
+                                                   " instead of " + std::to_string(expected));
+  }
+
+  void test_decrease() {
+    ChunkController controller(16, 32);
+    controller.begin(256);
+    check_size(controller, 256, "decrease: first transfer");
+    controller.on_failure();
+    check_size(controller, 128, "decrease: first failure");
+    controller.on_failure();
+    controller.on_failure();
+    controller.on_failure();
+    check_size(controller, 16, "decrease: fourth failure");
+    controller.on_failure();
+    check_size(controller, 16, "decrease: below the minimum");
+  }
+
+  void test_increase() {
+    ChunkController controller(16, 32);
+    controller.begin(256);
+    controller.on_failure();
+    controller.on_failure();
+    check_size(controller, 64, "increase: after two failures");
+    controller.on_success(64);
+    check_size(controller, 96, "increase: first success");
+    for (int i = 0; i < 5; ++i) {
+      controller.on_success(controller.chunk_size());
+    }
+    check_size(controller, 256, "increase: past the limit");
+    controller.on_success(256);
+    check_size(controller, 256, "increase: at the limit");
+  }
+
+  void test_transfers() {
+    ChunkController controller(16, 32);
+    controller.begin(512);
+    controller.on_failure();
+    check_size(controller, 256, "transfers: failure");
+    controller.begin(1024);
+    check_size(controller, 256, "transfers: size not kept");
+    controller.begin(100);
+    check_size(controller, 100, "transfers: not clamped to a smaller board");
+    controller.begin(8);
+    check_size(controller, 8, "transfers: minimum above the limit of the board");
+    controller.on_failure();
+    check_size(controller, 8, "transfers: failure below the limit of the board");
+  }
+
+  void test_stats() {
+    ChunkController controller(16, 32);
+    controller.begin(256);
+    controller.on_success(256);
+    controller.on_failure();
+    controller.on_success(128);
+    const auto stats = controller.stats();
+    check(stats.acked_ == 2, "stats: acknowledged chunks");
+    check(stats.failed_ == 1, "stats: failed chunks");
+    check(stats.bytes_ == 384, "stats: acknowledged bytes");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_decrease();
+  test_increase();
+  test_transfers();
+  test_stats();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
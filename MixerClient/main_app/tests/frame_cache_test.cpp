@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "frame_cache.h"
+
+// Caches LOAD_TOP frames of different selections of the sessions:
+// - the same pids in the same order hit
+// - other pids, the same pids in another order, or a prefix of them miss
+// - a new generation drops the frames
+
+
+namespace {
+
+  using Encoding = FrameCache::Encoding;
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  std::vector<uint8_t> frame_of(const std::vector<int16_t>& pids) {
+    std::vector<uint8_t> frame;
+    for (const int16_t pid : pids) {
+      frame.push_back(static_cast<uint8_t>(pid));
+    }
+    return frame;
+  }
+
+  void test_selection() {
+    FrameCache cache;
+    const uint64_t generation = cache.update(1);
+    const std::vector<int16_t> top{ 10, 20, 30 };
+    (void)cache.put(generation, Encoding::LOAD_TOP, 0, frame_of(top), top);
+
+    const auto hit = cache.find(generation, Encoding::LOAD_TOP, 0, top);
+    check(hit && *hit == frame_of(top), "selection: same order missed");
+    check(not cache.find(generation, Encoding::LOAD_TOP, 0, { 30, 20, 10 }), "selection: other order hit");
+    check(not cache.find(generation, Encoding::LOAD_TOP, 0, { 10, 20 }), "selection: prefix hit");
+    check(not cache.find(generation, Encoding::LOAD_TOP, 0, { 10, 20, 31 }), "selection: other pids hit");
+    check(not cache.find(generation, Encoding::LOAD_TOP, 0), "selection: empty selection hit");
+    check(not cache.find(generation, Encoding::LOAD_ALL, 0), "selection: other encoding hit");
+
+    const std::vector<int16_t> other{ 30, 20, 10 };
+    (void)cache.put(generation, Encoding::LOAD_TOP, 0, frame_of(other), other);
+    const auto first = cache.find(generation, Encoding::LOAD_TOP, 0, top);
+    const auto second = cache.find(generation, Encoding::LOAD_TOP, 0, other);
+    check(first && *first == frame_of(top), "selection: first frame replaced");
+    check(second && *second == frame_of(other), "selection: second frame missed");
+
+    const auto stats = cache.stats();
+    check(stats.hits_ == 3 && stats.misses_ == 5, "selection: wrong hit and miss counts");
+  }
+
+  void test_generation() {
+    FrameCache cache;
+    const std::vector<int16_t> top{ 10, 20 };
+    (void)cache.put(cache.update(1), Encoding::LOAD_TOP, 0, frame_of(top), top);
+    const uint64_t generation = cache.update(2);
+    check(not cache.find(generation, Encoding::LOAD_TOP, 0, top), "generation: old frame hit");
+    (void)cache.put(1, Encoding::LOAD_TOP, 0, frame_of(top), top);
+    check(not cache.find(generation, Encoding::LOAD_TOP, 0, top), "generation: outdated frame kept");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_selection();
+  test_generation();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "CommSupervisor/supervisor.h"
+#include "VolumeAPI/VolumeAPI.h"
+#include "channel.h"
+#include "communication.h"
+
+// Answers READ_IMG_RESUME requests for the icon of the master from a scripted board:
+// - offset 0, an offset inside the icon and the size of the icon send exactly the bytes from the offset
+// - an offset past the end or a wrong hash are refused, without chunks
+// - with adaptive chunks, the length-prefixed chunks start at the offset too
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  /// @brief Board side of one exchange: reads what the board sent, collects what the PC wrote
+  class ScriptedChannel : public Channel {
+  public:
+    template <class Message>
+    void send(const Message& message) {
+      input_.insert(input_.end(), message.begin(), message.end());
+    }
+
+    int write(const uint8_t* data, size_t len) override {
+      output_.insert(output_.end(), data, data + len);
+      return static_cast<int>(len);
+    }
+
+    int read(uint8_t* data, size_t len) override {
+      size_t n = 0;
+      for (; n < len && read_ < input_.size(); ++n) {
+        data[n] = input_[read_++];
+      }
+      return static_cast<int>(n);
+    }
+
+    void flush() override {
+    }
+
+    void end_message() override {
+    }
+
+    bool take_error() override {
+      return false;
+    }
+
+    [[nodiscard]] const std::vector<uint8_t>& output() const {
+      return output_;
+    }
+
+  private:
+    std::vector<uint8_t> input_;
+    size_t read_ = 0;
+    std::vector<uint8_t> output_;
+  };
+
+  struct Reply {
+    uint8_t status_ = 0;
+    uint32_t size_ = 0;
+    std::vector<uint8_t> data_;  ///< the bytes of the chunks, in order
+    bool crc_ok_ = true;
+    bool complete_ = true;  ///< the output ended with a whole chunk
+  };
+
+  /// @brief Request the icon of the master from @p offset, the board acknowledges every chunk
+  Reply resume(uint32_t hash, uint32_t offset, uint32_t chunk_size) {
+    constexpr size_t max_chunks = 256;
+    ScriptedChannel channel;
+    channel.send(mixer::ImgResumeRequest::encode(-1, hash, offset));
+    channel.send(mixer::ChunkSizeMessage::encode(chunk_size));
+    for (size_t i = 0; i < max_chunks; ++i) {
+      channel.send(mixer::Ack::encode(mixer::commands::RESPONSE_OK));
+    }
+    respond_img_resume(channel);
+
+    Reply reply;
+    const auto& out = channel.output();
+    if (out.size() < mixer::ImgResumeReply::wire_size || not mixer::ImgResumeReply::verify(out.data())) {
+      reply.complete_ = false;
+      return reply;
+    }
+    const mixer::ImgResumeReply::View view(out.data());
+    reply.status_ = view.get<mixer::fields::Status>();
+    reply.size_ = view.get<mixer::fields::ImageSize>();
+
+    const bool adaptive = chunk_size & mixer::ADAPTIVE_CHUNKS;
+    const uint32_t max_chunk = chunk_size & ~mixer::ADAPTIVE_CHUNKS;
+    size_t pos = mixer::ImgResumeReply::wire_size;
+    while (pos < out.size()) {
+      uint32_t crc = 0xFFFFFFFF;
+      uint32_t len = std::min<uint32_t>(max_chunk, reply.size_ - offset - static_cast<uint32_t>(reply.data_.size()));
+      if (adaptive) {
+        if (out.size() - pos < 4) {
+          reply.complete_ = false;
+          break;
+        }
+        len = Schema::load<uint32_t>(out.data() + pos);
+        crc = CRC::crc32mpeg2(out.data() + pos, 4);
+        pos += 4;
+      }
+      if (len == 0 || out.size() - pos < len + 4) {
+        reply.complete_ = false;
+        break;
+      }
+      reply.crc_ok_ = reply.crc_ok_ &&
+                      CRC::crc32mpeg2(out.data() + pos, len, crc) == Schema::load<uint32_t>(out.data() + pos + len);
+      reply.data_.insert(reply.data_.end(), out.data() + pos, out.data() + pos + len);
+      pos += len + 4;
+    }
+    return reply;
+  }
+
+  void check_resumed(const VolumeControl::IconData& icon, uint32_t offset, uint32_t chunk_size,
+                     const std::string& what) {
+    const auto reply = resume(icon.hash(), offset, chunk_size);
+    check(reply.status_ == mixer::commands::RESPONSE_OK, what + ": refused");
+    check(reply.size_ == icon.size(), what + ": wrong image size");
+    check(reply.complete_, what + ": truncated chunk");
+    check(reply.crc_ok_, what + ": CRC error");
+    check(reply.data_ == std::vector<uint8_t>(icon.data() + offset, icon.data() + icon.size()),
+          what + ": wrong bytes");
+  }
+
+  void test_offsets(const VolumeControl::IconData& icon) {
+    const auto size = static_cast<uint32_t>(icon.size());
+    check_resumed(icon, 0, 64, "offset 0");
+    check_resumed(icon, size / 2 + 1, 64, "middle offset");
+    check_resumed(icon, size - 1, 64, "last byte");
+    check_resumed(icon, size, 64, "offset at the end");
+  }
+
+  void test_refused(const VolumeControl::IconData& icon) {
+    const auto past_end = resume(icon.hash(), static_cast<uint32_t>(icon.size()) + 1, 64);
+    check(past_end.status_ == mixer::commands::RESPONSE_FAIL, "past the end: not refused");
+    check(past_end.data_.empty(), "past the end: chunks sent");
+
+    const auto changed = resume(icon.hash() + 1, 0, 64);
+    check(changed.status_ == mixer::commands::RESPONSE_FAIL, "wrong hash: not refused");
+    check(changed.data_.empty(), "wrong hash: chunks sent");
+  }
+
+  void test_adaptive(const VolumeControl::IconData& icon) {
+    const auto size = static_cast<uint32_t>(icon.size());
+    check_resumed(icon, 0, mixer::ADAPTIVE_CHUNKS | 256, "adaptive offset 0");
+    check_resumed(icon, size / 3, mixer::ADAPTIVE_CHUNKS | 256, "adaptive middle offset");
+    check_resumed(icon, size, mixer::ADAPTIVE_CHUNKS | 256, "adaptive offset at the end");
+  }
+
+}  // namespace
+
+
+int main() {
+  VolumeControl::AudioSessionInfo master{};
+  master.pid_ = -1;
+  const auto icon = master.get_icon_data();
+  if (icon.size() < 2) {
+    std::printf("no icon for the master\n");
+    return 1;
+  }
+
+  test_offsets(icon);
+  test_refused(icon);
+  test_adaptive(icon);
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
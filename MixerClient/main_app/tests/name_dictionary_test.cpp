@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "name_dictionary.h"
+
+// Runs the NameDictionary through the messages of a session list which grows past half the capacity:
+// - names the board knows don't count against the capacity again
+// - a name repeated in a message counts once
+// - only new names overflowing the dictionary clear it, more different names than the capacity go inline
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  std::vector<std::string> make_names(size_t first, size_t n) {
+    std::vector<std::string> names;
+    for (size_t i = first; i < first + n; ++i) {
+      names.push_back("app" + std::to_string(i));
+    }
+    return names;
+  }
+
+  /// @brief One acknowledged message with @p names
+  /// @return true if the board had to clear its dictionary
+  bool send(NameDictionary& dictionary, const std::vector<std::string>& names) {
+    std::vector<const std::string*> pointers;
+    for (const auto& name : names) {
+      pointers.push_back(&name);
+    }
+    const bool clear = dictionary.begin(pointers);
+    if (not dictionary.inline_names()) {
+      for (const auto& name : names) {
+        (void)dictionary.find(name);
+      }
+    }
+    dictionary.commit();
+    return clear;
+  }
+
+  void test_known_names() {
+    NameDictionary dictionary;
+    const auto names = make_names(0, 200);
+    check(send(dictionary, names), "known: the first message doesn't clear");
+    check(not send(dictionary, names), "known: the same 200 names cleared the dictionary");
+    check(not dictionary.find(names[10]).is_new_, "known: a known name is new");
+
+    // 50 more fit, the known names keep their indices
+    const uint32_t index = dictionary.find(names[10]).index_;
+    auto more = names;
+    const auto added = make_names(200, 50);
+    more.insert(more.end(), added.begin(), added.end());
+    check(not send(dictionary, more), "known: 250 names cleared the dictionary");
+    check(dictionary.find(names[10]).index_ == index, "known: a name changed its index");
+
+    // 10 other ones don't
+    check(send(dictionary, make_names(10, 250)), "known: 10 new names didn't clear a dictionary of 250");
+    check(not dictionary.inline_names(), "known: 250 names went inline");
+  }
+
+  void test_repeated_names() {
+    NameDictionary dictionary;
+    // a process on several devices, and many processes of one program
+    std::vector<std::string> names(300, "browser");
+    const auto others = make_names(0, 100);
+    names.insert(names.end(), others.begin(), others.end());
+    send(dictionary, names);
+    check(not dictionary.inline_names(), "repeated: 101 different names went inline");
+    check(not send(dictionary, names), "repeated: the same names cleared the dictionary");
+    check(not dictionary.find("browser").is_new_, "repeated: a repeated name isn't known");
+  }
+
+  void test_inline() {
+    NameDictionary dictionary;
+    const auto names = make_names(0, NameDictionary::capacity + 1);
+    send(dictionary, names);
+    check(dictionary.inline_names(), "inline: more names than the capacity not inline");
+    check(not send(dictionary, make_names(0, 10)), "inline: the dictionary wasn't left empty");
+    check(dictionary.find("app3").index_ == 3, "inline: wrong index after inline names");
+  }
+
+  void test_rollback() {
+    NameDictionary dictionary;
+    send(dictionary, make_names(0, 10));
+    const auto names = make_names(0, 20);
+    std::vector<const std::string*> pointers;
+    for (const auto& name : names) {
+      pointers.push_back(&name);
+    }
+    check(not dictionary.begin(pointers), "rollback: a message with new names cleared the dictionary");
+    check(dictionary.find(names[15]).is_new_, "rollback: an unknown name isn't new");
+    dictionary.rollback();
+    check(dictionary.find(names[15]).is_new_, "rollback: a lost name was kept");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_known_names();
+  test_repeated_names();
+  test_inline();
+  test_rollback();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
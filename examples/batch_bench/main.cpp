@@ -0,0 +1,100 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "VolumeAPI/simulation.h"
+
+// Compares a batch of volume operations through VolumeControl::apply() with the same operations as individual calls.
+// The audio backend is simulated, with 40 sessions and a modelled cost of 150 us per device and 10 us per session.
+
+
+namespace {
+
+  namespace VC = VolumeControl;
+  namespace Sim = VolumeControl::Simulation;
+
+  constexpr int n_sessions = 40;
+  constexpr int first_pid = 1000;
+  constexpr size_t n_operations = 50;
+  constexpr int n_runs = 20;
+
+  using clock = std::chrono::steady_clock;
+
+  /// @brief gets, sets, relative changes and mutes, spread over the sessions and the master
+  std::vector<VC::Operation> make_batch() {
+    std::vector<VC::Operation> ops;
+    for (size_t i = 0; i < n_operations; ++i) {
+      const int pid = i % 10 == 9 ? -1 : first_pid + static_cast<int>(i * 7 % n_sessions);
+      switch (i % 4) {
+        case 0:
+          ops.push_back(VC::Operation::get(pid));
+          break;
+        case 1:
+          ops.push_back(VC::Operation::set_volume(pid, static_cast<float>(i)));
+          break;
+        case 2:
+          ops.push_back(VC::Operation::change_volume(pid, -5));
+          break;
+        default:
+          ops.push_back(VC::Operation::set_muted(pid, i % 8 == 3));
+          break;
+      }
+    }
+    return ops;
+  }
+
+  /// @brief The operations with the single calls, a get reads the volume and the mute state, a change reads the
+  /// volume first, like callers did before apply()
+  void run_individually(const std::vector<VC::Operation>& ops) {
+    for (const auto& op : ops) {
+      switch (op.kind_) {
+        case VC::Operation::Kind::GET:
+          (void)VC::get_volume(op.pid_);
+          (void)VC::get_muted(op.pid_);
+          break;
+        case VC::Operation::Kind::SET_VOLUME:
+          VC::set_volume(op.pid_, op.volume_);
+          break;
+        case VC::Operation::Kind::CHANGE_VOLUME:
+          VC::set_volume(op.pid_, VC::get_volume(op.pid_) + op.volume_);
+          break;
+        case VC::Operation::Kind::SET_MUTED:
+          VC::set_muted(op.pid_, op.muted_);
+          break;
+      }
+    }
+  }
+
+  /// @brief Run @p batch n_runs times and print the mean time and enumerations per batch
+  template <class Batch>
+  void measure(const char* mode, Batch batch) {
+    const uint64_t enumerations = Sim::enumerations();
+    const auto start = clock::now();
+    for (int i = 0; i < n_runs; ++i) {
+      batch();
+    }
+    const std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+    std::printf("%-20s %8.2f ms   %5.1f enumerations\n", mode, elapsed.count() / n_runs,
+                static_cast<double>(Sim::enumerations() - enumerations) / n_runs);
+  }
+
+}  // namespace
+
+
+int main() {
+  if (not VC::init()) {
+    return 1;
+  }
+  Sim::reset();
+  Sim::set_costs({ std::chrono::microseconds(150), std::chrono::microseconds(10) });
+  for (int pid = first_pid; pid < first_pid + n_sessions; ++pid) {
+    Sim::add_session(pid, L"app" + std::to_wstring(pid), 50);
+  }
+
+  const auto ops = make_batch();
+  std::printf("%zu operations on %d sessions, mean of %d runs\n", ops.size(), n_sessions, n_runs);
+  measure("individual calls", [&ops]() { run_individually(ops); });
+  measure("apply()", [&ops]() { (void)VC::apply(ops); });
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "board_sim.h"
+#include <algorithm>
+#include "CommSupervisor/supervisor.h"
+#include "communication.h"
+
+
+SimulatedWire::SimulatedWire(uint32_t baud) : byte_time_(std::chrono::nanoseconds(std::chrono::seconds(10)) / baud) {
+}
+
+int SimulatedWire::write(const uint8_t* data, size_t len) {
+  {
+    std::lock_guard wire_lock(wire_mutex_);
+    std::this_thread::sleep_for(byte_time_ * len);
+    std::lock_guard lock(mutex_);
+    bytes_.insert(bytes_.end(), data, data + len);
+  }
+  cv_.notify_all();
+  return static_cast<int>(len);
+}
+
+int SimulatedWire::read(uint8_t* data, size_t len) {
+  using namespace std::chrono_literals;
+  std::unique_lock lock(mutex_);
+  // like the read timeout of the serial port
+  cv_.wait_for(lock, 10ms, [this]() { return not bytes_.empty(); });
+  const size_t n = std::min(len, bytes_.size());
+  std::copy_n(bytes_.begin(), n, data);
+  bytes_.erase(bytes_.begin(), bytes_.begin() + n);
+  return static_cast<int>(n);
+}
+
+
+SimulatedBoard::SimulatedBoard(uint32_t baud) : to_board_(baud), to_client_(baud) {
+  receiver_ = std::thread([this]() { receive_loop(); });
+}
+
+SimulatedBoard::~SimulatedBoard() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  receiver_.join();
+}
+
+bool SimulatedBoard::enable_framing() {
+  const uint8_t command = mixer::commands::ENABLE_FRAMING;
+  to_client_.write(&command, 1);
+  const auto ack = receive(0, mixer::Ack::wire_size);
+  if (ack.empty() || mixer::Ack::View(ack.data()).get<mixer::fields::Status>() != mixer::commands::RESPONSE_OK) {
+    return false;
+  }
+  std::lock_guard lock(mutex_);
+  framed_ = true;
+  return true;
+}
+
+bool SimulatedBoard::enable_tags() {
+  const uint8_t command = mixer::commands::ENABLE_TAGS;
+  send(0, &command, 1);
+  const auto ack = receive(0, mixer::Ack::wire_size);
+  if (ack.empty() || mixer::Ack::View(ack.data()).get<mixer::fields::Status>() != mixer::commands::RESPONSE_OK) {
+    return false;
+  }
+  std::lock_guard lock(mutex_);
+  tagged_ = true;
+  return true;
+}
+
+void SimulatedBoard::send(uint8_t tag, const uint8_t* payload, size_t len) {
+  bool framed, tagged;
+  {
+    std::lock_guard lock(mutex_);
+    framed = framed_;
+    tagged = tagged_;
+  }
+  std::lock_guard lock(send_mutex_);
+  if (not framed) {
+    to_client_.write(payload, len);
+    return;
+  }
+  FrameBuffer frame;
+  if (tagged) {
+    frame.append(&tag, 1);
+  }
+  frame.append(payload, len);
+  frame.send(to_client_);
+}
+
+std::vector<uint8_t> SimulatedBoard::receive(uint8_t tag, size_t n, std::chrono::milliseconds timeout) {
+  std::unique_lock lock(mutex_);
+  auto& stream = streams_[tagged_ ? tag : untagged];
+  if (not cv_.wait_for(lock, timeout, [&]() { return stream.size() >= n; })) {
+    return {};
+  }
+  std::vector<uint8_t> out(stream.begin(), stream.begin() + n);
+  stream.erase(stream.begin(), stream.begin() + n);
+  return out;
+}
+
+void SimulatedBoard::deliver(const uint8_t* data, size_t len) {
+  {
+    std::lock_guard lock(mutex_);
+    if (tagged_ && len) {
+      auto& stream = streams_[data[0]];
+      stream.insert(stream.end(), data + 1, data + len);
+    } else {
+      auto& stream = streams_[untagged];
+      stream.insert(stream.end(), data, data + len);
+    }
+  }
+  cv_.notify_all();
+}
+
+void SimulatedBoard::receive_loop() {
+  constexpr size_t crc_size = 4;
+  COBS::FrameDecoder decoder(FrameBuffer::max_encoded);
+
+  for (;;) {
+    uint8_t byte;
+    const bool received = to_board_.read(&byte, 1) == 1;
+
+    // the mode is checked after the read, it may change while waiting
+    bool framed;
+    {
+      std::lock_guard lock(mutex_);
+      if (stop_) {
+        return;
+      }
+      framed = framed_;
+    }
+    if (not received) {
+      continue;
+    }
+    if (not framed) {
+      deliver(&byte, 1);
+      continue;
+    }
+    // frames with a bad CRC are dropped, the request waiting on them times out
+    if (decoder.push(byte) == COBS::FrameDecoder::Result::FRAME && decoder.size() > crc_size &&
+        CRC::verify_crc(decoder.data(), decoder.size())) {
+      deliver(decoder.data(), decoder.size() - crc_size);
+    }
+  }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "channel.h"
+
+
+/// @brief One direction of a simulated serial line. Writes take the time the bytes need on the wire at the baud rate,
+/// like a UART without a buffer
+class SimulatedWire : public SerialLink {
+public:
+  explicit SimulatedWire(uint32_t baud);
+
+  int write(const uint8_t* data, size_t len) override;
+  int read(uint8_t* data, size_t len) override;
+
+private:
+  const std::chrono::nanoseconds byte_time_;  ///< 10 bits per byte, 8N1
+  std::mutex wire_mutex_;                     ///< one write at a time on the wire
+  std::mutex mutex_;                          ///< guards bytes_
+  std::condition_variable cv_;
+  std::deque<uint8_t> bytes_;
+};
+
+
+/// @brief Simulated board at the other end of the link, for the examples, which measure the protocol without
+/// hardware. Both directions run at the baud rate.
+///
+/// The board starts in raw mode, like the real one. After enable_framing() it sends COBS frames with a CRC, and
+/// collects the payloads of the received frames into a byte stream. After enable_tags() each request tag has its own
+/// stream, so requests can run concurrently on several threads.
+class SimulatedBoard {
+public:
+  /// @param baud speed of the link
+  explicit SimulatedBoard(uint32_t baud = 115200);
+
+  SimulatedBoard(const SimulatedBoard&) = delete;
+  SimulatedBoard& operator=(const SimulatedBoard&) = delete;
+
+  ~SimulatedBoard();
+
+  /// @brief the client's end of the link, hand it to a PortChannel
+  [[nodiscard]] SerialLink& client_link() {
+    return client_link_;
+  }
+
+  /// @brief Send ENABLE_FRAMING and wait for the acknowledgement
+  /// @return true if the client switched to frames
+  bool enable_framing();
+
+  /// @brief Send ENABLE_TAGS and wait for the acknowledgement
+  /// @return true if the client accepts tagged requests
+  bool enable_tags();
+
+  /// @brief Send @p payload in one frame, starting with @p tag once tags are enabled. Before enable_framing() the
+  /// bytes are sent as they are
+  void send(uint8_t tag, const uint8_t* payload, size_t len);
+
+  template <class Container>
+  void send(uint8_t tag, const Container& payload) {
+    send(tag, payload.data(), payload.size());
+  }
+
+  /// @brief Read @p n bytes of the responses with @p tag. Without tags, all responses share one stream
+  /// @return the bytes, empty on timeout
+  [[nodiscard]] std::vector<uint8_t> receive(uint8_t tag, size_t n,
+                                             std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+private:
+  static constexpr int untagged = -1;  ///< stream of the raw bytes, and of the frames without tags
+
+  /// @brief Route the bytes from the client to the streams, until the board is destroyed
+  void receive_loop();
+
+  /// @brief Queue the payload of a received frame, or raw bytes, on its stream
+  void deliver(const uint8_t* data, size_t len);
+
+  /// @brief End of the link, which writes one wire and reads the other
+  class LinkEnd : public SerialLink {
+  public:
+    LinkEnd(SimulatedWire& out, SimulatedWire& in) : out_(out), in_(in) {
+    }
+
+    int write(const uint8_t* data, size_t len) override {
+      return out_.write(data, len);
+    }
+
+    int read(uint8_t* data, size_t len) override {
+      return in_.read(data, len);
+    }
+
+  private:
+    SimulatedWire& out_;
+    SimulatedWire& in_;
+  };
+
+  SimulatedWire to_board_;   ///< written by the client
+  SimulatedWire to_client_;  ///< written by the board
+  LinkEnd client_link_{ to_board_, to_client_ };
+
+  std::mutex send_mutex_;  ///< one frame at a time
+
+  std::mutex mutex_;  ///< guards the state below
+  std::condition_variable cv_;
+  std::map<int, std::deque<uint8_t>> streams_;
+  bool framed_ = false;
+  bool tagged_ = false;
+  bool stop_ = false;
+  std::thread receiver_;
+};
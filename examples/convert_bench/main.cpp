@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "pixel_convert.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+
+// Throughput of the conversions of a raw icon request: the RGBA kernels of Pixels on a 256x256 image, against a plain
+// per-pixel loop for the RGB565 blend, and the whole path from a 256x256 PNG to a 48x48 RGB565 icon.
+
+
+namespace {
+
+  constexpr uint32_t size = 256;
+  constexpr size_t n_pixels = static_cast<size_t>(size) * size;
+  constexpr uint32_t icon_size = 48;
+  constexpr uint32_t background = 0x202020;
+  constexpr int n_runs = 200;
+
+  using clock = std::chrono::steady_clock;
+
+  std::vector<uint8_t> make_image() {
+    std::vector<uint8_t> rgba(n_pixels * 4);
+    uint32_t seed = 7;
+    for (size_t i = 0; i < n_pixels; ++i) {
+      seed = seed * 1103515245 + 12345;
+      rgba[i * 4 + 0] = static_cast<uint8_t>(seed >> 8);
+      rgba[i * 4 + 1] = static_cast<uint8_t>(seed >> 16);
+      rgba[i * 4 + 2] = static_cast<uint8_t>(seed >> 24);
+      rgba[i * 4 + 3] = i % 5 == 0 ? 0 : static_cast<uint8_t>(seed);
+    }
+    return rgba;
+  }
+
+  /// @brief The RGB565 blend one pixel at a time, as the reference
+  void blend_rgb565_plain(const uint8_t* rgba, size_t n, uint8_t* dst) {
+    const uint8_t bg[3] = { background >> 16 & 0xFF, background >> 8 & 0xFF, background & 0xFF };
+    for (size_t i = 0; i < n; ++i) {
+      const uint8_t* px = rgba + 4 * i;
+      const uint32_t a = px[3];
+      uint8_t c[3];
+      for (int k = 0; k < 3; ++k) {
+        uint32_t x = px[k] * a + bg[k] * (255 - a) + 128;
+        c[k] = static_cast<uint8_t>((x + (x >> 8)) >> 8);
+      }
+      const auto v = static_cast<uint16_t>(((c[0] & 0xF8) << 8) | ((c[1] & 0xFC) << 3) | (c[2] >> 3));
+      dst[2 * i] = static_cast<uint8_t>(v);
+      dst[2 * i + 1] = static_cast<uint8_t>(v >> 8);
+    }
+  }
+
+  /// @brief Run @p convert n_runs times and print the throughput in megapixels per second
+  template <class Convert>
+  void measure(const char* name, size_t pixels, Convert convert) {
+    const auto start = clock::now();
+    for (int i = 0; i < n_runs; ++i) {
+      convert();
+    }
+    const std::chrono::duration<double> elapsed = clock::now() - start;
+    std::printf("%-22s %8.1f Mpx/s   %7.1f us per image\n", name, pixels * n_runs / elapsed.count() / 1e6,
+                elapsed.count() * 1e6 / n_runs);
+  }
+
+}  // namespace
+
+
+int main() {
+  const auto rgba = make_image();
+  std::vector<uint8_t> work = rgba;
+  std::vector<uint8_t> out(n_pixels * 4);
+  std::vector<uint8_t> reference(n_pixels * 2);
+
+  std::printf("%ux%u pixels, kernels: %s, mean of %d runs\n", size, size, Pixels::kernel_name(), n_runs);
+  measure("blend_rgb565 plain", n_pixels, [&]() { blend_rgb565_plain(rgba.data(), n_pixels, reference.data()); });
+  measure("blend_rgb565", n_pixels,
+          [&]() { Pixels::blend_rgb565(rgba.data(), n_pixels, background, false, out.data()); });
+  const bool same = std::equal(reference.begin(), reference.end(), out.begin());
+  measure("blend_rgb888", n_pixels, [&]() { Pixels::blend_rgb888(rgba.data(), n_pixels, background, out.data()); });
+  measure("to_rgb565a8", n_pixels, [&]() { Pixels::to_rgb565a8(rgba.data(), n_pixels, false, out.data()); });
+  measure("swap_rb", n_pixels, [&]() { Pixels::swap_rb(work.data(), n_pixels); });
+  // with a copy of the image, premultiplying it again would only hit opaque and transparent pixels
+  measure("copy + premultiply", n_pixels, [&]() {
+    std::memcpy(work.data(), rgba.data(), rgba.size());
+    Pixels::premultiply(work.data(), n_pixels);
+  });
+  measure("resize to 48x48", n_pixels,
+          [&]() { Pixels::resize(rgba.data(), size, size, out.data(), icon_size, icon_size); });
+
+  // a request for a raw icon, from the cached PNG
+  const auto png = PNG::encode(rgba.data(), size, size);
+  std::vector<uint8_t> decoded;
+  std::vector<uint8_t> scaled(icon_size * icon_size * 4);
+  measure("PNG to 48x48 RGB565", n_pixels, [&]() {
+    uint32_t w = 0, h = 0;
+    PNG::decode(png.data(), png.size(), decoded, w, h);
+    Pixels::resize(decoded.data(), w, h, scaled.data(), icon_size, icon_size);
+    Pixels::blend_rgb565(scaled.data(), icon_size * icon_size, background, false, out.data());
+  });
+
+  if (not same) {
+    std::printf("blend_rgb565 differs from the plain loop\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include "icon_cache.h"
+#include "png_encoder.h"
+
+// The icons of 40 sessions at the start of the client. On a cold start the pack is empty, each icon is encoded to PNG
+// and put into the cache, encoding stands in for the extraction, which needs the Windows shell. On a warm start the
+// pack of the run before is opened and each icon is found in the mapping. Each start is measured a few times, with a
+// new IconCache each time.
+
+
+namespace {
+
+  namespace fs = std::filesystem;
+
+  constexpr int n_icons = 40;
+  constexpr uint32_t icon_size = 48;
+  constexpr uint64_t max_bytes = 4 * 1024 * 1024;
+  constexpr int n_runs = 5;
+
+  using clock = std::chrono::steady_clock;
+
+  volatile uint8_t sink;  ///< keeps the reads of the payloads
+
+  /// @brief A different icon for each @p seed, rows top-down
+  std::vector<uint8_t> make_icon(uint32_t seed) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(icon_size) * icon_size * 4);
+    for (uint32_t y = 0; y < icon_size; ++y) {
+      for (uint32_t x = 0; x < icon_size; ++x) {
+        uint8_t* px = &rgba[(static_cast<size_t>(y) * icon_size + x) * 4];
+        seed = seed * 1103515245 + 12345;
+        px[0] = static_cast<uint8_t>(x * 5 + seed % 7);
+        px[1] = static_cast<uint8_t>(y * 5);
+        px[2] = static_cast<uint8_t>(seed >> 24);
+        px[3] = x + y < icon_size / 4 ? 0 : 255;
+      }
+    }
+    return rgba;
+  }
+
+  double milliseconds(clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+  }
+
+}  // namespace
+
+
+int main() {
+  const fs::path file = fs::temp_directory_path() / "icon_cache_bench" / "icons.pack";
+  std::vector<std::vector<uint8_t>> icons;
+  for (int i = 0; i < n_icons; ++i) {
+    icons.push_back(make_icon(static_cast<uint32_t>(i)));
+  }
+
+  std::printf("%d icons of %ux%u pixels, mean of %d starts\n", n_icons, icon_size, icon_size, n_runs);
+  double cold = 0;
+  double warm = 0;
+  size_t found = 0;
+  for (int run = 0; run < n_runs; ++run) {
+    std::error_code ec;
+    fs::remove(file, ec);
+    {
+      const auto start = clock::now();
+      IconCache cache;
+      cache.open(file, max_bytes);
+      for (int i = 0; i < n_icons; ++i) {
+        (void)cache.put(static_cast<uint64_t>(i + 1), PNG::encode(icons[i].data(), icon_size, icon_size));
+      }
+      cold += milliseconds(clock::now() - start);
+    }
+    {
+      const auto start = clock::now();
+      IconCache cache;
+      cache.open(file, max_bytes);
+      found = 0;
+      for (int i = 0; i < n_icons; ++i) {
+        if (const auto blob = cache.find(static_cast<uint64_t>(i + 1))) {
+          // touch the payload, like sending it does
+          sink = blob.data_[blob.size_ - 1];
+          ++found;
+        }
+      }
+      warm += milliseconds(clock::now() - start);
+    }
+  }
+
+  std::printf("cold start  %8.3f ms\n", cold / n_runs);
+  std::printf("warm start  %8.3f ms   %zu of %d icons from the pack\n", warm / n_runs, found, n_icons);
+  return found == n_icons ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "VolumeAPI/simulation.h"
+#include "board_sim.h"
+#include "communication.h"
+#include "png_encoder.h"
+
+// Measures how long the board takes to load the icons of 5, 20 and 50 sessions, with one READ_IMG per session and
+// with one READ_ALL_IMG. Every 4th session is another process of the program before, and has the same icon. The
+// icons are 32x32 PNGs, the board and the audio backend are simulated, the link runs at 115200 baud.
+
+
+namespace {
+
+  namespace Sim = VolumeControl::Simulation;
+
+  constexpr int first_pid = 1000;
+  constexpr uint32_t icon_size = 32;
+  constexpr uint32_t chunk_size = 1024;
+
+  using clock = std::chrono::steady_clock;
+
+  std::vector<uint8_t> make_icon(uint32_t seed) {
+    std::vector<uint8_t> rgba(icon_size * icon_size * 4);
+    for (uint32_t i = 0; i < icon_size * icon_size; ++i) {
+      seed = seed * 1103515245 + 12345;
+      rgba[i * 4 + 0] = static_cast<uint8_t>(i % icon_size * 8);
+      rgba[i * 4 + 1] = static_cast<uint8_t>(seed >> 24);
+      rgba[i * 4 + 2] = static_cast<uint8_t>(i / icon_size * 8);
+      rgba[i * 4 + 3] = 255;
+    }
+    return PNG::encode(rgba.data(), icon_size, icon_size);
+  }
+
+  void add_sessions(int n) {
+    Sim::reset();
+    for (int i = 0; i < n; ++i) {
+      const int pid = first_pid + i;
+      Sim::add_session(pid, L"app" + std::to_wstring(pid));
+      Sim::set_icon(pid, make_icon(static_cast<uint32_t>(i % 4 == 3 ? i - 1 : i)));
+    }
+  }
+
+  /// @brief Receive @p size bytes in chunks, acknowledging each
+  /// @return true if everything was received
+  bool receive_chunks(SimulatedBoard& board, uint32_t size) {
+    for (uint32_t received = 0; received < size;) {
+      const uint32_t n = std::min(chunk_size, size - received);
+      if (board.receive(0, n + 4).empty()) {
+        return false;
+      }
+      received += n;
+      board.send(0, mixer::Ack::encode(mixer::commands::RESPONSE_OK));
+    }
+    return true;
+  }
+
+  /// @brief Load the icon of each session with its own request, the master's too
+  /// @return the number of icons received, -1 on failure
+  int load_each(SimulatedBoard& board, int n_sessions) {
+    std::vector<int16_t> pids{ -1 };
+    for (int i = 0; i < n_sessions; ++i) {
+      pids.push_back(static_cast<int16_t>(first_pid + i));
+    }
+    int icons = 0;
+    for (const int16_t pid : pids) {
+      std::vector<uint8_t> request{ mixer::commands::READ_IMG };
+      const auto pid_data = mixer::ImgRequest::encode(pid);
+      request.insert(request.end(), pid_data.begin(), pid_data.end());
+      board.send(0, request);
+
+      const auto size_data = board.receive(0, mixer::ImageSizeMessage::wire_size);
+      if (size_data.empty()) {
+        return -1;
+      }
+      board.send(0, mixer::ChunkSizeMessage::encode(chunk_size));
+      if (not receive_chunks(board, mixer::ImageSizeMessage::View(size_data.data()).get<mixer::fields::ImageSize>())) {
+        return -1;
+      }
+      ++icons;
+    }
+    return icons;
+  }
+
+  /// @brief Load every icon with READ_ALL_IMG
+  /// @return the number of distinct icons received, -1 on failure
+  int load_all(SimulatedBoard& board) {
+    board.send(0, std::vector<uint8_t>{ mixer::commands::READ_ALL_IMG });
+    const auto counts = board.receive(0, 2 + 4);
+    if (counts.empty()) {
+      return -1;
+    }
+    const uint8_t n_sessions = counts[0];
+    const uint8_t n_icons = counts[1];
+    // the table of the sessions, then the sizes of the icons, each with its CRC
+    if (board.receive(0, n_sessions * 3 + 4).empty()) {
+      return -1;
+    }
+    const auto size_data = board.receive(0, n_icons * 4 + 4);
+    if (size_data.empty()) {
+      return -1;
+    }
+    board.send(0, mixer::ChunkSizeMessage::encode(chunk_size));
+    for (uint8_t i = 0; i < n_icons; ++i) {
+      uint32_t size = 0;
+      std::memcpy(&size, size_data.data() + i * 4, 4);
+      if (not receive_chunks(board, size)) {
+        return -1;
+      }
+    }
+    return n_icons;
+  }
+
+  double seconds(clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  }
+
+}  // namespace
+
+
+int main() {
+  if (not VolumeControl::init()) {
+    return 1;
+  }
+
+  SimulatedBoard board;
+  PortChannel channel(board.client_link());
+  std::atomic<bool> stop{ false };
+  std::thread client([&]() {
+    while (not stop) {
+      serial_comm(channel);
+    }
+  });
+
+  int result = 0;
+  if (not board.enable_framing()) {
+    std::printf("framing refused\n");
+    result = 1;
+  }
+  for (const int n : { 5, 20, 50 }) {
+    if (result != 0) {
+      break;
+    }
+    add_sessions(n);
+    // the icons are read once before, like by the LOAD_ALL the board starts with
+    (void)VolumeControl::get_session_snapshot().infos();
+
+    auto start = clock::now();
+    const int each = load_each(board, n);
+    const double each_time = seconds(clock::now() - start);
+    start = clock::now();
+    const int all = load_all(board);
+    const double all_time = seconds(clock::now() - start);
+    if (each < 0 || all < 0) {
+      std::printf("icon transfer failed\n");
+      result = 1;
+      break;
+    }
+    std::printf("%2d sessions   READ_IMG each: %6.2f s, %2d icons   READ_ALL_IMG: %6.2f s, %2d icons\n", n, each_time,
+                each, all_time, all);
+  }
+
+  // the client notices the silence after its timeout
+  stop = true;
+  client.join();
+  return result;
+}
@@ -0,0 +1,67 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "process_api.h"
+#include "process_cache.h"
+
+// Resolves the executable paths of the running processes, like each poll of the session list does, once per poll
+// without a cache, with an empty PathCache (every lookup misses), and with a PathCache of the previous poll (every
+// lookup hits). The processes are the real ones of this machine.
+
+
+namespace {
+
+  constexpr int n_runs = 20;
+
+  using clock = std::chrono::steady_clock;
+
+  /// @brief Run @p poll n_runs times and print the mean time per poll and per process
+  template <class Poll>
+  void measure(const char* mode, size_t n_processes, Poll poll) {
+    size_t resolved = 0;
+    const auto start = clock::now();
+    for (int i = 0; i < n_runs; ++i) {
+      resolved = poll();
+    }
+    const std::chrono::duration<double, std::micro> elapsed = clock::now() - start;
+    std::printf("%-12s %9.1f us per poll   %6.2f us per process   %zu paths\n", mode, elapsed.count() / n_runs,
+                elapsed.count() / n_runs / n_processes, resolved);
+  }
+
+  /// @brief Read the path of each record, the record resolves it on the first read
+  size_t read_paths(ProcessAPI::PathCache& cache, const std::vector<int>& pids) {
+    (void)cache.refresh(pids);
+    size_t resolved = 0;
+    for (const int pid : pids) {
+      resolved += not cache.find(pid)->path().empty();
+    }
+    return resolved;
+  }
+
+}  // namespace
+
+
+int main() {
+  std::vector<int> pids;
+  for (const auto& process : ProcessAPI::get_process_snapshot()) {
+    pids.push_back(process.pid_);
+  }
+  std::printf("%zu processes, mean of %d polls\n", pids.size(), n_runs);
+
+  measure("no cache", pids.size(), [&pids]() {
+    size_t resolved = 0;
+    for (const int pid : pids) {
+      resolved += not ProcessAPI::get_path_from_pid(pid).empty();
+    }
+    return resolved;
+  });
+
+  ProcessAPI::PathCache cache;
+  measure("cache miss", pids.size(), [&]() {
+    cache.clear();
+    return read_paths(cache, pids);
+  });
+  measure("cache hit", pids.size(), [&]() { return read_paths(cache, pids); });
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "png_encoder.h"
+
+// Converts icons of 32x32, 48x48 and 256x256 pixels to PNG with the built-in encoder, and the way the client did
+// before: the icon written to a temporary .ico file, converted by an ImageMagick process, and the .png read back.
+// ImageMagick is only measured if `magick` is on the PATH.
+
+
+namespace {
+
+  namespace fs = std::filesystem;
+
+  using clock = std::chrono::steady_clock;
+
+#ifdef _WIN32
+  constexpr const char* null_device = "nul";
+#else
+  constexpr const char* null_device = "/dev/null";
+#endif
+
+  /// @brief An icon with a gradient, a transparent corner and some noise, rows top-down
+  std::vector<uint8_t> make_icon(uint32_t size) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(size) * size * 4);
+    uint32_t seed = 1;
+    for (uint32_t y = 0; y < size; ++y) {
+      for (uint32_t x = 0; x < size; ++x) {
+        uint8_t* px = &rgba[(static_cast<size_t>(y) * size + x) * 4];
+        seed = seed * 1103515245 + 12345;
+        px[0] = static_cast<uint8_t>(x * 255 / size);
+        px[1] = static_cast<uint8_t>(y * 255 / size);
+        px[2] = static_cast<uint8_t>(128 + (seed >> 28));
+        px[3] = x + y < size / 4 ? 0 : 255;
+      }
+    }
+    return rgba;
+  }
+
+  template <class T>
+  void append(std::vector<uint8_t>& out, T value) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+  }
+
+  /// @brief A .ico with one 32 bpp DIB image, like the ones the client wrote for ImageMagick
+  std::vector<uint8_t> make_ico(const std::vector<uint8_t>& rgba, uint32_t size) {
+    const uint32_t mask_stride = (size + 31) / 32 * 4;
+    const uint32_t image_size = 40 + size * size * 4 + mask_stride * size;
+    std::vector<uint8_t> ico;
+    append<uint16_t>(ico, 0);
+    append<uint16_t>(ico, 1);  // icon
+    append<uint16_t>(ico, 1);  // one image
+    ico.push_back(static_cast<uint8_t>(size));  // 256 is stored as 0
+    ico.push_back(static_cast<uint8_t>(size));
+    ico.push_back(0);
+    ico.push_back(0);
+    append<uint16_t>(ico, 1);
+    append<uint16_t>(ico, 32);
+    append<uint32_t>(ico, image_size);
+    append<uint32_t>(ico, 6 + 16);
+
+    // BITMAPINFOHEADER, the height counts the AND mask too
+    append<uint32_t>(ico, 40);
+    append<int32_t>(ico, static_cast<int32_t>(size));
+    append<int32_t>(ico, static_cast<int32_t>(size * 2));
+    append<uint16_t>(ico, 1);
+    append<uint16_t>(ico, 32);
+    for (int i = 0; i < 6; ++i) {
+      append<uint32_t>(ico, 0);
+    }
+    // BGRA rows bottom-up, then an empty AND mask
+    for (uint32_t y = size; y-- > 0;) {
+      for (uint32_t x = 0; x < size; ++x) {
+        const uint8_t* px = &rgba[(static_cast<size_t>(y) * size + x) * 4];
+        ico.insert(ico.end(), { px[2], px[1], px[0], px[3] });
+      }
+    }
+    ico.insert(ico.end(), static_cast<size_t>(mask_stride) * size, 0);
+    return ico;
+  }
+
+  /// @brief The conversion the client did before the built-in encoder
+  std::vector<uint8_t> convert_with_magick(const std::vector<uint8_t>& ico) {
+    const auto temp_dir = fs::temp_directory_path();
+    const auto ico_path = temp_dir / "png_bench.ico";
+    const auto png_path = temp_dir / "png_bench.png";
+    {
+      std::ofstream ico_file(ico_path, std::ios::out | std::ios::binary);
+      ico_file.write(reinterpret_cast<const char*>(ico.data()), static_cast<std::streamsize>(ico.size()));
+    }
+    const std::string command = "magick \"" + ico_path.string() + "\" \"" + png_path.string() + "\"";
+    if (std::system(command.c_str()) != 0) {
+      return {};
+    }
+    std::ifstream png_file(png_path, std::ios::in | std::ios::binary);
+    std::vector<uint8_t> png((std::istreambuf_iterator<char>(png_file)), std::istreambuf_iterator<char>());
+    png_file.close();
+    fs::remove(ico_path);
+    fs::remove(png_path);
+    return png;
+  }
+
+  /// @brief Run @p convert @p n_runs times and print the mean time and the size of the PNG
+  template <class Convert>
+  void measure(const char* mode, uint32_t size, int n_runs, Convert convert) {
+    size_t png_size = 0;
+    const auto start = clock::now();
+    for (int i = 0; i < n_runs; ++i) {
+      png_size = convert().size();
+    }
+    const std::chrono::duration<double, std::micro> elapsed = clock::now() - start;
+    std::printf("%3ux%-3u %-10s %10.1f us   %6zu bytes\n", size, size, mode, elapsed.count() / n_runs, png_size);
+  }
+
+}  // namespace
+
+
+int main() {
+  const std::string probe = std::string("magick -version > ") + null_device + " 2>&1";
+  const bool have_magick = std::system(probe.c_str()) == 0;
+  if (not have_magick) {
+    std::printf("magick is not on the PATH, only the built-in encoder is measured\n");
+  }
+
+  for (const uint32_t size : { 32u, 48u, 256u }) {
+    const auto rgba = make_icon(size);
+    measure("built-in", size, 100, [&]() { return PNG::encode(rgba.data(), size, size); });
+    if (have_magick) {
+      const auto ico = make_ico(rgba, size);
+      measure("magick", size, 10, [&]() { return convert_with_magick(ico); });
+    }
+  }
+  return 0;
+}
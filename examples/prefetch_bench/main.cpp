@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "icon_prefetcher.h"
+#include "latency_stats.h"
+
+// Measures the first byte latency of icon requests, with and without the prefetch pool. 20 sessions appear at once,
+// like at the start of the client. The board loads the list and then asks for the icons one after the other, each
+// transfer takes 30 ms on the wire. Extracting an icon is modelled with 25 ms, the pool has 2 workers like the one
+// of VolumeAPI. With prefetch, a request waits for the job of its icon, if it is running, and cancels it if it is
+// still queued.
+
+
+namespace {
+
+  constexpr int n_sessions = 20;
+  constexpr auto extract_time = std::chrono::milliseconds(25);
+  constexpr auto list_time = std::chrono::milliseconds(40);  ///< the board loads the session list first
+  constexpr auto transfer_time = std::chrono::milliseconds(30);
+
+  using clock = std::chrono::steady_clock;
+
+  class Icons {
+  public:
+    void extract(const std::wstring& path) {
+      std::this_thread::sleep_for(extract_time);
+      std::lock_guard lock(mutex_);
+      cached_.insert(path);
+    }
+
+    [[nodiscard]] bool cached(const std::wstring& path) {
+      std::lock_guard lock(mutex_);
+      return cached_.count(path) != 0;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::set<std::wstring> cached_;
+  };
+
+  /// @brief The sessions appear, the board reads the list and then the icons
+  void run(const char* mode, bool prefetch) {
+    Icons icons;
+    IconPrefetcher prefetcher([&icons](const std::wstring& path) { icons.extract(path); }, 2, 64);
+    std::vector<std::wstring> paths;
+    for (int i = 0; i < n_sessions; ++i) {
+      paths.push_back(L"app" + std::to_wstring(i) + L".exe");
+      if (prefetch) {
+        prefetcher.request(paths.back());
+      }
+    }
+
+    std::this_thread::sleep_for(list_time);
+    LatencyStats latency(n_sessions);
+    int hits = 0;
+    for (const auto& path : paths) {
+      const auto requested = clock::now();
+      prefetcher.wait_or_cancel(path);
+      if (icons.cached(path)) {
+        ++hits;
+      } else {
+        icons.extract(path);
+      }
+      latency.add(std::chrono::duration_cast<LatencyStats::duration_t>(clock::now() - requested));
+      std::this_thread::sleep_for(transfer_time);
+    }
+
+    std::printf("%-12s p50 %6.1f ms   p99 %6.1f ms   %2d of %d prepared\n", mode,
+                latency.percentile(50).count() / 1000.0, latency.percentile(99).count() / 1000.0, hits, n_sessions);
+  }
+
+}  // namespace
+
+
+int main() {
+  std::printf("first byte latency of %d icon requests\n", n_sessions);
+  run("no prefetch", false);
+  run("prefetch", true);
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "VolumeAPI/simulation.h"
+#include "board_sim.h"
+#include "communication.h"
+#include "latency_stats.h"
+
+// Measures the response time of control requests, while concurrent icon transfers saturate the link. The board
+// sends a change query every 20 ms, and reads 12 KB icons on three tags at the same time. The board and the audio
+// backend are simulated, the link runs at 115200 baud.
+
+
+namespace {
+
+  constexpr uint16_t icon_size = 64;  ///< RGB888, 12 KB per icon
+  constexpr uint32_t chunk_size = 4096;
+  constexpr uint8_t n_transfers = 3;
+  constexpr auto control_period = std::chrono::milliseconds(20);
+  constexpr int n_samples = 200;
+
+  using clock = std::chrono::steady_clock;
+
+  /// @brief Read the master icon as raw pixels
+  /// @return true if the whole icon was received
+  bool read_icon(SimulatedBoard& board, uint8_t tag) {
+    std::vector<uint8_t> request{ mixer::commands::READ_IMG_RAW };
+    const auto raw = mixer::ImgRawRequest::encode(-1, static_cast<uint8_t>(VolumeControl::PixelFormat::RGB888), 0,
+                                                  icon_size, icon_size, 0);
+    request.insert(request.end(), raw.begin(), raw.end());
+    board.send(tag, request);
+
+    const auto size_data = board.receive(tag, mixer::ImageSizeMessage::wire_size);
+    if (size_data.empty()) {
+      return false;
+    }
+    const uint32_t size = mixer::ImageSizeMessage::View(size_data.data()).get<mixer::fields::ImageSize>();
+    board.send(tag, mixer::ChunkSizeMessage::encode(chunk_size));
+
+    for (uint32_t received = 0; received < size;) {
+      const uint32_t n = std::min(chunk_size, size - received);
+      if (board.receive(tag, n + 4).empty()) {
+        return false;
+      }
+      received += n;
+      board.send(tag, mixer::Ack::encode(mixer::commands::RESPONSE_OK));
+    }
+    return true;
+  }
+
+}  // namespace
+
+
+int main() {
+  namespace Sim = VolumeControl::Simulation;
+  if (not VolumeControl::init()) {
+    return 1;
+  }
+  for (int pid = 1000; pid < 1008; ++pid) {
+    Sim::add_session(pid, L"app" + std::to_wstring(pid));
+  }
+
+  SimulatedBoard board;
+  PortChannel channel(board.client_link());
+  std::atomic<bool> stop{ false };
+  std::thread client([&]() {
+    while (not stop) {
+      serial_comm(channel);
+    }
+  });
+
+  int result = 1;
+  if (not board.enable_framing() || not board.enable_tags()) {
+    std::printf("tagged requests refused\n");
+  } else {
+    std::atomic<bool> done{ false };
+    std::atomic<unsigned> icons{ 0 };
+    std::vector<std::thread> transfers;
+    for (uint8_t tag = 1; tag <= n_transfers; ++tag) {
+      transfers.emplace_back([&, tag]() {
+        while (not done) {
+          if (read_icon(board, tag)) {
+            ++icons;
+          } else {
+            std::printf("icon transfer failed\n");
+          }
+        }
+      });
+    }
+
+    // the queries wait for their response, a new tag each time
+    LatencyStats response(n_samples);
+    LatencyStats::duration_t worst{};
+    unsigned lost = 0;
+    uint8_t tag = n_transfers + 1;
+    auto next = clock::now();
+    for (int i = 0; i < n_samples; ++i) {
+      next += control_period;
+      std::this_thread::sleep_until(next);
+      const auto sent = clock::now();
+      board.send(tag, std::vector<uint8_t>{ mixer::commands::QUERY_CHANGES });
+      if (board.receive(tag, mixer::ChangesReply::wire_size).empty()) {
+        ++lost;
+      }
+      const auto delay = std::chrono::duration_cast<LatencyStats::duration_t>(clock::now() - sent);
+      response.add(delay);
+      worst = std::max(worst, delay);
+      tag = tag == 250 ? n_transfers + 1 : tag + 1;
+      next = std::max(next, clock::now());
+    }
+
+    done = true;
+    for (auto& transfer : transfers) {
+      transfer.join();
+    }
+
+    std::printf("\ncontrol response time, %d change queries, %u icons of %d KB read meanwhile\n", n_samples,
+                icons.load(), icon_size * icon_size * 3 / 1024);
+    std::printf("p50 %.1f ms   p99 %.1f ms   max %.1f ms   lost %u\n", response.percentile(50).count() / 1000.0,
+                response.percentile(99).count() / 1000.0, worst.count() / 1000.0, lost);
+    const auto queuing = get_control_delay_stats();
+    std::printf("control frame queuing, client side: p50 %.1f ms   p99 %.1f ms\n",
+                queuing.percentile(50).count() / 1000.0, queuing.percentile(99).count() / 1000.0);
+    const auto first_byte = get_img_latency_stats();
+    std::printf("icon first byte, client side: p50 %.1f ms   p99 %.1f ms\n",
+                first_byte.percentile(50).count() / 1000.0, first_byte.percentile(99).count() / 1000.0);
+    result = 0;
+  }
+
+  // the client notices the silence after its timeout
+  stop = true;
+  client.join();
+  return result;
+}
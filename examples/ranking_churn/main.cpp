@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "VolumeAPI/simulation.h"
+#include "communication.h"
+#include "session_ranking.h"
+
+// Measures how often the sessions in the top slots of LOAD_TOP change, while the simulated sessions play, pause,
+// start and end. The board asks for the top sessions every 250 ms, an ActivitySampler reads the meters like the
+// client does. A call starts after 8 s and the music player ends after 14 s. At the end the board stops asking, and
+// the sampler has to stop reading the meters.
+
+
+namespace {
+
+  namespace Sim = VolumeControl::Simulation;
+  using namespace std::chrono_literals;
+  using clock = std::chrono::steady_clock;
+
+  constexpr size_t slots = 8;
+  constexpr int n_silent = 34;
+  constexpr auto request_period = 250ms;
+  constexpr auto duration = 20s;
+  constexpr auto call_start = 8s;
+  constexpr auto player_end = 14s;
+  constexpr auto idle_after = 2s;  ///< shorter than the client's, to keep the run short
+
+  constexpr int player_pid = 1000;
+  constexpr int call_pid = 1100;
+
+  void add_sessions() {
+    Sim::add_session(player_pid, L"player");
+    Sim::set_level(player_pid, Sim::fading(0.8f, 4s));
+    Sim::add_session(1001, L"browser");
+    Sim::set_level(1001, Sim::pulses(0.5f, 3s, 5s));
+    Sim::add_session(1002, L"chat");
+    Sim::set_level(1002, Sim::pulses(0.3f, 200ms, 2s));
+    for (int pid = 1003; pid < 1006; ++pid) {
+      Sim::add_session(pid, L"game" + std::to_wstring(pid));
+      Sim::set_level(pid, Sim::fading(0.2f, 10s));
+    }
+    for (int pid = 1006; pid < 1006 + n_silent; ++pid) {
+      Sim::add_session(pid, L"app" + std::to_wstring(pid));
+    }
+  }
+
+  double seconds(clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  }
+
+}  // namespace
+
+
+int main() {
+  if (not VolumeControl::init()) {
+    return 1;
+  }
+  Sim::reset();
+  add_sessions();
+
+  SessionRanking ranking(mixer::ACTIVITY_HALF_LIFE);
+  ranking.update(VolumeControl::get_meter_samples());
+  ActivitySampler sampler(ranking, mixer::ACTIVITY_PERIOD, idle_after);
+
+  std::set<int> held;  ///< every pid, which had a slot
+  std::set<int> previous;
+  unsigned changes = 0;
+  unsigned requests = 0;
+  bool call_started = false;
+  bool player_ended = false;
+  double call_entered = -1;
+  double player_left = -1;
+
+  const auto start = clock::now();
+  for (auto next = start; next - start < duration; next += request_period) {
+    std::this_thread::sleep_until(next);
+    const auto elapsed = clock::now() - start;
+    if (not call_started && elapsed >= call_start) {
+      Sim::add_session(call_pid, L"call");
+      Sim::set_level(call_pid, Sim::pulses(0.7f, 1500ms, 500ms));
+      call_started = true;
+    }
+    if (not player_ended && elapsed >= player_end) {
+      Sim::remove_sessions(player_pid);
+      player_ended = true;
+    }
+
+    sampler.request();
+    const auto top = ranking.top(slots);
+    const std::set<int> current(top.begin(), top.end());
+    ++requests;
+    if (not previous.empty()) {
+      changes += static_cast<unsigned>(
+          std::count_if(current.begin(), current.end(), [&](int pid) { return previous.count(pid) == 0; }));
+    }
+    held.insert(current.begin(), current.end());
+    previous = current;
+
+    if (call_started && call_entered < 0 && current.count(call_pid)) {
+      call_entered = seconds(elapsed - call_start);
+    }
+    if (player_ended && player_left < 0 && current.count(player_pid) == 0) {
+      player_left = seconds(elapsed - player_end);
+    }
+  }
+
+  // the board stops asking, the sampler stops reading the meters after idle_after
+  std::this_thread::sleep_for(idle_after + 500ms);
+  const uint64_t before_idle = Sim::enumerations();
+  std::this_thread::sleep_for(1s);
+  const uint64_t idle_readings = Sim::enumerations() - before_idle;
+
+  const double minutes = seconds(duration) / 60;
+  std::printf("top %zu of %zu sessions, %u requests in %.0f s\n", slots, ranking.size(), requests,
+              seconds(duration));
+  std::printf("slot changes: %u, %.1f per minute, %zu sessions held a slot\n", changes, changes / minutes,
+              held.size());
+  std::printf("the call took a slot %.2f s after it started\n", call_entered);
+  std::printf("the player left its slot %.2f s after it ended\n", player_left);
+  std::printf("meter readings in 1 s while idle: %llu\n", static_cast<unsigned long long>(idle_readings));
+  return call_entered >= 0 && player_left >= 0 && idle_readings == 0 ? 0 : 1;
+}
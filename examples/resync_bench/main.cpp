@@ -0,0 +1,189 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "VolumeAPI/simulation.h"
+#include "board_sim.h"
+#include "communication.h"
+
+// Measures how long the link takes to recover after one byte of a request is lost, corrupted or added, in raw mode
+// and with COBS frames. The simulated board sets a volume and then polls QUERY_CHANGES, it waits 500 ms for each
+// reply and polls again. The fault hits one of the first 8 bytes of the SET_VOLUME request, the recovery time runs
+// from the request to the first valid reply. The link runs at 115200 baud.
+
+
+namespace {
+
+  namespace Sim = VolumeControl::Simulation;
+  using namespace std::chrono_literals;
+  using clock = std::chrono::steady_clock;
+
+  constexpr int pid = 1000;
+  constexpr size_t positions = 8;
+  constexpr auto reply_timeout = 500ms;
+  constexpr auto give_up = 15s;
+
+  enum class Fault {
+    NONE,
+    DROP,   ///< the byte is lost
+    FLIP,   ///< a bit of the byte flips
+    EXTRA,  ///< a noise byte arrives before it
+  };
+
+  /// @brief The client's end of the link, which injects one fault into the bytes from the board
+  class LossyLink : public SerialLink {
+  public:
+    explicit LossyLink(SerialLink& link) : link_(link) {
+    }
+
+    /// @brief Hit the byte at @p position of the next bytes read with @p fault
+    void inject(Fault fault, size_t position) {
+      std::lock_guard lock(mutex_);
+      fault_ = fault;
+      position_ = position;
+    }
+
+    int write(const uint8_t* data, size_t len) override {
+      return link_.write(data, len);
+    }
+
+    int read(uint8_t* data, size_t len) override {
+      if (len == 0) {
+        return 0;
+      }
+      std::lock_guard lock(mutex_);
+      if (pending_) {
+        data[0] = *pending_;
+        pending_.reset();
+        return 1;
+      }
+      // a byte at a time, so the fault hits exactly one
+      const int n = link_.read(data, 1);
+      if (n <= 0 || fault_ == Fault::NONE || position_-- > 0) {
+        return n;
+      }
+      const Fault fault = fault_;
+      fault_ = Fault::NONE;
+      switch (fault) {
+        case Fault::DROP:
+          return 0;
+        case Fault::FLIP:
+          data[0] ^= 0x40;
+          return 1;
+        default:
+          pending_ = data[0];
+          data[0] = 0x5A;
+          return 1;
+      }
+    }
+
+  private:
+    SerialLink& link_;
+    std::mutex mutex_;
+    Fault fault_ = Fault::NONE;
+    size_t position_ = 0;
+    std::optional<uint8_t> pending_;
+  };
+
+  struct Result {
+    double mean_ = 0;  ///< seconds, of the recovered trials
+    double max_ = 0;
+    unsigned lost_polls_ = 0;
+    unsigned failed_ = 0;  ///< not recovered before give_up
+  };
+
+  /// @brief Poll QUERY_CHANGES until a valid reply arrives
+  /// @return the polls without a reply, -1 if none arrived before @p deadline
+  int poll_until_reply(SimulatedBoard& board, clock::time_point deadline) {
+    int lost = 0;
+    while (clock::now() < deadline) {
+      board.send(0, std::vector<uint8_t>{ mixer::commands::QUERY_CHANGES });
+      const auto reply = board.receive(0, mixer::ChangesReply::wire_size, reply_timeout);
+      if (not reply.empty() && mixer::ChangesReply::verify(reply.data())) {
+        return lost;
+      }
+      ++lost;
+    }
+    return -1;
+  }
+
+  Result measure(SimulatedBoard& board, LossyLink& link, Fault fault) {
+    Result result;
+    unsigned recovered = 0;
+    for (size_t position = 0; position < positions; ++position) {
+      std::vector<uint8_t> request{ mixer::commands::SET_VOLUME };
+      const auto volume = mixer::SetVolumeRequest::encode(pid, static_cast<uint8_t>(20 + position));
+      request.insert(request.end(), volume.begin(), volume.end());
+
+      const auto start = clock::now();
+      link.inject(fault, position);
+      board.send(0, request);
+      const int lost = poll_until_reply(board, start + give_up);
+      const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      link.inject(Fault::NONE, 0);
+      if (lost < 0) {
+        ++result.failed_;
+        continue;
+      }
+      ++recovered;
+      result.mean_ += elapsed;
+      result.max_ = std::max(result.max_, elapsed);
+      result.lost_polls_ += static_cast<unsigned>(lost);
+    }
+    if (recovered) {
+      result.mean_ /= recovered;
+    }
+    return result;
+  }
+
+  /// @brief Run the faults against a new board and client, in raw mode or with frames
+  /// @return false if the link couldn't be set up
+  bool run(bool framed) {
+    SimulatedBoard board;
+    LossyLink link(board.client_link());
+    PortChannel channel(link);
+    std::atomic<bool> stop{ false };
+    std::thread client([&]() {
+      while (not stop) {
+        serial_comm(channel);
+      }
+    });
+
+    bool ok = not framed || board.enable_framing();
+    if (ok) {
+      const char* mode = framed ? "COBS frames" : "raw";
+      for (const auto& [fault, name] : { std::pair{ Fault::NONE, "no fault" }, std::pair{ Fault::DROP, "lost byte" },
+                                         std::pair{ Fault::FLIP, "flipped bit" },
+                                         std::pair{ Fault::EXTRA, "extra byte" } }) {
+        const auto result = measure(board, link, fault);
+        std::printf("%-12s %-12s mean %6.3f s   max %6.3f s   %2u polls lost   %u of %zu not recovered\n", mode,
+                    name, result.mean_, result.max_, result.lost_polls_, result.failed_, positions);
+      }
+    } else {
+      std::printf("framing refused\n");
+    }
+
+    // the client notices the silence after its timeout
+    stop = true;
+    client.join();
+    return ok;
+  }
+
+}  // namespace
+
+
+int main() {
+  if (not VolumeControl::init()) {
+    return 1;
+  }
+  Sim::reset();
+  Sim::add_session(pid, L"player", 50);
+
+  const bool raw = run(false);
+  const bool framed = run(true);
+  return raw && framed ? 0 : 1;
+}
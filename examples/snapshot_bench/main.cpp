@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+// Measures the SessionSnapshot with 1000 sessions on 2 devices, against the vector of AudioSessionInfo the client
+// used before: building it from the enumerated sessions, looking up every pid, reading every name, and copying it.
+// The records have fixed names, so nothing is resolved during the measurement.
+
+
+namespace {
+
+  namespace VC = VolumeControl;
+
+  constexpr int n_sessions = 1000;
+  constexpr int first_pid = 1000;
+  constexpr int n_runs = 200;
+
+  using clock = std::chrono::steady_clock;
+
+  /// @brief Run @p run n_runs times and print the mean time per run and per session
+  template <class Run>
+  void measure(const char* mode, Run run) {
+    size_t result = 0;
+    const auto start = clock::now();
+    for (int i = 0; i < n_runs; ++i) {
+      result += run();
+    }
+    const std::chrono::duration<double, std::micro> elapsed = clock::now() - start;
+    std::printf("%-28s %9.1f us   %7.1f ns per session   (%zu)\n", mode, elapsed.count() / n_runs,
+                elapsed.count() * 1000 / n_runs / n_sessions, result / n_runs);
+  }
+
+  /// @brief the sessions in the order the devices enumerate them, unsorted, every 4th on the second device
+  struct Session {
+    int pid_;
+    uint8_t endpoint_;
+    std::shared_ptr<const VC::SessionRecord> record_;
+  };
+
+  std::vector<Session> make_sessions() {
+    std::vector<Session> sessions;
+    for (int i = 0; i < n_sessions; ++i) {
+      const int pid = first_pid + (i * 7919) % n_sessions;
+      const auto endpoint = static_cast<uint8_t>(i % 4 == 3 ? 1 : 0);
+      sessions.push_back({ pid, endpoint, std::make_shared<VC::SessionRecord>(pid, L"app" + std::to_wstring(pid)) });
+    }
+    return sessions;
+  }
+
+  VC::SessionSnapshot build(const std::vector<Session>& sessions, const VC::SessionSnapshot& previous) {
+    VC::SessionSnapshot::Builder builder;
+    for (const auto& session : sessions) {
+      builder.add(session.pid_, session.endpoint_, 50, false, session.record_);
+    }
+    return builder.build(previous);
+  }
+
+  std::vector<VC::AudioSessionInfo> build_infos(const std::vector<Session>& sessions) {
+    std::vector<VC::AudioSessionInfo> infos;
+    for (const auto& session : sessions) {
+      VC::AudioSessionInfo info{};
+      info.path_ = session.record_->path();
+      info.filename_ = session.record_->filename();
+      info.name_utf8_ = session.record_->name_utf8();
+      info.pid_ = session.pid_;
+      info.endpoint_ = session.endpoint_;
+      info.volume_ = 50;
+      info.record_ = session.record_;
+      infos.push_back(std::move(info));
+    }
+    return infos;
+  }
+
+}  // namespace
+
+
+int main() {
+  const auto sessions = make_sessions();
+  const auto snapshot = build(sessions, {});
+  const auto infos = snapshot.infos();
+  std::printf("%d sessions, mean of %d runs\n", n_sessions, n_runs);
+
+  measure("build snapshot", [&]() { return build(sessions, snapshot).size(); });
+  measure("build AudioSessionInfo list", [&]() { return build_infos(sessions).size(); });
+
+  measure("find() every pid", [&]() {
+    size_t found = 0;
+    for (int pid = first_pid; pid < first_pid + n_sessions; ++pid) {
+      found += snapshot.find(pid) != snapshot.npos;
+    }
+    return found;
+  });
+  measure("search the list for every pid", [&]() {
+    size_t found = 0;
+    for (int pid = first_pid; pid < first_pid + n_sessions; ++pid) {
+      found += std::find_if(infos.begin(), infos.end(), [pid](const auto& info) { return info.pid_ == pid; }) !=
+               infos.end();
+    }
+    return found;
+  });
+
+  measure("read the names of snapshot", [&]() {
+    size_t bytes = 0;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+      bytes += snapshot.name_utf8(i).size();
+    }
+    return bytes;
+  });
+  measure("read the names of the list", [&]() {
+    size_t bytes = 0;
+    for (const auto& info : infos) {
+      bytes += info.name_utf8_.size();
+    }
+    return bytes;
+  });
+
+  measure("copy snapshot", [&]() {
+    const auto copy = snapshot;
+    return copy.size();
+  });
+  measure("copy the list", [&]() {
+    const auto copy = infos;
+    return copy.size();
+  });
+  measure("snapshot infos()", [&]() { return snapshot.infos().size(); });
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+#include "VolumeAPI/simulation.h"
+#include "board_sim.h"
+#include "communication.h"
+#include "latency_stats.h"
+
+// Measures how long a volume change takes from the board to the audio session, while icons are transferred, with
+// one request at a time and with tagged requests. The board and the audio backend are simulated, the link runs at
+// 115200 baud.
+
+
+namespace {
+
+  constexpr int16_t volume_pid = 1000;  ///< session the knob turns
+  constexpr uint16_t icon_size = 48;    ///< RGB565, 4.5 KB per icon
+  constexpr uint32_t chunk_size = 1024;
+  constexpr int n_samples = 20;
+  constexpr auto knob_period = std::chrono::milliseconds(37);
+
+  using clock = std::chrono::steady_clock;
+
+  /// @brief Read the master icon as raw pixels, like the board does for its display
+  /// @return true if the whole icon was received
+  bool read_icon(SimulatedBoard& board, uint8_t tag) {
+    std::vector<uint8_t> request{ mixer::commands::READ_IMG_RAW };
+    const auto raw = mixer::ImgRawRequest::encode(-1, static_cast<uint8_t>(VolumeControl::PixelFormat::RGB565), 0,
+                                                  icon_size, icon_size, 0);
+    request.insert(request.end(), raw.begin(), raw.end());
+    board.send(tag, request);
+
+    const auto size_data = board.receive(tag, mixer::ImageSizeMessage::wire_size);
+    if (size_data.empty()) {
+      return false;
+    }
+    const uint32_t size = mixer::ImageSizeMessage::View(size_data.data()).get<mixer::fields::ImageSize>();
+    board.send(tag, mixer::ChunkSizeMessage::encode(chunk_size));
+
+    for (uint32_t received = 0; received < size;) {
+      const uint32_t n = std::min(chunk_size, size - received);
+      if (board.receive(tag, n + 4).empty()) {
+        return false;
+      }
+      received += n;
+      board.send(tag, mixer::Ack::encode(mixer::commands::RESPONSE_OK));
+    }
+    return true;
+  }
+
+  /// @brief Turn the knob every knob_period, while icons are read
+  /// @param tagged send the volume changes as their own requests, or wait for the icon transfer in progress
+  /// @return time from the turn of the knob to the new volume of the session
+  LatencyStats measure(SimulatedBoard& board, bool tagged) {
+    std::mutex request_mutex;  ///< without tags, the board has one request in progress
+    std::atomic<bool> knob_turned{ false };
+    std::atomic<bool> done{ false };
+
+    std::vector<std::thread> icon_readers;
+    for (uint8_t tag = 1; tag <= (tagged ? 2 : 1); ++tag) {
+      icon_readers.emplace_back([&, tag]() {
+        while (not done) {
+          // a waiting volume change goes before the next icon
+          while (not tagged && knob_turned) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          }
+          std::unique_lock lock(request_mutex, std::defer_lock);
+          if (not tagged) {
+            lock.lock();
+          }
+          if (not read_icon(board, tag)) {
+            std::printf("icon transfer failed\n");
+          }
+        }
+      });
+    }
+
+    LatencyStats latency(n_samples);
+    uint8_t tag = 3;
+    for (int i = 0; i < n_samples; ++i) {
+      std::this_thread::sleep_for(knob_period);
+      const uint8_t volume = static_cast<uint8_t>(i % 2 ? 30 : 70);
+      const auto turned = clock::now();
+      {
+        std::unique_lock lock(request_mutex, std::defer_lock);
+        if (not tagged) {
+          knob_turned = true;
+          lock.lock();
+          knob_turned = false;
+        }
+        std::vector<uint8_t> request{ mixer::commands::SET_VOLUME };
+        const auto set = mixer::SetVolumeRequest::encode(volume_pid, volume);
+        request.insert(request.end(), set.begin(), set.end());
+        board.send(tag, request);
+        // a new tag for each change, the previous request may not have finished on the client yet
+        tag = tag == 250 ? 3 : tag + 1;
+
+        while (std::abs(VolumeControl::get_volume(volume_pid) - volume) > 0.5f) {
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+      }
+      latency.add(std::chrono::duration_cast<LatencyStats::duration_t>(clock::now() - turned));
+    }
+
+    done = true;
+    for (auto& reader : icon_readers) {
+      reader.join();
+    }
+    return latency;
+  }
+
+  void print(const char* mode, const LatencyStats& latency) {
+    std::printf("%-24s p50 %7.1f ms   p99 %7.1f ms\n", mode, latency.percentile(50).count() / 1000.0,
+                latency.percentile(99).count() / 1000.0);
+  }
+
+}  // namespace
+
+
+int main() {
+  namespace Sim = VolumeControl::Simulation;
+  if (not VolumeControl::init()) {
+    return 1;
+  }
+  Sim::add_session(volume_pid, L"player", 50);
+  for (int pid = 1001; pid < 1008; ++pid) {
+    Sim::add_session(pid, L"app" + std::to_wstring(pid));
+  }
+
+  SimulatedBoard board;
+  PortChannel channel(board.client_link());
+  std::atomic<bool> stop{ false };
+  std::thread client([&]() {
+    while (not stop) {
+      serial_comm(channel);
+    }
+  });
+
+  int result = 1;
+  if (not board.enable_framing()) {
+    std::printf("framing refused\n");
+  } else {
+    const LatencyStats serial = measure(board, false);
+    if (not board.enable_tags()) {
+      std::printf("tags refused\n");
+    } else {
+      const LatencyStats tagged = measure(board, true);
+      std::printf("\nvolume change latency, %d changes, icons read meanwhile\n", n_samples);
+      print("one request at a time", serial);
+      print("tagged requests", tagged);
+      result = 0;
+    }
+  }
+
+  // the client notices the silence after its timeout
+  stop = true;
+  client.join();
+  return result;
+}
@@ -8,6 +8,14 @@
 
 static void print_help();
 
+static void change_volume(int pid, float delta) {
+  // one pass over the sessions, instead of a get and a set
+  const auto result = VolumeControl::apply({ VolumeControl::Operation::change_volume(pid, delta) });
+  if (result[0].status_ == VolumeControl::OperationStatus::NOT_FOUND) {
+    std::cout << "no session of " << pid << '\n';
+  }
+}
+
 static void flush_cin() {
   std::cin.clear();
   std::cin.ignore(10000, '\n');
@@ -22,11 +30,20 @@ int main() {
   std::optional<int> selected;
 
   while (running) {
-    auto info = VolumeControl::get_all_sessions_info();
+    for (const auto& endpoint : VolumeControl::get_endpoints()) {
+      std::wcout << L"endpoint " << static_cast<int>(endpoint.id_) << L": " << endpoint.name_
+                 << (endpoint.default_ ? L" (default)\n" : L"\n");
+    }
 
-    for (const auto& i : info) {
-      std::wcout << i << '\n';
+    const auto before = VolumeControl::get_resolve_stats();
+    // the names are resolved as they are printed, the icons only by 'l'
+    const auto snapshot = VolumeControl::get_session_snapshot();
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+      std::wcout << snapshot.info(i) << '\n';
     }
+    const auto after = VolumeControl::get_resolve_stats();
+    std::wcout << L"resolved " << after.paths_ - before.paths_ << L" paths, " << after.icons_ - before.icons_
+               << L" icons\n";
 
     char c = std::getchar();
 
@@ -44,35 +61,28 @@ int main() {
         int pid;
         std::cin >> pid;
         selected = std::nullopt;
-        for (const auto& i : info) {
-          if (i.pid_ == pid) {
-            selected = pid;
-            break;
-          }
+        if (snapshot.find(pid) != snapshot.npos) {
+          selected = pid;
         }
       } break;
 
       case 'l':
         if (selected) {
-          for (const auto& i : info) {
-            if (i.pid_ == *selected) {
-              std::cout << "IMG len: " << i.get_icon_data().size() << '\n';
-              break;
-            }
+          if (const size_t i = snapshot.find(*selected); i != snapshot.npos) {
+            std::cout << "IMG len: " << snapshot.info(i).get_icon_data().size() << '\n';
           }
         }
+        break;
 
       case '+':
         if (selected) {
-          int vol = VolumeControl::get_volume(*selected);
-          VolumeControl::set_volume(*selected, vol + 5);
+          change_volume(*selected, +5);
         }
         break;
 
       case '-':
         if (selected) {
-          int vol = VolumeControl::get_volume(*selected);
-          VolumeControl::set_volume(*selected, vol - 5);
+          change_volume(*selected, -5);
         }
         break;
     }
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// @brief Consistent overhead byte stuffing. Encoded frames contain no zero bytes, so a zero delimits them and a
+/// receiver resynchronizes at the next delimiter after losing or corrupting bytes
+namespace COBS {
+
+  constexpr uint8_t delimiter = 0;
+
+  /// @brief most bytes encoding adds to @p len bytes
+  constexpr size_t max_overhead(size_t len) {
+    return 1 + len / 254;
+  }
+
+  /// @brief Encode @p len bytes from @p src to @p dst, without the delimiter.
+  /// Works in place, when @p src starts max_overhead(len) bytes after @p dst
+  /// @param dst output, at least len + max_overhead(len) bytes
+  /// @return encoded length
+  size_t encode(const uint8_t* src, size_t len, uint8_t* dst);
+
+  /// @brief Decode a frame without the delimiter. Works in place, with @p dst == @p src
+  /// @param dst output, at least @p len bytes
+  /// @param out_len decoded length
+  /// @return false if the frame is malformed
+  bool decode(const uint8_t* src, size_t len, uint8_t* dst, size_t& out_len);
+
+  /// @brief Collects bytes until a delimiter and decodes the frame in place. The buffer is allocated once
+  class FrameDecoder {
+  public:
+    enum class Result {
+      NONE,   ///< frame not complete yet
+      FRAME,  ///< a frame is ready in data()
+      ERROR,  ///< the frame was malformed or too long, and was dropped
+    };
+
+    /// @param max_frame longest encoded frame accepted
+    explicit FrameDecoder(size_t max_frame);
+
+    /// @brief Feed one byte
+    Result push(uint8_t byte);
+
+    /// @brief the last decoded frame, valid until the next push()
+    [[nodiscard]] const uint8_t* data() const {
+      return buffer_.data();
+    }
+
+    [[nodiscard]] size_t size() const {
+      return size_;
+    }
+
+  private:
+    std::vector<uint8_t> buffer_;
+    size_t fill_ = 0;        ///< encoded bytes of the current frame
+    size_t size_ = 0;        ///< decoded length of the last frame
+    bool overflow_ = false;  ///< current frame is too long, skip to the next delimiter
+  };
+
+};  // namespace COBS
@@ -0,0 +1,129 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "CommSupervisor/supervisor.h"
+
+
+/// @brief Fixed layout messages, described once as a list of typed fields.
+///
+/// Sizes and offsets are computed at compile time. Fields are packed without padding and little-endian, the CRC
+/// of the fields follows them. Values are read and written byte by byte, so the buffers need no alignment and the
+/// byte order doesn't depend on the host. Compilers fold this into plain loads and stores on little-endian hosts.
+///
+///     struct Pid : Schema::Field<int16_t> {};
+///     struct Volume : Schema::Field<uint8_t> {};
+///     using SetVolume = Schema::Message<Pid, Volume>;
+///
+///     if (SetVolume::verify(data)) {
+///       const int16_t pid = SetVolume::View(data).get<Pid>();
+///     }
+namespace Schema {
+
+  template <class T>
+  constexpr bool is_wire_type_v = std::is_integral_v<T> || std::is_enum_v<T>;
+
+  /// @brief Read a little-endian @p T from @p src
+  template <class T>
+  constexpr T load(const uint8_t* src) {
+    static_assert(is_wire_type_v<T>, "fields are integers or enums");
+    if constexpr (std::is_same_v<T, bool>) {
+      return src[0] != 0;
+    } else if constexpr (std::is_enum_v<T>) {
+      return static_cast<T>(load<std::underlying_type_t<T>>(src));
+    } else {
+      using U = std::make_unsigned_t<T>;
+      U value = 0;
+      for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<U>(static_cast<U>(src[i]) << (8 * i));
+      }
+      return static_cast<T>(value);
+    }
+  }
+
+  /// @brief Write @p value little-endian to @p dst
+  template <class T>
+  constexpr void store(uint8_t* dst, T value) {
+    static_assert(is_wire_type_v<T>, "fields are integers or enums");
+    if constexpr (std::is_same_v<T, bool>) {
+      dst[0] = value ? 1 : 0;
+    } else if constexpr (std::is_enum_v<T>) {
+      store(dst, static_cast<std::underlying_type_t<T>>(value));
+    } else {
+      using U = std::make_unsigned_t<T>;
+      const auto bits = static_cast<U>(value);
+      for (size_t i = 0; i < sizeof(T); ++i) {
+        dst[i] = static_cast<uint8_t>(bits >> (8 * i));
+      }
+    }
+  }
+
+
+  /// @brief Field of type @p T. Derive a named struct from it for each field, messages look fields up by type
+  template <class T>
+  struct Field {
+    static_assert(is_wire_type_v<T>, "fields are integers or enums");
+    using type = T;
+    static constexpr size_t size = sizeof(T);
+  };
+
+
+  /// @brief Message made of @p Fields in order, followed by their CRC
+  template <class... Fields>
+  class Message {
+  public:
+    static constexpr size_t crc_size = 4;
+    static constexpr size_t payload_size = (Fields::size + ... + 0);
+    static constexpr size_t wire_size = payload_size + crc_size;  ///< bytes on the wire, with the CRC
+
+    /// @brief offset of field @p F in the message
+    template <class F>
+    static constexpr size_t offset_of() {
+      static_assert((std::is_same_v<F, Fields> + ... + 0) == 1, "the field is in the message once");
+      size_t offset = 0;
+      bool found = false;
+      ((found = found || std::is_same_v<F, Fields>, offset += found ? 0 : Fields::size), ...);
+      return offset;
+    }
+
+    /// @brief Check the CRC of a received message
+    /// @param data wire_size bytes
+    static bool verify(const uint8_t* data) {
+      return CRC::crc32mpeg2(data, payload_size) == load<uint32_t>(data + payload_size);
+    }
+
+    /// @brief Typed access to the fields of a received message, without copying it
+    class View {
+    public:
+      /// @param data wire_size bytes, which outlive the view
+      explicit View(const uint8_t* data) : data_(data) {
+      }
+
+      template <class F>
+      [[nodiscard]] typename F::type get() const {
+        return load<typename F::type>(data_ + offset_of<F>());
+      }
+
+    private:
+      const uint8_t* data_;
+    };
+
+    /// @brief Write the fields and the CRC to @p dst
+    /// @param dst at least wire_size bytes
+    /// @return wire_size
+    static size_t encode(uint8_t* dst, const typename Fields::type&... values) {
+      size_t offset = 0;
+      ((store(dst + offset, values), offset += Fields::size), ...);
+      store(dst + payload_size, CRC::crc32mpeg2(dst, payload_size));
+      return wire_size;
+    }
+
+    static std::array<uint8_t, wire_size> encode(const typename Fields::type&... values) {
+      std::array<uint8_t, wire_size> out;
+      encode(out.data(), values...);
+      return out;
+    }
+  };
+
+}  // namespace Schema
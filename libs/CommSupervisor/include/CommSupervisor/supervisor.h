@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 
@@ -40,6 +42,9 @@ public:
     append_any(static_cast<const void*>(mem), sz * sizeof(T));
   }
 
+  /// @brief Append @p val as a varint, see Varint::encode()
+  void append_varint(uint64_t val);
+
   const std::vector<uint8_t>& get_buffer() {
     return buffer_;
   }
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+/// @brief LEB128 variable length integers: 7 bits per byte, least significant group first, the high bit is set on
+/// all bytes but the last. Small values take one byte
+namespace Varint {
+
+  constexpr size_t max_size = 10;  ///< longest encoding of a 64 bit value
+
+  /// @brief Map signed values to unsigned ones, so small negative values stay short: 0, -1, 1, -2 -> 0, 1, 2, 3
+  constexpr uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+  }
+
+  constexpr int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+
+  /// @param dst output, at least max_size bytes
+  /// @return encoded length
+  size_t encode(uint64_t value, uint8_t* dst);
+
+  /// @brief Decode one value from the start of @p src
+  /// @return bytes consumed, 0 if @p src ends within the value or it is too long
+  size_t decode(const uint8_t* src, size_t len, uint64_t& value);
+
+}  // namespace Varint
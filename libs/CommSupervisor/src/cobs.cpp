@@ -0,0 +1,78 @@
+#include "CommSupervisor/cobs.h"
+
+
+size_t COBS::encode(const uint8_t* src, size_t len, uint8_t* dst) {
+  // each byte is read before its slot can be overwritten, so the output may trail the input
+  size_t code_idx = 0;
+  size_t out = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; ++i) {
+    const uint8_t byte = src[i];
+    if (byte == 0) {
+      dst[code_idx] = code;
+      code_idx = out++;
+      code = 1;
+      continue;
+    }
+    dst[out++] = byte;
+    if (++code == 0xFF) {
+      dst[code_idx] = code;
+      code_idx = out++;
+      code = 1;
+    }
+  }
+  dst[code_idx] = code;
+  return out;
+}
+
+bool COBS::decode(const uint8_t* src, size_t len, uint8_t* dst, size_t& out_len) {
+  size_t in = 0;
+  size_t out = 0;
+  while (in < len) {
+    const uint8_t code = src[in++];
+    if (code == 0) {
+      return false;
+    }
+    for (uint8_t i = 1; i < code; ++i) {
+      if (in >= len || src[in] == 0) {
+        return false;
+      }
+      dst[out++] = src[in++];
+    }
+    // a full block has no implicit zero, neither has the last block
+    if (code != 0xFF && in < len) {
+      dst[out++] = 0;
+    }
+  }
+  out_len = out;
+  return true;
+}
+
+
+COBS::FrameDecoder::FrameDecoder(size_t max_frame) : buffer_(max_frame) {
+}
+
+COBS::FrameDecoder::Result COBS::FrameDecoder::push(uint8_t byte) {
+  if (byte != delimiter) {
+    if (fill_ < buffer_.size()) {
+      buffer_[fill_++] = byte;
+    } else {
+      overflow_ = true;
+    }
+    return Result::NONE;
+  }
+
+  const size_t fill = fill_;
+  const bool overflow = overflow_;
+  fill_ = 0;
+  overflow_ = false;
+  if (fill == 0 && not overflow) {
+    // back to back delimiters, senders may use them to flush a line
+    return Result::NONE;
+  }
+  if (overflow || not decode(buffer_.data(), fill, buffer_.data(), size_)) {
+    size_ = 0;
+    return Result::ERROR;
+  }
+  return Result::FRAME;
+}
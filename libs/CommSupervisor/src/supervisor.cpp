@@ -1,4 +1,5 @@
 #include "CommSupervisor/supervisor.h"
+#include "CommSupervisor/varint.h"
 
 
 uint32_t CRC::crc32mpeg2(const void* buffer, size_t len, uint32_t crc) {
@@ -50,6 +51,11 @@ uint32_t Hasher::compute_crc() {
   return crc;
 }
 
+void Hasher::append_varint(uint64_t val) {
+  uint8_t bytes[Varint::max_size];
+  append_any(bytes, Varint::encode(val, bytes));
+}
+
 void Hasher::append_any(const void* ptr, size_t sz) {
   const uint8_t* buff = reinterpret_cast<const uint8_t*>(ptr);
   buffer_.reserve(sz);
@@ -0,0 +1,27 @@
+#include "CommSupervisor/varint.h"
+
+
+size_t Varint::encode(uint64_t value, uint8_t* dst) {
+  size_t len = 0;
+  while (value >= 0x80) {
+    dst[len++] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+  }
+  dst[len++] = static_cast<uint8_t>(value);
+  return len;
+}
+
+size_t Varint::decode(const uint8_t* src, size_t len, uint64_t& value) {
+  value = 0;
+  for (size_t i = 0; i < len && i < max_size; ++i) {
+    if (i == max_size - 1 && src[i] > 1) {
+      // the last byte holds the top bit only, more would overflow 64 bits
+      return 0;
+    }
+    value |= static_cast<uint64_t>(src[i] & 0x7F) << (7 * i);
+    if ((src[i] & 0x80) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "CommSupervisor/cobs.h"
+
+// Encodes and decodes frames around the 254 byte blocks of COBS, with the input and output in separate buffers and
+// in place, rejects malformed frames, and resynchronizes the FrameDecoder after corrupted and overlong frames
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  /// @brief @p len non-zero bytes, with a zero at every @p zero_every th byte if it isn't 0
+  std::vector<uint8_t> make_data(size_t len, size_t zero_every = 0) {
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; ++i) {
+      data[i] = zero_every && i % zero_every == zero_every - 1 ? 0 : static_cast<uint8_t>(1 + i % 255);
+    }
+    return data;
+  }
+
+  std::vector<uint8_t> encode(const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> encoded(data.size() + COBS::max_overhead(data.size()));
+    encoded.resize(COBS::encode(data.data(), data.size(), encoded.data()));
+    return encoded;
+  }
+
+  void check_round_trip(const std::vector<uint8_t>& data, const std::string& what) {
+    const auto encoded = encode(data);
+    check(encoded.size() <= data.size() + COBS::max_overhead(data.size()), what + ": overhead too large");
+    check(std::memchr(encoded.data(), COBS::delimiter, encoded.size()) == nullptr, what + ": delimiter in frame");
+
+    std::vector<uint8_t> decoded(encoded.size());
+    size_t len = 0;
+    check(COBS::decode(encoded.data(), encoded.size(), decoded.data(), len), what + ": not decoded");
+    decoded.resize(len);
+    check(decoded == data, what + ": wrong round trip");
+
+    // the frame buffers of the channel encode with head room before the payload, and decode over the frame
+    const size_t head_room = COBS::max_overhead(data.size());
+    std::vector<uint8_t> buffer(head_room + data.size());
+    std::copy(data.begin(), data.end(), buffer.begin() + static_cast<ptrdiff_t>(head_room));
+    const size_t encoded_len = COBS::encode(buffer.data() + head_room, data.size(), buffer.data());
+    check(std::vector<uint8_t>(buffer.data(), buffer.data() + encoded_len) == encoded, what + ": in place encoding");
+    check(COBS::decode(buffer.data(), encoded_len, buffer.data(), len), what + ": not decoded in place");
+    check(std::vector<uint8_t>(buffer.data(), buffer.data() + len) == data, what + ": in place decoding");
+  }
+
+  void test_blocks() {
+    check_round_trip({}, "empty");
+    check_round_trip({ 0 }, "zero");
+    check_round_trip(std::vector<uint8_t>(600, 0), "zeros");
+    for (const size_t len : { 1, 253, 254, 255, 508, 509, 1000 }) {
+      check_round_trip(make_data(len), std::to_string(len) + " bytes");
+      check_round_trip(make_data(len, 254), std::to_string(len) + " bytes, zero after 253");
+      check_round_trip(make_data(len, 255), std::to_string(len) + " bytes, zero after 254");
+    }
+
+    auto full_block = make_data(254);
+    full_block.push_back(0);
+    check(encode(full_block).size() == 257, "254 bytes and a zero: wrong length");
+    check(encode(make_data(254)).size() == 256, "254 bytes: wrong length");
+  }
+
+  void test_malformed() {
+    uint8_t out[8];
+    size_t len = 0;
+    const uint8_t zero_inside[] = { 3, 1, 0 };
+    check(not COBS::decode(zero_inside, sizeof(zero_inside), out, len), "malformed: zero in a block decoded");
+    const uint8_t zero_code[] = { 2, 1, 0, 1 };
+    check(not COBS::decode(zero_code, sizeof(zero_code), out, len), "malformed: zero code decoded");
+    const uint8_t past_end[] = { 5, 1, 2 };
+    check(not COBS::decode(past_end, sizeof(past_end), out, len), "malformed: block past the end decoded");
+  }
+
+  void test_frame_decoder() {
+    COBS::FrameDecoder decoder(300);
+    const auto data = make_data(254, 100);
+    auto frame = encode(data);
+    frame.push_back(COBS::delimiter);
+
+    // the tail of a lost frame, then a good one
+    std::vector<uint8_t> stream = { 7, 1, 2, COBS::delimiter, COBS::delimiter };
+    stream.insert(stream.end(), frame.begin(), frame.end());
+    // a frame longer than the buffer, then a good one
+    stream.insert(stream.end(), 400, 0x55);
+    stream.push_back(COBS::delimiter);
+    stream.insert(stream.end(), frame.begin(), frame.end());
+
+    std::vector<COBS::FrameDecoder::Result> results;
+    for (const uint8_t byte : stream) {
+      const auto result = decoder.push(byte);
+      if (result == COBS::FrameDecoder::Result::NONE) {
+        continue;
+      }
+      results.push_back(result);
+      if (result == COBS::FrameDecoder::Result::FRAME) {
+        check(std::vector<uint8_t>(decoder.data(), decoder.data() + decoder.size()) == data,
+              "decoder: wrong frame");
+      }
+    }
+    using Result = COBS::FrameDecoder::Result;
+    check(results == std::vector<Result>{ Result::ERROR, Result::FRAME, Result::ERROR, Result::FRAME },
+          "decoder: not resynchronized");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_blocks();
+  test_malformed();
+  test_frame_decoder();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
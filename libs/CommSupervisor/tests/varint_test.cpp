@@ -0,0 +1,92 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "CommSupervisor/varint.h"
+
+// Encodes and decodes varints at the limits of their byte lengths, the zigzag mapping at the limits of the signed
+// types, and rejects truncated and overlong encodings
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  void check_round_trip(uint64_t value, size_t expected_size) {
+    uint8_t buffer[Varint::max_size + 1] = {};
+    const size_t size = Varint::encode(value, buffer);
+    const std::string what = "varint " + std::to_string(value);
+    check(size == expected_size, what + ": encoded in " + std::to_string(size) + " bytes");
+
+    uint64_t decoded = 0;
+    check(Varint::decode(buffer, size, decoded) == size && decoded == value, what + ": wrong round trip");
+    check(Varint::decode(buffer, size - 1, decoded) == 0, what + ": truncated encoding decoded");
+  }
+
+  void test_lengths() {
+    check_round_trip(0, 1);
+    check_round_trip(0x7F, 1);
+    check_round_trip(0x80, 2);
+    check_round_trip(0x3FFF, 2);
+    check_round_trip(0x4000, 3);
+    check_round_trip(UINT32_MAX, 5);
+    check_round_trip(uint64_t{ 1 } << 63, 10);
+    check_round_trip(UINT64_MAX, 10);
+  }
+
+  void test_invalid() {
+    uint64_t value = 0;
+    // 11 bytes, the 10th has the continuation bit
+    const std::vector<uint8_t> too_long(11, 0x80);
+    check(Varint::decode(too_long.data(), too_long.size(), value) == 0, "invalid: 11 byte encoding decoded");
+
+    // the 10th byte carries more than the top bit
+    std::vector<uint8_t> overflow(9, 0xFF);
+    overflow.push_back(0x02);
+    check(Varint::decode(overflow.data(), overflow.size(), value) == 0, "invalid: 65 bit value decoded");
+
+    check(Varint::decode(nullptr, 0, value) == 0, "invalid: empty input decoded");
+
+    // only the first value is consumed
+    const uint8_t two[] = { 0x85, 0x01, 0x07 };
+    check(Varint::decode(two, sizeof(two), value) == 2 && value == 0x85, "invalid: wrong first of two values");
+  }
+
+  void test_zigzag() {
+    check(Varint::zigzag(0) == 0 && Varint::zigzag(-1) == 1 && Varint::zigzag(1) == 2 && Varint::zigzag(-2) == 3,
+          "zigzag: wrong small values");
+    check(Varint::zigzag(INT16_MIN) == 0xFFFF && Varint::zigzag(INT16_MAX) == 0xFFFE, "zigzag: wrong int16 limits");
+    check(Varint::zigzag(INT64_MIN) == UINT64_MAX && Varint::zigzag(INT64_MAX) == UINT64_MAX - 1,
+          "zigzag: wrong int64 limits");
+    for (const int64_t value : { int64_t{ 0 }, int64_t{ -1 }, int64_t{ INT16_MIN }, int64_t{ INT16_MAX }, INT64_MIN,
+                                 INT64_MAX }) {
+      check(Varint::unzigzag(Varint::zigzag(value)) == value, "zigzag: wrong round trip of " + std::to_string(value));
+    }
+
+    // a pid sent as int16 fits into 3 bytes
+    uint8_t buffer[Varint::max_size];
+    check(Varint::encode(Varint::zigzag(INT16_MIN), buffer) == 3, "zigzag: int16 longer than 3 bytes");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_lengths();
+  test_invalid();
+  test_zigzag();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -1,36 +1,365 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <ostream>
 
 namespace VolumeControl {
 
-  /// @brief Describes an audio session
+  /// @brief Pixel formats of raw icons
+  enum class PixelFormat : uint8_t {
+    RGB565 = 0,  ///< 2 bytes per pixel, little-endian
+    RGB888 = 1,  ///< 3 bytes per pixel, red first
+  };
+
+  /// @brief Raw icon format, as the board's display expects it
+  struct RawIconFormat {
+    PixelFormat format_;
+    uint16_t width_;
+    uint16_t height_;
+    uint32_t background_;  ///< 0x00RRGGBB, transparent pixels are blended over it
+    bool keep_alpha_;      ///< don't blend, append an alpha byte to each pixel instead
+    bool swap_bytes_;      ///< store RGB565 big-endian
+  };
+
+  /// @brief Immutable view of icon bytes. Copies are cheap and share the bytes, @p owner_ keeps them alive.
+  /// Built-in icons have no owner, they are served from static storage
+  class IconData {
+  public:
+    IconData() = default;
+
+    IconData(const uint8_t* data, size_t size, std::shared_ptr<const void> owner = nullptr, uint32_t hash = 0)
+      : data_(data), size_(size), owner_(std::move(owner)), hash_(hash) {
+    }
+
+    /// @brief take ownership of @p bytes
+    explicit IconData(std::vector<uint8_t> bytes, uint32_t hash = 0) : hash_(hash) {
+      auto owned = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+      data_ = owned->data();
+      size_ = owned->size();
+      owner_ = std::move(owned);
+    }
+
+    [[nodiscard]] const uint8_t* data() const {
+      return data_;
+    }
+
+    [[nodiscard]] size_t size() const {
+      return size_;
+    }
+
+    [[nodiscard]] bool empty() const {
+      return size_ == 0;
+    }
+
+    [[nodiscard]] const uint8_t* begin() const {
+      return data_;
+    }
+
+    [[nodiscard]] const uint8_t* end() const {
+      return data_ + size_;
+    }
+
+    /// @brief CRC-32 of the bytes, as stored with the cached icon. 0 if unknown
+    [[nodiscard]] uint32_t hash() const {
+      return hash_;
+    }
+
+  private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<const void> owner_;
+    uint32_t hash_ = 0;
+  };
+
+  /// @brief One process instance, told apart from a later process with the same pid by its start time.
+  ///
+  /// The path, the names and the icon are resolved on first access and kept for the lifetime of the record, so
+  /// consumers only pay for what they read. Thread safe, snapshots and their copies share the records.
+  class SessionRecord {
+  public:
+    SessionRecord(int pid, uint64_t start_time);
+
+    /// @brief Record with a fixed name and without an executable, like the master and the system sounds
+    SessionRecord(int pid, std::wstring filename);
+
+    /// @brief Record with a fixed name and icon, like the sessions of the simulated backend
+    SessionRecord(int pid, std::wstring filename, IconData icon);
+
+    SessionRecord(const SessionRecord&) = delete;
+    SessionRecord& operator=(const SessionRecord&) = delete;
+
+    [[nodiscard]] int pid() const {
+      return pid_;
+    }
+
+    /// @brief OS specific creation timestamp, 0 if unknown
+    [[nodiscard]] uint64_t start_time() const {
+      return start_time_;
+    }
+
+    [[nodiscard]] const std::wstring& path() const;      ///< Path of the executable
+    [[nodiscard]] const std::wstring& filename() const;  ///< name of the executable, without extension
+    [[nodiscard]] const std::string& name_utf8() const;  ///< filename() in UTF-8
+
+    /// @brief the icon of the executable, PNG encoded. Fetched from the icon cache or extracted on the first call
+    [[nodiscard]] IconData icon() const;
+
+    /// @brief CRC-32 of icon(), without extracting or encoding the icon
+    /// @return the hash, 0 if the icon isn't cached yet. It is fetched in the background then
+    [[nodiscard]] uint32_t icon_hash() const;
+
+  private:
+    void resolve_names() const;
+
+    const int pid_;
+    const uint64_t start_time_;
+    const bool fixed_;  ///< the names are given, there is nothing to resolve
+    mutable std::once_flag names_once_;
+    mutable std::once_flag icon_once_;
+    mutable std::wstring path_;
+    mutable std::wstring filename_;
+    mutable std::string name_utf8_;
+    mutable IconData icon_;
+    mutable std::atomic<uint32_t> icon_hash_{ 0 };  ///< hash of the icon, once it's known
+  };
+
+  /// @brief Describes an audio session. The names are copies of the record's, SessionSnapshot reads them without
+  /// copying
   struct AudioSessionInfo {
     std::wstring path_;                                        ///< Path of the executable
     std::wstring filename_;                                    ///< name of the executable
+    std::string name_utf8_;                                    ///< filename_ in UTF-8, converted once per process
     int pid_;                                                  ///< process ID of the executable
+    uint8_t endpoint_;                                         ///< id of the device, see get_endpoints()
     float volume_;                                             ///< volume of session in %
     bool muted_;                                               ///< is the session muted
-    [[nodiscard]] std::vector<uint8_t> get_icon_data() const;  ///< load the icon for the executable
+    std::shared_ptr<const SessionRecord> record_;              ///< the process, keeps the icon once it's loaded
+    [[nodiscard]] IconData get_icon_data() const;  ///< load the icon for the executable, PNG encoded
+    [[nodiscard]] uint32_t get_icon_hash() const;  ///< hash of the icon if it's cached, 0 otherwise
+    /// @brief load the icon for the executable as raw pixels, rows top-down
+    [[nodiscard]] IconData get_icon_raw(const RawIconFormat& format) const;
+  };
+
+  /// @brief An active render device
+  struct EndpointInfo {
+    uint8_t id_;         ///< assigned on first sight and kept while the process runs, ids aren't reused
+    std::wstring name_;  ///< friendly name, like "Speakers (Realtek Audio)"
+    std::string name_utf8_;  ///< name_ in UTF-8
+    bool default_;       ///< the default multimedia device, which the master controls
+  };
+
+  /// @brief The sessions at one point in time, as arrays of their fields, sorted by pid and endpoint.
+  ///
+  /// Paths and names are kept by the SessionRecord of each process, which copies of the snapshot share, and are
+  /// only resolved when they are read. Each session has a generation, the generation of the snapshot in which it
+  /// last changed, so consumers can tell what's new.
+  class SessionSnapshot {
+  public:
+    using record_t = std::shared_ptr<const SessionRecord>;
+
+    static constexpr size_t npos = ~static_cast<size_t>(0);
+
+    /// @brief Collects the sessions of a snapshot
+    class Builder {
+    public:
+      /// @param endpoint id of the device of the session
+      /// @param record the process of the session, not nullptr
+      void add(int pid, uint8_t endpoint, float volume, bool muted, record_t record);
+
+      /// @brief Take the sessions of @p other, like the ones a parallel scan collected
+      void merge(Builder&& other);
+
+      /// @brief Sort the sessions and number their generations
+      /// @param previous the snapshot before, sessions which didn't change since keep their generation
+      [[nodiscard]] SessionSnapshot build(const SessionSnapshot& previous);
+
+    private:
+      struct Row {
+        int pid_;
+        uint8_t endpoint_;
+        float volume_;
+        bool muted_;
+        record_t record_;
+      };
+
+      std::vector<Row> rows_;
+    };
+
+    [[nodiscard]] size_t size() const {
+      return pids_.size();
+    }
+
+    /// @brief the pids in ascending order
+    [[nodiscard]] const std::vector<int>& pids() const {
+      return pids_;
+    }
+
+    [[nodiscard]] uint8_t endpoint(size_t i) const {
+      return endpoints_[i];
+    }
+
+    [[nodiscard]] float volume(size_t i) const {
+      return volumes_[i];
+    }
+
+    [[nodiscard]] bool muted(size_t i) const {
+      return muted_[i];
+    }
+
+    [[nodiscard]] uint64_t generation(size_t i) const {
+      return generations_[i];
+    }
+
+    [[nodiscard]] const record_t& record(size_t i) const {
+      return (*records_)[i];
+    }
+
+    [[nodiscard]] const std::wstring& path(size_t i) const {
+      return record(i)->path();
+    }
+
+    [[nodiscard]] const std::wstring& filename(size_t i) const {
+      return record(i)->filename();
+    }
+
+    [[nodiscard]] const std::string& name_utf8(size_t i) const {
+      return record(i)->name_utf8();
+    }
+
+    /// @brief changes whenever a session is added, removed or changed
+    [[nodiscard]] uint64_t generation() const {
+      return generation_;
+    }
+
+    /// @brief Get the index of the first session of @p pid, with a binary search
+    /// @return npos if there is none
+    [[nodiscard]] size_t find(int pid) const;
+
+    /// @brief the session @p i as AudioSessionInfo, sharing the record. The names are copied from the record, which
+    /// resolves them on the first call for the process
+    [[nodiscard]] AudioSessionInfo info(size_t i) const;
+
+    /// @brief every session as AudioSessionInfo. Prefer the accessors above, they neither build the list nor copy
+    /// the names
+    [[nodiscard]] std::vector<AudioSessionInfo> infos() const;
+
+  private:
+    /// @brief Check if session @p i is the same as session @p j of @p other
+    [[nodiscard]] bool same_session(size_t i, const SessionSnapshot& other, size_t j) const;
+
+    std::vector<int> pids_;
+    std::vector<uint8_t> endpoints_;
+    std::vector<float> volumes_;
+    std::vector<uint8_t> muted_;
+    std::vector<uint64_t> generations_;
+    std::shared_ptr<const std::vector<record_t>> records_;
+    uint64_t generation_ = 0;
+  };
+
+  /// @brief Counters of the icon requests since start
+  struct IconStats {
+    uint32_t requests_;       ///< icon requests of executables
+    uint32_t prefetch_hits_;  ///< served from an icon prepared in the background
+    uint32_t cache_hits_;     ///< served from the icon cache, requested before or loaded from disk
+    uint32_t misses_;         ///< extracted while the caller waited
+  };
+
+  /// @brief Counters of the expensive lookups of session records since start.
+  /// Compare them before and after an operation, to see what it resolved
+  struct ResolveStats {
+    uint32_t paths_;  ///< paths and names of executables queried from the OS
+    uint32_t icons_;  ///< icons fetched for a record, from the icon cache or extracted
+  };
+
+  /// @brief One step of a batch, see apply()
+  struct Operation {
+    enum class Kind : uint8_t {
+      GET,            ///< read the volume and the mute state only
+      SET_VOLUME,     ///< set the volume to volume_
+      CHANGE_VOLUME,  ///< add volume_ to the volume
+      SET_MUTED,      ///< set the mute state to muted_
+    };
+
+    Kind kind_;
+    int pid_;       ///< the PID of the process or -1 for master
+    float volume_;  ///< volume in %, or the change of it
+    bool muted_;
+
+    static Operation get(int pid) {
+      return { Kind::GET, pid, 0, false };
+    }
+
+    static Operation set_volume(int pid, float volume) {
+      return { Kind::SET_VOLUME, pid, volume, false };
+    }
+
+    static Operation change_volume(int pid, float delta) {
+      return { Kind::CHANGE_VOLUME, pid, delta, false };
+    }
+
+    static Operation set_muted(int pid, bool muted) {
+      return { Kind::SET_MUTED, pid, 0, muted };
+    }
+  };
+
+  enum class OperationStatus : uint8_t {
+    OK,
+    NOT_FOUND,  ///< there is no session of the pid
+  };
+
+  /// @brief Outcome of an Operation
+  struct OperationResult {
+    OperationStatus status_;
+    float volume_;  ///< volume in % after the operation, 0 if not found
+    bool muted_;    ///< mute state after the operation, false if not found
+  };
+
+  /// @brief Level of a session, from the peak meter of the audio API
+  struct MeterSample {
+    int pid_;     ///< the PID of the process or -1 for master
+    float peak_;  ///< peak of the last audio period, 0..1 of full scale
   };
 
   /// @brief Initialize the Winapi
   /// @return true on success
   [[nodiscard]] bool init();
 
-  /// @brief return the info of every active session
+  /// @brief return the info of every active session, sorted by pid
   [[nodiscard]] std::vector<AudioSessionInfo> get_all_sessions_info();
 
+  /// @brief Enumerate the active sessions of every active render device. The devices are scanned in parallel
+  [[nodiscard]] SessionSnapshot get_session_snapshot();
+
+  /// @brief The snapshot get_session_snapshot() returned last, without enumerating the sessions again.
+  /// It may miss sessions started since, empty before the first enumeration
+  [[nodiscard]] SessionSnapshot get_cached_snapshot();
+
+  /// @brief List the active render devices, the default one first
+  [[nodiscard]] std::vector<EndpointInfo> get_endpoints();
+
+  /// @brief Execute @p ops in order, with one enumeration of the sessions.
+  /// Volumes are clamped to 0..100. A pid with several sessions, on several devices, is read from the first one, the
+  /// default device is searched first. The others are set to the volume and mute state the operations set there
+  /// @return the result of each operation, in the order of @p ops
+  [[nodiscard]] std::vector<OperationResult> apply(const std::vector<Operation>& ops);
+
+  /// @brief Read the peak meters of every session and of the master, with one enumeration
+  /// @return one sample per pid, sorted by pid. A pid with several sessions gets the highest peak of them
+  [[nodiscard]] std::vector<MeterSample> get_meter_samples();
+
   /// @brief Get the volume of the process @p pid.
   /// Set @p pid to -1 to get master volume
   /// @param pid the PID of the process or -1 for master
-  /// @return the volume in %
+  /// @return the volume in %, 0 if there is no session of @p pid
   [[nodiscard]] float get_volume(int pid);
 
 
-  /// @brief Set the volume of the process @p pid.
+  /// @brief Set the volume of the process @p pid, on every device it plays on.
   /// Set @p pid to -1 to set master volume
   /// @param pid the PID of the process or -1 for master
   /// @param volume the volume level in %
@@ -39,10 +368,18 @@ namespace VolumeControl {
   /// @brief return true if @p pid is muted. Pass -1 to get master
   [[nodiscard]] bool get_muted(int pid);
 
-  /// @brief set muted for @p pid, pass -1 to set master
+  /// @brief set muted for @p pid on every device, pass -1 to set master
   void set_muted(int pid, bool mute);
 
+  /// @brief Enable or disable preparing the icons of new sessions in the background
+  void set_icon_prefetch(bool enable);
+
+  [[nodiscard]] IconStats get_icon_stats();
+
+  [[nodiscard]] ResolveStats get_resolve_stats();
+
 };  // namespace VolumeControl
 
 
+/// @brief Print the names, volume, device and the hash of the icon, if it is cached. Doesn't extract the icon
 std::wostream& operator<<(std::wostream& out, const VolumeControl::AudioSessionInfo& audio);
@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+
+/// @brief In-memory audio backend, built instead of the Windows audio API outside of windows, or on windows with
+/// VOLUMEAPI_SIMULATED. The caller makes up the sessions, so the whole API runs in tests and benchmarks.
+namespace VolumeControl::Simulation {
+
+  /// @brief Modelled cost of the audio API, so timings can be compared with the real backend. Of a cost over
+  /// 200 us all but the last 200 us is slept, like the real API waits for the audio service, the rest is busy waited
+  struct Costs {
+    std::chrono::nanoseconds endpoint_;  ///< opening a device, once per device of an enumeration and per master access
+    std::chrono::nanoseconds session_;   ///< visiting one session of an enumeration
+  };
+
+  /// @brief Synthetic meter level, called with the time since it was set
+  /// @return the peak, 0..1 of full scale
+  using level_fn = std::function<float(std::chrono::nanoseconds)>;
+
+  /// @brief Level, which fades between silence and @p amplitude and back, once per @p period
+  [[nodiscard]] level_fn fading(float amplitude, std::chrono::milliseconds period);
+
+  /// @brief Level, which is at @p amplitude for @p on and silent for @p off, like speech or notification sounds
+  [[nodiscard]] level_fn pulses(float amplitude, std::chrono::milliseconds on, std::chrono::milliseconds off);
+
+  /// @brief Remove every session and every device but the default one, set the master to 100 % unmuted and the costs
+  /// and counters to 0. The last snapshot becomes empty, with a new generation
+  void reset();
+
+  void set_costs(const Costs& costs);
+
+  /// @brief Add a render device, the default one with id 0 always exists
+  /// @return the id of the device
+  uint8_t add_endpoint(std::wstring name);
+
+  /// @brief Add a session, the sessions of a device are enumerated in the order they were added
+  /// @param volume in %
+  /// @param endpoint id of the device, sessions of unknown devices are ignored
+  void add_session(int pid, std::wstring name, float volume = 100, bool muted = false, uint8_t endpoint = 0);
+
+  /// @brief Remove every session of @p pid, on every device
+  void remove_sessions(int pid);
+
+  /// @brief Give the sessions of @p pid an icon, they get a new record like a restarted process
+  /// @param png the icon, PNG encoded
+  void set_icon(int pid, std::vector<uint8_t> png);
+
+  /// @brief Generate the meter levels of the sessions of @p pid, or of the master with -1.
+  /// Sessions without a level are silent, the master without one shows the loudest session of the default device
+  void set_level(int pid, level_fn level);
+
+  /// @brief number of session enumerations since reset()
+  [[nodiscard]] uint64_t enumerations();
+
+};  // namespace VolumeControl::Simulation
@@ -4,15 +4,34 @@
 #include <mmdeviceapi.h>
 #include <audiopolicy.h>
 #include <endpointvolume.h>
+#include <functiondiscoverykeys_devpkey.h>
 #include <Psapi.h>
+#include <algorithm>
 #include <filesystem>
+#include <map>
+#include <mutex>
 #include <Windows.h>
 #include <shellapi.h>
 #include "process_api.h"
+#include "meter_samples.h"
+#include "operation_batch.h"
+#include "process_cache.h"
+#include "scan_pool.h"
+#include "utf8.h"
 
 namespace fs = std::filesystem;
 
 
+static std::mutex snapshot_mutex;  ///< guards last_snapshot
+static VolumeControl::SessionSnapshot last_snapshot;
+
+/// small ids of the devices, by their id string. Ids are never reused, a device which comes back gets its old id
+static std::map<std::wstring, uint8_t> endpoint_ids;
+static constexpr size_t max_endpoints = 256;  ///< the ids are a byte on the wire
+static std::mutex endpoint_ids_mutex;
+static ScanPool scan_pool(7);  ///< scans the devices of a snapshot, the caller scans one of them
+
+
 
 // Based on: https://github.com/chrispader/VolumeControl
 
@@ -25,12 +44,24 @@ void SAFE_RELEASE(T*& x) {
 }
 
 
-/// @brief get the audio master volume
-static IAudioEndpointVolume* GetMaster() {
-  HRESULT hr;
+/// @brief Initialize COM once on the calling thread, the API is called from the request threads of the client too
+static void com_thread_init() {
+  struct ComScope {
+    const bool ok_ = SUCCEEDED(CoInitializeEx(NULL, COINIT_APARTMENTTHREADED));
+    ~ComScope() {
+      if (ok_) CoUninitialize();
+    }
+  };
+  thread_local ComScope scope;
+}
+
+/// @brief get interface @p T of the default endpoint, like IAudioEndpointVolume or IAudioMeterInformation
+template <class T>
+static T* GetEndpointInterface() {
+  com_thread_init();
   IMMDeviceEnumerator* enumerator = NULL;
   IMMDevice* device = NULL;
-  IAudioEndpointVolume* endpoint = NULL;
+  T* endpoint = NULL;
 
   if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_INPROC_SERVER, __uuidof(IMMDeviceEnumerator),
                               (void**)&enumerator))) {
@@ -42,7 +73,7 @@ static IAudioEndpointVolume* GetMaster() {
     goto error;
   }
 
-  if (FAILED(device->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, NULL, (void**)&endpoint))) {
+  if (FAILED(device->Activate(__uuidof(T), CLSCTX_INPROC_SERVER, NULL, (void**)&endpoint))) {
     goto error;
   }
 
@@ -53,20 +84,116 @@ error:
   return endpoint;
 }
 
-/// @brief Calls @p callback for each session. If return of @p callback is true, stops and returns to caller
+/// @brief get the audio master volume
+static IAudioEndpointVolume* GetMaster() {
+  return GetEndpointInterface<IAudioEndpointVolume>();
+}
+
+/// @brief An active render device
+struct Device {
+  std::wstring id_;  ///< id string of the audio API
+  uint8_t endpoint_;
+  bool default_;
+  std::wstring name_;  ///< friendly name, if it was asked for
+};
+
+/// @brief Get the small id of the device @p id, a new one on first sight
+/// @return false once every id is taken, the device is left out then
+static bool endpoint_id(const std::wstring& id, uint8_t& endpoint) {
+  std::lock_guard lock(endpoint_ids_mutex);
+  if (const auto it = endpoint_ids.find(id); it != endpoint_ids.end()) {
+    endpoint = it->second;
+    return true;
+  }
+  if (endpoint_ids.size() >= max_endpoints) {
+    return false;
+  }
+  endpoint = static_cast<uint8_t>(endpoint_ids.size());
+  endpoint_ids.emplace(id, endpoint);
+  return true;
+}
+
+/// @brief Get the friendly name of @p device, empty if there is none
+static std::wstring device_name(IMMDevice* device) {
+  std::wstring ret;
+  IPropertyStore* props = NULL;
+  if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &props))) {
+    PROPVARIANT name;
+    PropVariantInit(&name);
+    if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &name)) && name.vt == VT_LPWSTR) {
+      ret = name.pwszVal;
+    }
+    PropVariantClear(&name);
+    SAFE_RELEASE(props);
+  }
+  return ret;
+}
+
+/// @brief List the active render devices, the default multimedia device first
+/// @param with_names read the friendly names too
+static std::vector<Device> list_devices(bool with_names) {
+  std::vector<Device> ret;
+  IMMDeviceEnumerator* enumerator = NULL;
+  IMMDeviceCollection* collection = NULL;
+  IMMDevice* device = NULL;
+  LPWSTR default_id = NULL;
+  UINT count = 0;
+  com_thread_init();
+
+  if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator),
+                              (void**)&enumerator))) {
+    goto error;
+  }
+  if (SUCCEEDED(enumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, ERole::eMultimedia, &device))) {
+    device->GetId(&default_id);
+    SAFE_RELEASE(device);
+  }
+  if (FAILED(enumerator->EnumAudioEndpoints(EDataFlow::eRender, DEVICE_STATE_ACTIVE, &collection))) {
+    goto error;
+  }
+  if (FAILED(collection->GetCount(&count))) {
+    goto error;
+  }
+
+  for (UINT i = 0; i < count; i++) {
+    LPWSTR id = NULL;
+    uint8_t endpoint;
+    if (SUCCEEDED(collection->Item(i, &device)) && SUCCEEDED(device->GetId(&id)) && endpoint_id(id, endpoint)) {
+      const bool is_default = default_id && wcscmp(id, default_id) == 0;
+      ret.push_back({ id, endpoint, is_default, with_names ? device_name(device) : std::wstring() });
+    }
+    CoTaskMemFree(id);
+    SAFE_RELEASE(device);
+  }
+  std::stable_partition(ret.begin(), ret.end(), [](const Device& d) { return d.default_; });
+
+error:
+  CoTaskMemFree(default_id);
+  SAFE_RELEASE(enumerator);
+  SAFE_RELEASE(collection);
+  return ret;
+}
+
+using session_callback_t = std::function<bool(IAudioSessionControl*, IAudioSessionControl2*, DWORD)>;
+
+/// @brief Calls @p callback for each session of the device @p device_id. If return of @p callback is true, stops
+/// and returns to caller
 /// @param callback std::function object
-static void session_enumerate(std::function<bool(IAudioSessionControl*, IAudioSessionControl2*, DWORD)> callback) {
+/// @return true if @p callback stopped the enumeration
+static bool session_enumerate(const std::wstring& device_id, const session_callback_t& callback) {
   IMMDeviceEnumerator* enumerator = NULL;
   IMMDevice* device = NULL;
   IAudioSessionManager2* manager = NULL;
   IAudioSessionEnumerator* sessionEnumerator = NULL;
   int sessionCount = 0;
+  bool stopped = false;
+  com_thread_init();
 
   if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), NULL, CLSCTX_ALL, __uuidof(IMMDeviceEnumerator),
                               (void**)&enumerator))) {
     goto error;
   }
-  if (FAILED(enumerator->GetDefaultAudioEndpoint(EDataFlow::eRender, ERole::eMultimedia, &device))) {
+  if (FAILED(enumerator->GetDevice(device_id.c_str(), &device))) {
     goto error;
   }
   if (FAILED((device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, NULL, (void**)&manager)))) {
@@ -106,6 +233,7 @@ static void session_enumerate(std::function<bool(IAudioSessionControl*, IAudioSe
     SAFE_RELEASE(ctrl2);
 
     if (ret) {
+      stopped = true;
       break;
     }
   }
@@ -115,28 +243,21 @@ error:
   SAFE_RELEASE(device);
   SAFE_RELEASE(manager);
   SAFE_RELEASE(sessionEnumerator);
+  return stopped;
 }
 
-/// @brief Get volume session for @p pid
-static ISimpleAudioVolume* GetSession(int pid) {
-  ISimpleAudioVolume* session;
-
-  // enumerate through all sessions, if PID matches load into session* and stop enumerating
-  auto cb = [&session, pid](IAudioSessionControl* ctrl, IAudioSessionControl2* ctrl2, DWORD curr_pid) {
-    if (pid == curr_pid) {
-      if (FAILED(ctrl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&session))) {
-        session = NULL;
-      }
-      return true;
+/// @brief Calls @p callback for each session of every device, the default device first. If return of @p callback
+/// is true, stops and returns to caller
+static void session_enumerate(const session_callback_t& callback) {
+  for (const auto& device : list_devices(false)) {
+    if (session_enumerate(device.id_, callback)) {
+      break;
     }
-    return false;
-  };
-
-  session_enumerate(cb);
-  return session;
+  }
 }
 
 
+
 static float get_master_volume() {
   IAudioEndpointVolume* endpoint = GetMaster();
   if (endpoint == NULL) return NULL;
@@ -155,63 +276,66 @@ static bool get_master_mute() {
   return mute;
 }
 
-static void set_master_volume(float level) {
-  IAudioEndpointVolume* endpoint = GetMaster();
-  if (endpoint == NULL) return;
-  endpoint->SetMasterVolumeLevelScalar(level / 100, NULL);
-  SAFE_RELEASE(endpoint);
-}
 
-static void set_master_mute(bool mute) {
-  IAudioEndpointVolume* endpoint = GetMaster();
-  if (endpoint == NULL) return;
-  endpoint->SetMute(mute, NULL);
-  SAFE_RELEASE(endpoint);
-}
+/// @brief Volume of an app session, as OperationBatch uses it
+class AppVolume {
+public:
+  explicit AppVolume(ISimpleAudioVolume* volume) : volume_(volume) {
+  }
 
+  float volume() const {
+    float level = 0;
+    volume_->GetMasterVolume(&level);
+    return level * 100;
+  }
 
-static VolumeControl::AudioSessionInfo get_master_info() {
-  VolumeControl::AudioSessionInfo info;
-  info.filename_ = L"Master";
-  info.pid_ = -1;
-  info.volume_ = get_master_volume();
-  info.muted_ = get_master_mute();
+  bool muted() const {
+    BOOL mute = FALSE;
+    volume_->GetMute(&mute);
+    return mute;
+  }
 
-  return info;
-}
+  void set_volume(float level) {
+    volume_->SetMasterVolume(level / 100, NULL);
+  }
 
+  void set_muted(bool mute) {
+    volume_->SetMute(mute, NULL);
+  }
 
-static float get_app_volume(int pid) {
-  ISimpleAudioVolume* volume = GetSession(pid);
-  if (volume == NULL) return NULL;
-  float level = NULL;
-  volume->GetMasterVolume(&level);
-  SAFE_RELEASE(volume);
-  return level * 100;
-}
+private:
+  ISimpleAudioVolume* volume_;
+};
 
-static bool get_app_mute(int pid) {
-  ISimpleAudioVolume* volume = GetSession(pid);
-  if (volume == NULL) return NULL;
-  BOOL mute = NULL;
-  volume->GetMute(&mute);
-  SAFE_RELEASE(volume);
-  return mute;
-}
+/// @brief Volume of the endpoint, as OperationBatch uses it
+class MasterVolume {
+public:
+  explicit MasterVolume(IAudioEndpointVolume* endpoint) : endpoint_(endpoint) {
+  }
 
-static void set_app_volume(int pid, float level) {
-  ISimpleAudioVolume* volume = GetSession(pid);
-  if (volume == NULL) return;
-  volume->SetMasterVolume(level / 100, NULL);
-  SAFE_RELEASE(volume);
-}
+  float volume() const {
+    float level = 0;
+    endpoint_->GetMasterVolumeLevelScalar(&level);
+    return level * 100;
+  }
 
-static void set_app_mute(int pid, bool mute) {
-  ISimpleAudioVolume* volume = GetSession(pid);
-  if (volume == NULL) return;
-  volume->SetMute(mute, NULL);
-  SAFE_RELEASE(volume);
-}
+  bool muted() const {
+    BOOL mute = FALSE;
+    endpoint_->GetMute(&mute);
+    return mute;
+  }
+
+  void set_volume(float level) {
+    endpoint_->SetMasterVolumeLevelScalar(level / 100, NULL);
+  }
+
+  void set_muted(bool mute) {
+    endpoint_->SetMute(mute, NULL);
+  }
+
+private:
+  IAudioEndpointVolume* endpoint_;
+};
 
 
 //////
@@ -219,86 +343,147 @@ static void set_app_mute(int pid, bool mute) {
 //////
 
 
-std::wostream& operator<<(std::wostream& out, const VolumeControl::AudioSessionInfo& audio) {
-  out << audio.filename_ << std::wstring(L"\n\tpath: ") << audio.path_ << std::wstring(L"\n\tvolume: ")
-      << std::to_wstring(audio.volume_) << std::wstring(L"\n\tmuted: ") << std::to_wstring(audio.muted_)
-      << std::wstring(L"\n\ticon: ") << audio.get_icon_data().size() << std::wstring(L"\n\tPID: ")
-      << std::to_wstring(audio.pid_);
-
-  return out;
+bool VolumeControl::init() {
+  if (FAILED(CoInitialize(NULL))) {
+    return false;
+  }
+  // the cache is an optimization only, icons are extracted without it too
+  ProcessAPI::open_icon_cache(fs::temp_directory_path() / L"VolumeMixer" / L"icons.pack", 4 * 1024 * 1024);
+  return true;
 }
 
-std::vector<uint8_t> VolumeControl::AudioSessionInfo::get_icon_data() const {
-  return ProcessAPI::get_png_from_pid(pid_);
-}
+VolumeControl::SessionSnapshot VolumeControl::get_session_snapshot() {
+  struct Row {
+    DWORD pid_;
+    uint8_t endpoint_;
+    float volume_;
+    bool muted_;
+  };
 
-bool VolumeControl::init() {
-  return SUCCEEDED(CoInitialize(NULL));
-}
+  // the devices are scanned in parallel, each into its own list. Most of a scan is waiting for the audio service
+  const auto devices = list_devices(false);
+  std::vector<std::vector<Row>> scans(devices.size());
+  scan_pool.run(devices.size(), [&devices, &scans](size_t i) {
+    auto cb = [&rows = scans[i], endpoint = devices[i].endpoint_](IAudioSessionControl* ctrl,
+                                                                  IAudioSessionControl2* ctrl2, DWORD pid) {
+      Row row{ pid, endpoint, 0, false };
+      ISimpleAudioVolume* volume;
+      if (SUCCEEDED(ctrl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&volume))) {
+        float vol = 0;
+        volume->GetMasterVolume(&vol);
+        row.volume_ = vol * 100.0f;
+        BOOL b;
+        volume->GetMute(&b);
+        row.muted_ = b;
+        SAFE_RELEASE(volume);
+      }
 
-std::vector<VolumeControl::AudioSessionInfo> VolumeControl::get_all_sessions_info() {
-  std::vector<AudioSessionInfo> ret;
-
-  auto cb = [&ret](IAudioSessionControl* ctrl, IAudioSessionControl2* ctrl2, DWORD pid) {
-    AudioSessionInfo info{};
-    info.pid_ = pid;
-    ISimpleAudioVolume* volume;
-    if (SUCCEEDED(ctrl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&volume))) {
-      float vol = 0;
-      volume->GetMasterVolume(&vol);
-      info.volume_ = vol * 100.0f;
-      BOOL b;
-      volume->GetMute(&b);
-      info.muted_ = b;
-      SAFE_RELEASE(volume);
-    }
+      rows.push_back(row);
+      return false;
+    };
+    session_enumerate(devices[i].id_, cb);
+  });
+
+  std::vector<Row> rows;
+  for (const auto& scan : scans) {
+    rows.insert(rows.end(), scan.begin(), scan.end());
+  }
+
+  static const auto system_record = std::make_shared<const SessionRecord>(0, std::wstring(L"System"));
+  static const auto master_record = std::make_shared<const SessionRecord>(-1, std::wstring(L"Master"));
+
+  // check the processes against one process table snapshot, their paths are only queried when they are read
+  std::lock_guard lock(snapshot_mutex);
+  std::vector<int> pids;
+  pids.reserve(rows.size());
+  for (const auto& row : rows) {
+    pids.push_back(row.pid_);
+  }
+  const auto new_pids = ProcessAPI::refresh_records(pids);
 
-    if (pid == 0) {
-      info.filename_ = L"System";
-    } else {
-      info.path_ = ProcessAPI::get_path_from_pid(pid);
-      info.filename_ = fs::path(info.path_).filename().stem().wstring();
+  SessionSnapshot::Builder builder;
+  for (const auto& row : rows) {
+    // refresh() made a record for every pid
+    builder.add(row.pid_, row.endpoint_, row.volume_, row.muted_,
+                row.pid_ == 0 ? system_record : ProcessAPI::get_record(row.pid_));
+  }
+
+  // start on the icons of new sessions, before the board asks for them
+  for (const int pid : new_pids) {
+    if (pid != 0) {
+      ProcessAPI::prefetch_png(ProcessAPI::get_record(pid)->path());
     }
-    ret.push_back(info);
-    return false;
-  };
+  }
+  // the master controls the default device, which is listed first
+  const uint8_t master_endpoint = devices.empty() ? 0 : devices.front().endpoint_;
+  builder.add(-1, master_endpoint, get_master_volume(), get_master_mute(), master_record);
 
-  session_enumerate(cb);
-  ret.push_back(get_master_info());
+  last_snapshot = builder.build(last_snapshot);
+  return last_snapshot;
+}
 
-  std::sort(ret.begin(), ret.end(),
-            [](const AudioSessionInfo& l, const AudioSessionInfo& r) { return l.pid_ < r.pid_; });
-  return ret;
+VolumeControl::SessionSnapshot VolumeControl::get_cached_snapshot() {
+  std::lock_guard lock(snapshot_mutex);
+  return last_snapshot;
 }
 
-float VolumeControl::get_volume(int pid) {
-  if (pid == -1) {
-    return get_master_volume();
-  } else {
-    return get_app_volume(pid);
+std::vector<VolumeControl::EndpointInfo> VolumeControl::get_endpoints() {
+  std::vector<EndpointInfo> ret;
+  for (auto& device : list_devices(true)) {
+    std::string name_utf8 = UTF8::from_wide(device.name_);
+    ret.push_back({ device.endpoint_, std::move(device.name_), std::move(name_utf8), device.default_ });
   }
+  return ret;
 }
 
-void VolumeControl::set_volume(int pid, float volume) {
-  if (pid == -1) {
-    set_master_volume(volume);
-  } else {
-    set_app_volume(pid, volume);
+std::vector<VolumeControl::OperationResult> VolumeControl::apply(const std::vector<Operation>& ops) {
+  OperationBatch batch(ops);
+
+  if (batch.wants(-1)) {
+    if (IAudioEndpointVolume* endpoint = GetMaster()) {
+      MasterVolume master(endpoint);
+      batch.serve(-1, master);
+      SAFE_RELEASE(endpoint);
+    }
   }
-}
 
-bool VolumeControl::get_muted(int pid) {
-  if (pid == -1) {
-    return get_master_mute();
-  } else {
-    return get_app_mute(pid);
+  // one pass over the sessions serves every pid. It stops once all are served, unless other devices may have
+  // further sessions of a pid, which was set
+  if (not batch.done()) {
+    session_enumerate([&batch](IAudioSessionControl* ctrl, IAudioSessionControl2* ctrl2, DWORD pid) {
+      if (batch.wants(pid)) {
+        ISimpleAudioVolume* volume;
+        if (SUCCEEDED(ctrl2->QueryInterface(__uuidof(ISimpleAudioVolume), (void**)&volume))) {
+          AppVolume app(volume);
+          batch.serve(pid, app);
+          SAFE_RELEASE(volume);
+        }
+      }
+      return batch.done();
+    });
   }
+  return batch.take_results();
 }
 
-void VolumeControl::set_muted(int pid, bool mute) {
-  if (pid == -1) {
-    set_master_mute(mute);
-  } else {
-    set_app_mute(pid, mute);
+std::vector<VolumeControl::MeterSample> VolumeControl::get_meter_samples() {
+  std::vector<MeterSample> samples;
+
+  session_enumerate([&samples](IAudioSessionControl* ctrl, IAudioSessionControl2* ctrl2, DWORD pid) {
+    IAudioMeterInformation* meter;
+    if (SUCCEEDED(ctrl->QueryInterface(__uuidof(IAudioMeterInformation), (void**)&meter))) {
+      float peak = 0;
+      meter->GetPeakValue(&peak);
+      samples.push_back({ static_cast<int>(pid), peak });
+      SAFE_RELEASE(meter);
+    }
+    return false;
+  });
+
+  if (IAudioMeterInformation* meter = GetEndpointInterface<IAudioMeterInformation>()) {
+    float peak = 0;
+    meter->GetPeakValue(&peak);
+    samples.push_back({ -1, peak });
+    SAFE_RELEASE(meter);
   }
+  return merge_meter_samples(std::move(samples));
 }
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "ico_decoder.h"
+#include <algorithm>
+#include <cstring>
+#include "pixel_convert.h"
+#include "png_decoder.h"
+
+
+namespace {
+
+  constexpr size_t info_header_size = 40;  // BITMAPINFOHEADER
+  constexpr size_t dir_header_size = 6;    // ICONDIR
+  constexpr size_t dir_entry_size = 16;    // ICONDIRENTRY
+  constexpr size_t file_header_size = 14;  // BITMAPFILEHEADER
+  constexpr uint32_t max_dimension = 4096;
+
+  uint16_t get_le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+  }
+
+  uint32_t get_le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  /// @brief bytes per row of a DIB, rows are padded to 4 bytes
+  constexpr size_t dib_stride(uint32_t width, uint32_t bpp) {
+    return ((static_cast<size_t>(width) * bpp + 31) / 32) * 4;
+  }
+
+  /// @brief Expand one row of palette indices to RGBA, BGRX palette entries are read directly
+  void expand_indexed(const uint8_t* src, uint32_t width, uint32_t bpp, const uint8_t* palette, uint32_t n_colors,
+                      uint8_t* dst) {
+    const unsigned per_byte = 8 / bpp;
+    const unsigned mask = (1u << bpp) - 1;
+    for (uint32_t x = 0; x < width; ++x, dst += 4) {
+      const unsigned shift = 8 - bpp * (x % per_byte + 1);
+      const unsigned idx = (src[x / per_byte] >> shift) & mask;
+      if (idx < n_colors) {
+        const uint8_t* entry = palette + 4 * idx;
+        dst[0] = entry[2];
+        dst[1] = entry[1];
+        dst[2] = entry[0];
+      } else {
+        dst[0] = dst[1] = dst[2] = 0;
+      }
+      dst[3] = 255;
+    }
+  }
+
+  /// @brief Expand one row of BGR pixels to RGBA
+  void expand_bgr(const uint8_t* src, uint32_t width, uint8_t* dst) {
+    for (uint32_t x = 0; x < width; ++x, src += 3, dst += 4) {
+      dst[0] = src[2];
+      dst[1] = src[1];
+      dst[2] = src[0];
+      dst[3] = 255;
+    }
+  }
+
+}  // namespace
+
+
+bool ICO::decode_dib(const uint8_t* data, size_t len, bool icon, std::vector<uint8_t>& rgba, uint32_t& width,
+                     uint32_t& height, Alpha alpha) {
+  if (len < info_header_size) {
+    return false;
+  }
+  const uint32_t header_size = get_le32(data);
+  const int32_t w = static_cast<int32_t>(get_le32(data + 4));
+  int32_t h = static_cast<int32_t>(get_le32(data + 8));
+  const uint16_t bpp = get_le16(data + 14);
+  const uint32_t compression = get_le32(data + 16);
+  const uint32_t colors_used = get_le32(data + 32);
+
+  // only uncompressed (BI_RGB) images, icons can't be top-down
+  if (header_size < info_header_size || header_size > len || compression != 0 || w <= 0 || h == 0 ||
+      (icon && h < 0)) {
+    return false;
+  }
+  if (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 24 && bpp != 32) {
+    return false;
+  }
+
+  const bool bottom_up = h > 0;
+  h = bottom_up ? h : -h;
+  if (icon) {
+    h /= 2;  // the height covers both the image and the mask
+  }
+  if (h == 0 || static_cast<uint32_t>(w) > max_dimension || static_cast<uint32_t>(h) > max_dimension) {
+    return false;
+  }
+  width = static_cast<uint32_t>(w);
+  height = static_cast<uint32_t>(h);
+
+  const uint32_t n_colors = bpp <= 8 ? (colors_used ? std::min(colors_used, 1u << bpp) : 1u << bpp) : 0;
+  const size_t palette_offset = header_size;
+  const size_t color_offset = palette_offset + 4 * static_cast<size_t>(n_colors);
+  const size_t color_stride = dib_stride(width, bpp);
+  const size_t mask_offset = color_offset + color_stride * height;
+  const size_t mask_stride = dib_stride(width, 1);
+  if (len < mask_offset) {
+    return false;
+  }
+  // some icons leave out the mask, the alpha channel has to do then
+  const bool has_mask = icon && len >= mask_offset + mask_stride * height;
+
+  rgba.resize(static_cast<size_t>(width) * height * 4);
+  const size_t dst_stride = static_cast<size_t>(width) * 4;
+  for (uint32_t y = 0; y < height; ++y) {
+    const size_t src_row = bottom_up ? height - 1 - y : y;
+    const uint8_t* src = data + color_offset + src_row * color_stride;
+    uint8_t* dst = rgba.data() + y * dst_stride;
+    if (bpp == 32) {
+      std::memcpy(dst, src, dst_stride);
+    } else if (bpp == 24) {
+      expand_bgr(src, width, dst);
+    } else {
+      expand_indexed(src, width, bpp, data + palette_offset, n_colors, dst);
+    }
+  }
+
+  if (bpp == 32) {
+    Pixels::swap_rb(rgba.data(), static_cast<size_t>(width) * height);
+  }
+
+  // a 32 bpp image with an all zero alpha channel predates alpha support and relies on the mask
+  bool has_alpha = false;
+  if (bpp == 32) {
+    for (size_t i = 3; i < rgba.size() && not has_alpha; i += 4) {
+      has_alpha = rgba[i] != 0;
+    }
+    if (not has_alpha && not has_mask) {
+      for (size_t i = 3; i < rgba.size(); i += 4) rgba[i] = 255;
+    }
+  }
+
+  if (has_mask && not has_alpha) {
+    for (uint32_t y = 0; y < height; ++y) {
+      const size_t src_row = height - 1 - y;
+      Pixels::apply_and_mask(data + mask_offset + src_row * mask_stride, width, rgba.data() + y * dst_stride);
+    }
+  }
+
+  if (alpha == Alpha::PREMULTIPLIED) {
+    Pixels::premultiply(rgba.data(), static_cast<size_t>(width) * height);
+  }
+  return true;
+}
+
+bool ICO::decode(const uint8_t* data, size_t len, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height,
+                 Alpha alpha) {
+  if (len < dir_header_size || get_le16(data) != 0 || get_le16(data + 2) != 1) {
+    return false;
+  }
+  const uint16_t count = get_le16(data + 4);
+  if (count == 0 || len < dir_header_size + dir_entry_size * count) {
+    return false;
+  }
+
+  // pick the largest image, then the deepest one
+  const uint8_t* best = nullptr;
+  uint64_t best_score = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    const uint8_t* entry = data + dir_header_size + dir_entry_size * i;
+    const uint32_t w = entry[0] ? entry[0] : 256;
+    const uint32_t h = entry[1] ? entry[1] : 256;
+    const uint64_t score = (static_cast<uint64_t>(w) * h << 8) | std::min<uint16_t>(get_le16(entry + 6), 255);
+    if (not best || score > best_score) {
+      best = entry;
+      best_score = score;
+    }
+  }
+
+  const uint32_t size = get_le32(best + 8);
+  const uint32_t offset = get_le32(best + 12);
+  if (offset > len || size > len - offset) {
+    return false;
+  }
+
+  static constexpr uint8_t png_signature[4] = { 0x89, 'P', 'N', 'G' };
+  if (size >= sizeof(png_signature) && std::equal(png_signature, png_signature + 4, data + offset)) {
+    if (not PNG::decode(data + offset, size, rgba, width, height)) {
+      return false;
+    }
+    if (alpha == Alpha::PREMULTIPLIED) {
+      Pixels::premultiply(rgba.data(), static_cast<size_t>(width) * height);
+    }
+    return true;
+  }
+
+  return decode_dib(data + offset, size, true, rgba, width, height, alpha);
+}
+
+bool ICO::decode_bmp(const uint8_t* data, size_t len, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height,
+                     Alpha alpha) {
+  if (len < file_header_size || data[0] != 'B' || data[1] != 'M') {
+    return false;
+  }
+  const uint32_t bits_offset = get_le32(data + 10);
+  const uint8_t* dib = data + file_header_size;
+  const size_t dib_len = len - file_header_size;
+  if (bits_offset < file_header_size || bits_offset > len || dib_len < info_header_size) {
+    return false;
+  }
+
+  // the palette follows the header, the color bits may be further away, so rebuild the layout decode_dib expects
+  const uint32_t header_size = get_le32(dib);
+  const uint16_t bpp = get_le16(dib + 14);
+  const uint32_t colors_used = get_le32(dib + 32);
+  const uint32_t n_colors = bpp <= 8 ? (colors_used ? std::min(colors_used, 1u << bpp) : 1u << bpp) : 0;
+  const size_t expected = file_header_size + static_cast<size_t>(header_size) + 4 * static_cast<size_t>(n_colors);
+  if (bits_offset == expected) {
+    return decode_dib(dib, dib_len, false, rgba, width, height, alpha);
+  }
+  if (bits_offset < expected) {
+    return false;
+  }
+
+  std::vector<uint8_t> packed(dib, dib + (expected - file_header_size));
+  packed.insert(packed.end(), data + bits_offset, data + len);
+  return decode_dib(packed.data(), packed.size(), false, rgba, width, height, alpha);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// @brief Portable decoder for .ico files and the DIBs inside them, so icons don't need the Windows imaging APIs
+namespace ICO {
+
+  enum class Alpha {
+    PREMULTIPLIED,
+    STRAIGHT,
+  };
+
+  /// @brief Decode a DIB: a BITMAPINFOHEADER, optional palette, color bits and, for icons, the AND mask
+  /// @param data start of the BITMAPINFOHEADER
+  /// @param len length of @p data
+  /// @param icon true for icon DIBs, where the height covers both the color bits and the AND mask
+  /// @param rgba output pixels, 4 bytes per pixel, top-down rows
+  /// @param width output width
+  /// @param height output height
+  /// @param alpha premultiply the colors or not
+  /// @return true on success. 1, 4, 8, 24 and 32 bpp uncompressed images are supported
+  bool decode_dib(const uint8_t* data, size_t len, bool icon, std::vector<uint8_t>& rgba, uint32_t& width,
+                  uint32_t& height, Alpha alpha = Alpha::PREMULTIPLIED);
+
+  /// @brief Decode the largest image of an .ico file. PNG compressed images are supported too
+  /// @param data the .ico file contents
+  /// @param len length of @p data
+  /// @param rgba output pixels, 4 bytes per pixel, top-down rows
+  /// @param width output width
+  /// @param height output height
+  /// @param alpha premultiply the colors or not
+  /// @return true on success
+  bool decode(const uint8_t* data, size_t len, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height,
+              Alpha alpha = Alpha::PREMULTIPLIED);
+
+  /// @brief Decode a .bmp file
+  /// @return true on success
+  bool decode_bmp(const uint8_t* data, size_t len, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height,
+                  Alpha alpha = Alpha::PREMULTIPLIED);
+
+};  // namespace ICO
@@ -0,0 +1,219 @@
+#include "icon_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "png_encoder.h"
+
+namespace fs = std::filesystem;
+
+
+namespace {
+
+  constexpr char pack_magic[8] = { 'V', 'M', 'I', 'C', 'O', 'N', '0', '1' };
+  constexpr uint32_t record_magic = 0x52434956;  // "VICR"
+
+  /// @brief Precedes every payload in the pack, payloads are padded to 8 bytes
+  struct RecordHeader {
+    uint32_t magic_;
+    uint32_t size_;  ///< payload size, without padding
+    uint64_t key_;
+    uint32_t crc_;  ///< crc of the payload
+    uint32_t reserved_;
+  };
+
+  constexpr size_t align8(size_t n) {
+    return (n + 7) & ~static_cast<size_t>(7);
+  }
+
+  uint64_t fnv1a(const void* data, size_t len, uint64_t hash = 0xCBF29CE484222325ull) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+  }
+
+  void write_record(std::ofstream& out, uint64_t key, const uint8_t* data, uint32_t size, uint32_t crc) {
+    const RecordHeader header{ record_magic, size, key, crc, 0 };
+    const char padding[8] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data), size);
+    out.write(padding, align8(size) - size);
+  }
+
+}  // namespace
+
+
+uint64_t IconCache::make_key(const std::wstring& exe_path) {
+  std::error_code ec;
+  const fs::path path(exe_path);
+  const uint64_t size = fs::file_size(path, ec);
+  if (ec) {
+    return 0;
+  }
+  const int64_t mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+  if (ec) {
+    return 0;
+  }
+
+  uint64_t hash = fnv1a(exe_path.data(), exe_path.size() * sizeof(wchar_t));
+  hash = fnv1a(&size, sizeof(size), hash);
+  hash = fnv1a(&mtime, sizeof(mtime), hash);
+  return hash ? hash : 1;
+}
+
+bool IconCache::open(const fs::path& file, uint64_t max_bytes) {
+  mapping_ = std::make_shared<MappedFile>();
+  index_.clear();
+  fresh_.clear();
+  fresh_bytes_ = 0;
+  file_ = file;
+  max_bytes_ = max_bytes;
+
+  std::error_code ec;
+  fs::create_directories(file.parent_path(), ec);
+
+  if (not mapping_->open(file) || scan() == 0) {
+    // missing or foreign file, start a new pack
+    mapping_->close();
+    std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(pack_magic, sizeof(pack_magic));
+    out.close();
+    if (not out || not mapping_->open(file)) {
+      file_.clear();
+      return false;
+    }
+    scan();
+  }
+
+  if (pack_size_ < mapping_->size()) {
+    // torn write at the end, keep the valid records only
+    if (not compact(max_bytes_)) {
+      return false;
+    }
+  } else if (pack_size_ > max_bytes_) {
+    // leave some room for new icons, so the pack isn't rewritten on every start
+    if (not compact(max_bytes_ / 4 * 3)) {
+      return false;
+    }
+  }
+  // a torn record the compaction couldn't drop would hide the records appended behind it
+  appendable_ = pack_size_ == mapping_->size();
+  return true;
+}
+
+size_t IconCache::scan() {
+  index_.clear();
+  pack_size_ = 0;
+
+  const uint8_t* data = mapping_->data();
+  const size_t size = mapping_->size();
+  if (size < sizeof(pack_magic) || memcmp(data, pack_magic, sizeof(pack_magic)) != 0) {
+    return 0;
+  }
+
+  size_t pos = sizeof(pack_magic);
+  while (pos + sizeof(RecordHeader) <= size) {
+    RecordHeader header;
+    memcpy(&header, data + pos, sizeof(header));
+    const size_t payload = pos + sizeof(header);
+    if (header.magic_ != record_magic || payload + header.size_ > size ||
+        PNG::crc32(data + payload, header.size_) != header.crc_) {
+      break;
+    }
+    // later records of the same key replace earlier ones
+    index_[header.key_] = { payload, header.size_, header.crc_ };
+    pos = std::min(size, payload + align8(header.size_));
+  }
+
+  pack_size_ = pos;
+  return pos;
+}
+
+bool IconCache::compact(uint64_t budget) {
+  // the offset is the age, later records are newer
+  std::vector<std::pair<uint64_t, Location>> entries(index_.begin(), index_.end());
+  std::sort(entries.begin(), entries.end(),
+            [](const auto& l, const auto& r) { return l.second.offset_ > r.second.offset_; });
+
+  uint64_t total = sizeof(pack_magic);
+  size_t keep = 0;
+  for (; keep < entries.size(); ++keep) {
+    const uint64_t record = sizeof(RecordHeader) + align8(entries[keep].second.size_);
+    if (total + record > budget) {
+      break;
+    }
+    total += record;
+  }
+  entries.resize(keep);
+  std::reverse(entries.begin(), entries.end());
+
+  const fs::path tmp = fs::path(file_).concat(L".tmp");
+  std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+  out.write(pack_magic, sizeof(pack_magic));
+  for (const auto& [key, loc] : entries) {
+    write_record(out, key, mapping_->data() + loc.offset_, loc.size_, loc.crc_);
+  }
+  out.close();
+
+  // unmap the old pack, unless blobs of an earlier open() hold it. Then the rename fails on windows, and the old pack
+  // is mapped again
+  mapping_ = std::make_shared<MappedFile>();
+  std::error_code ec;
+  if (out) {
+    fs::rename(tmp, file_, ec);
+  }
+  if (not out || ec) {
+    fs::remove(tmp, ec);
+  }
+  if (not mapping_->open(file_)) {
+    file_.clear();
+    index_.clear();
+    return false;
+  }
+  scan();
+  return true;
+}
+
+void IconCache::trim_fresh() {
+  while (fresh_bytes_ > max_bytes_ && not fresh_.empty()) {
+    const auto oldest = std::min_element(fresh_.begin(), fresh_.end(),
+                                         [](const auto& l, const auto& r) { return l.second.age_ < r.second.age_; });
+    fresh_bytes_ -= oldest->second.payload_->size();
+    fresh_.erase(oldest);
+  }
+}
+
+IconCache::Blob IconCache::find(uint64_t key) const {
+  if (const auto it = fresh_.find(key); it != fresh_.end()) {
+    const auto& payload = it->second.payload_;
+    return { payload->data(), payload->size(), payload, it->second.crc_ };
+  }
+  if (const auto it = index_.find(key); it != index_.end()) {
+    return { mapping_->data() + it->second.offset_, it->second.size_, mapping_, it->second.crc_ };
+  }
+  return {};
+}
+
+IconCache::Blob IconCache::put(uint64_t key, std::vector<uint8_t> payload) {
+  const auto stored = std::make_shared<const std::vector<uint8_t>>(std::move(payload));
+  const uint32_t crc = PNG::crc32(stored->data(), stored->size());
+  if (const auto it = fresh_.find(key); it != fresh_.end()) {
+    fresh_bytes_ -= it->second.payload_->size();
+  }
+  fresh_[key] = { stored, crc, fresh_age_++ };
+  fresh_bytes_ += stored->size();
+
+  // the pack is mapped, the next open() compacts it
+  const uint64_t record = sizeof(RecordHeader) + align8(stored->size());
+  if (is_open() && appendable_ && pack_size_ + record <= 2 * max_bytes_) {
+    std::ofstream out(file_, std::ios::out | std::ios::binary | std::ios::app);
+    write_record(out, key, stored->data(), static_cast<uint32_t>(stored->size()), crc);
+    if (out) {
+      pack_size_ += record;
+    }
+  }
+  trim_fresh();
+
+  return { stored->data(), stored->size(), stored, crc };
+}
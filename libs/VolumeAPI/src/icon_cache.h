@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mapped_file.h"
+
+
+/// @brief Persistent cache of encoded icons.
+///
+/// The payloads are stored in an append-only pack file, which is memory-mapped by open(). Icons found in the pack are
+/// served straight from the mapping, icons added later are kept in memory and appended to the pack for the next run.
+/// The pack is only rewritten by open(), before any of its blobs are handed out, a mapped file can't be replaced on
+/// windows. During a run it grows to twice the limit at most, the icons beyond are kept in memory only. The icons kept
+/// in memory are bounded by the limit, the oldest ones are dropped first.
+class IconCache {
+public:
+  /// @brief View of a cached payload, @p owner_ keeps the memory behind it alive
+  struct Blob {
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<const void> owner_;  ///< the mapping or the in-memory entry
+    uint32_t hash_ = 0;                  ///< CRC-32 of the payload, stored along with it
+
+    explicit operator bool() const {
+      return data_ != nullptr;
+    }
+  };
+
+  /// @brief Compute the cache key of an executable from its path, size and modification time
+  /// @return the key, 0 if the file can't be queried
+  [[nodiscard]] static uint64_t make_key(const std::wstring& exe_path);
+
+  /// @brief Open or create the pack at @p file and map it.
+  /// When the pack is larger than @p max_bytes, it is compacted and the oldest entries are evicted first. If blobs of
+  /// an earlier open() still map the pack, the compaction is left to the next open(). @p max_bytes bounds the icons
+  /// kept in memory too
+  /// @return true on success
+  bool open(const std::filesystem::path& file, uint64_t max_bytes);
+
+  [[nodiscard]] bool is_open() const {
+    return not file_.empty();
+  }
+
+  /// @brief Look up @p key
+  /// @return view of the payload, empty if not cached
+  [[nodiscard]] Blob find(uint64_t key) const;
+
+  /// @brief Add @p payload under @p key and append it to the pack, unless the pack reached twice the limit
+  Blob put(uint64_t key, std::vector<uint8_t> payload);
+
+private:
+  struct Location {
+    size_t offset_;  ///< offset of payload in the mapping
+    uint32_t size_;
+    uint32_t crc_;
+  };
+
+  struct FreshEntry {
+    std::shared_ptr<const std::vector<uint8_t>> payload_;
+    uint32_t crc_;
+    uint64_t age_;  ///< order of the puts, the newest entry has the highest
+  };
+
+  /// @brief Index the records of the mapping
+  /// @return the size of the valid part of the pack
+  size_t scan();
+
+  /// @brief Rewrite the pack with the newest mapped entries, which fit into @p budget bytes, and map it again.
+  /// Keeps the old pack if it can't be replaced
+  /// @return false if no pack is mapped afterwards
+  bool compact(uint64_t budget);
+
+  /// @brief Drop the oldest fresh entries, until they fit into max_bytes_
+  void trim_fresh();
+
+  std::filesystem::path file_;
+  uint64_t max_bytes_ = 4 * 1024 * 1024;  ///< of the pack, and of the fresh entries, also without a pack
+  uint64_t pack_size_ = 0;
+  bool appendable_ = false;  ///< the pack ends with a whole record
+  uint64_t fresh_bytes_ = 0;
+  uint64_t fresh_age_ = 0;  ///< age of the next fresh entry
+  std::shared_ptr<MappedFile> mapping_;  ///< shared with the blobs, which outlive a reopen
+  std::unordered_map<uint64_t, Location> index_;
+  std::unordered_map<uint64_t, FreshEntry> fresh_;  ///< entries added since open()
+};
@@ -0,0 +1,62 @@
+#include "icon_prefetcher.h"
+#include <algorithm>
+
+
+IconPrefetcher::IconPrefetcher(job_t job, size_t n_workers, size_t max_queued)
+  : job_(std::move(job)), max_queued_(max_queued) {
+  for (size_t i = 0; i < n_workers; ++i) {
+    workers_.emplace_back(&IconPrefetcher::worker, this);
+  }
+}
+
+IconPrefetcher::~IconPrefetcher() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+    queue_.clear();
+  }
+  queue_cv_.notify_all();
+  for (auto& t : workers_) {
+    t.join();
+  }
+}
+
+bool IconPrefetcher::request(const std::wstring& path) {
+  {
+    std::lock_guard lock(mutex_);
+    if (queue_.size() >= max_queued_ || running_.count(path) ||
+        std::find(queue_.begin(), queue_.end(), path) != queue_.end()) {
+      return false;
+    }
+    queue_.push_back(path);
+  }
+  queue_cv_.notify_one();
+  return true;
+}
+
+void IconPrefetcher::wait_or_cancel(const std::wstring& path) {
+  std::unique_lock lock(mutex_);
+  queue_.erase(std::remove(queue_.begin(), queue_.end(), path), queue_.end());
+  done_cv_.wait(lock, [this, &path] { return running_.count(path) == 0; });
+}
+
+void IconPrefetcher::worker() {
+  std::unique_lock lock(mutex_);
+  for (;;) {
+    queue_cv_.wait(lock, [this] { return stop_ || not queue_.empty(); });
+    if (stop_) {
+      return;
+    }
+
+    const std::wstring path = std::move(queue_.front());
+    queue_.pop_front();
+    running_.insert(path);
+
+    lock.unlock();
+    job_(path);
+    lock.lock();
+
+    running_.erase(path);
+    done_cv_.notify_all();
+  }
+}
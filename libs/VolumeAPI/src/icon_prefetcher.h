@@ -0,0 +1,45 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+
+/// @brief Bounded pool of worker threads, which prepare icons before they are first requested.
+/// Every executable path is processed by at most one job at a time.
+class IconPrefetcher {
+public:
+  using job_t = std::function<void(const std::wstring&)>;
+
+  /// @param job called on a worker thread for every requested path
+  /// @param n_workers number of worker threads
+  /// @param max_queued requests over this limit are dropped
+  IconPrefetcher(job_t job, size_t n_workers, size_t max_queued);
+  IconPrefetcher(const IconPrefetcher&) = delete;
+  IconPrefetcher& operator=(const IconPrefetcher&) = delete;
+  ~IconPrefetcher();
+
+  /// @brief Queue @p path, unless it's already queued or running
+  /// @return true if the path was queued
+  bool request(const std::wstring& path);
+
+  /// @brief Make sure no worker is busy with @p path. A queued request is cancelled, a running one is waited for
+  void wait_or_cancel(const std::wstring& path);
+
+private:
+  void worker();
+
+  const job_t job_;
+  const size_t max_queued_;
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable done_cv_;
+  std::deque<std::wstring> queue_;
+  std::unordered_set<std::wstring> running_;
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+};
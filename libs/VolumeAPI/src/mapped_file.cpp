@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+#include <Windows.h>
+
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+bool MappedFile::open(const std::filesystem::path& path) {
+  close();
+
+  HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER file_size{};
+  if (not GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return false;
+  }
+  if (file_size.QuadPart == 0) {
+    // empty files can't be mapped
+    CloseHandle(file);
+    return true;
+  }
+
+  HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);  // the mapping keeps the file open
+  if (mapping == NULL) {
+    return false;
+  }
+
+  const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == NULL) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  handle_ = mapping;
+  data_ = static_cast<const uint8_t*>(view);
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (handle_) {
+    CloseHandle(handle_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  handle_ = nullptr;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+/// @brief Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  /// @brief Map @p path, an empty file is mapped as size() == 0
+  /// @return true on success
+  bool open(const std::filesystem::path& path);
+  void close();
+
+  [[nodiscard]] const uint8_t* data() const {
+    return data_;
+  }
+
+  [[nodiscard]] size_t size() const {
+    return size_;
+  }
+
+private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  void* handle_ = nullptr;  ///< OS specific handle of the mapping
+};
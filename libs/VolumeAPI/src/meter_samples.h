@@ -0,0 +1,15 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+
+/// @brief Sort @p samples by pid and keep one per pid, with the highest peak of its sessions
+inline std::vector<VolumeControl::MeterSample> merge_meter_samples(std::vector<VolumeControl::MeterSample> samples) {
+  std::sort(samples.begin(), samples.end(), [](const auto& l, const auto& r) {
+    return l.pid_ < r.pid_ || (l.pid_ == r.pid_ && l.peak_ > r.peak_);
+  });
+  const auto same_pid = [](const auto& l, const auto& r) { return l.pid_ == r.pid_; };
+  samples.erase(std::unique(samples.begin(), samples.end(), same_pid), samples.end());
+  return samples;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "VolumeAPI/VolumeAPI.h"
+
+
+/// @brief The operations of one VolumeControl::apply() call, grouped by pid.
+///
+/// The backend enumerates the sessions once and hands every session, which wants() reports, to serve(). Pids
+/// which are never served end up as NOT_FOUND. A process can play on several devices: its first session runs the
+/// operations, the further ones follow with the volume and mute state the operations set.
+class OperationBatch {
+public:
+  /// @param ops outlive the batch
+  explicit OperationBatch(const std::vector<VolumeControl::Operation>& ops)
+    : ops_(ops), results_(ops.size(), { VolumeControl::OperationStatus::NOT_FOUND, 0, false }) {
+    for (size_t i = 0; i < ops.size(); ++i) {
+      pending_[ops[i].pid_].push_back(static_cast<uint32_t>(i));
+    }
+  }
+
+  /// @brief Check if operations of @p pid are waiting for a session, or further sessions of @p pid have to follow
+  [[nodiscard]] bool wants(int pid) const {
+    return pending_.count(pid) != 0 || follow_.count(pid) != 0;
+  }
+
+  /// @brief true once every pid was served and nothing was set, the enumeration can stop
+  [[nodiscard]] bool done() const {
+    return pending_.empty() && follow_.empty();
+  }
+
+  /// @brief Run the operations of @p pid on @p session.
+  /// @p session provides float volume(), bool muted(), set_volume(float) and set_muted(bool), volumes in %
+  template <class Session>
+  void serve(int pid, Session& session) {
+    if (const auto follow = follow_.find(pid); follow != follow_.end()) {
+      const Follow& state = follow->second;
+      if (state.set_volume_) {
+        session.set_volume(state.volume_);
+      }
+      if (state.set_muted_) {
+        session.set_muted(state.muted_);
+      }
+      return;
+    }
+    const auto it = pending_.find(pid);
+    if (it == pending_.end()) {
+      return;
+    }
+
+    // read once, the setters are trusted afterwards
+    float volume = session.volume();
+    bool muted = session.muted();
+    Follow state{ false, 0, false, false };
+    for (const uint32_t i : it->second) {
+      const auto& op = ops_[i];
+      switch (op.kind_) {
+        case VolumeControl::Operation::Kind::GET:
+          break;
+        case VolumeControl::Operation::Kind::SET_VOLUME:
+        case VolumeControl::Operation::Kind::CHANGE_VOLUME: {
+          const float base = op.kind_ == VolumeControl::Operation::Kind::SET_VOLUME ? 0 : volume;
+          volume = std::clamp(base + op.volume_, 0.0f, 100.0f);
+          session.set_volume(volume);
+          state.set_volume_ = true;
+        } break;
+        case VolumeControl::Operation::Kind::SET_MUTED:
+          muted = op.muted_;
+          session.set_muted(muted);
+          state.set_muted_ = true;
+          break;
+      }
+      results_[i] = { VolumeControl::OperationStatus::OK, volume, muted };
+    }
+    pending_.erase(it);
+
+    // the master is a single volume
+    if (pid != -1 && (state.set_volume_ || state.set_muted_)) {
+      state.volume_ = volume;
+      state.muted_ = muted;
+      follow_.emplace(pid, state);
+    }
+  }
+
+  /// @return the results, in the order of the operations
+  [[nodiscard]] std::vector<VolumeControl::OperationResult> take_results() {
+    return std::move(results_);
+  }
+
+private:
+  /// @brief What the further sessions of a served pid are set to
+  struct Follow {
+    bool set_volume_;
+    float volume_;
+    bool set_muted_;
+    bool muted_;
+  };
+
+  const std::vector<VolumeControl::Operation>& ops_;
+  std::vector<VolumeControl::OperationResult> results_;
+  std::unordered_map<int, std::vector<uint32_t>> pending_;  ///< indices of the operations of each pid, in order
+  std::unordered_map<int, Follow> follow_;                  ///< served pids, which set something
+};
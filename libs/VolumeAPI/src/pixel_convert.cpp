@@ -0,0 +1,420 @@
+#include "pixel_convert.h"
+#include <algorithm>
+#include <utility>
+
+// PIXELS_AVX2 is set by the build on x86-64, the kernels are used if the CPU has AVX2
+#if defined(PIXELS_AVX2)
+  #include "pixel_convert_avx2.h"
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define PIXELS_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define PIXELS_NEON
+#endif
+
+
+namespace {
+
+  /// @brief round(x / 255) for x in [0, 255 * 255]
+  inline uint8_t div255(uint32_t x) {
+    x += 128;
+    return static_cast<uint8_t>((x + (x >> 8)) >> 8);
+  }
+
+  inline uint16_t pack565(uint8_t r, uint8_t g, uint8_t b) {
+    return static_cast<uint16_t>(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+  }
+
+  inline void store16(uint8_t* dst, uint16_t val, bool swap) {
+    dst[swap ? 1 : 0] = static_cast<uint8_t>(val);
+    dst[swap ? 0 : 1] = static_cast<uint8_t>(val >> 8);
+  }
+
+  inline void blend_pixel(const uint8_t* px, const uint8_t* bg, uint8_t* out) {
+    const uint32_t a = px[3];
+    for (int c = 0; c < 3; ++c) {
+      out[c] = div255(px[c] * a + bg[c] * (255 - a));
+    }
+  }
+
+
+#if defined(PIXELS_SSE2)
+
+  /// @brief Blend 4 RGBA pixels over @p bg16, which holds the background as 16 bit lanes: r g b 0 r g b 0
+  /// @return 4 blended pixels, the 4th byte is undefined
+  inline __m128i blend4_sse2(__m128i px, __m128i bg16) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    __m128i res[2];
+    const __m128i halves[2] = { _mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero) };
+    for (int i = 0; i < 2; ++i) {
+      const __m128i p = halves[i];
+      const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, 0xFF), 0xFF);
+      __m128i x = _mm_add_epi16(_mm_mullo_epi16(p, a), _mm_mullo_epi16(bg16, _mm_sub_epi16(c255, a)));
+      x = _mm_add_epi16(x, c128);
+      res[i] = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+    return _mm_packus_epi16(res[0], res[1]);
+  }
+
+  /// @brief RGBX pixels in 32 bit lanes to RGB565 values in 32 bit lanes, sign extended for _mm_packs_epi32
+  inline __m128i to565_sse2(__m128i v, bool swap) {
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xF8)), 8);
+    const __m128i g = _mm_srli_epi32(_mm_and_si128(v, _mm_set1_epi32(0xFC00)), 5);
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(v, 19), _mm_set1_epi32(0x1F));
+    __m128i x = _mm_or_si128(_mm_or_si128(r, g), b);
+    if (swap) {
+      x = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(x, _mm_set1_epi32(0xFF)), 8), _mm_srli_epi32(x, 8));
+    }
+    return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+  }
+
+#endif
+
+#if defined(PIXELS_AVX2)
+
+  bool cpu_has_avx2() {
+  #if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+      return false;
+    }
+    // the OS has to save the AVX registers too
+    __cpuid(info, 1);
+    const bool osxsave = info[2] & (1 << 27);
+    if (not osxsave || (_xgetbv(0) & 6) != 6) {
+      return false;
+    }
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+  #else
+    return __builtin_cpu_supports("avx2");
+  #endif
+  }
+
+  const bool use_avx2 = cpu_has_avx2();
+
+#endif
+
+#if defined(PIXELS_NEON)
+
+  inline uint8x8_t blend8_neon(uint8x8_t c, uint8x8_t a, uint8x8_t inv, uint8x8_t bg) {
+    uint16x8_t x = vmlal_u8(vmull_u8(c, a), bg, inv);
+    x = vaddq_u16(x, vdupq_n_u16(128));
+    return vshrn_n_u16(vaddq_u16(x, vshrq_n_u16(x, 8)), 8);
+  }
+
+#endif
+
+
+  /// @brief Sum of the alpha weighted channels over a rectangle of pixels
+  struct Sums {
+    uint64_t r_, g_, b_, a_;
+  };
+
+  void sum_pixels(const uint8_t* px, uint32_t n, Sums& s) {
+    for (uint32_t x = 0; x < n; ++x, px += 4) {
+      s.r_ += px[0] * px[3];
+      s.g_ += px[1] * px[3];
+      s.b_ += px[2] * px[3];
+      s.a_ += px[3];
+    }
+  }
+
+#if defined(PIXELS_NEON)
+
+  inline uint64_t sum_lanes(uint32x4_t v) {
+    const uint64x2_t s = vpaddlq_u32(v);
+    return vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1);
+  }
+
+#endif
+
+  Sums sum_rect(const uint8_t* src, uint32_t src_w, uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1) {
+    Sums s{};
+    const uint32_t w = x1 - x0;
+    uint32_t vec_w = 0;
+
+    // 32 bit lanes hold up to 65536 pixels of 255 * 255
+    if (static_cast<uint64_t>(w) * (y1 - y0) <= 65536) {
+#if defined(PIXELS_SSE2)
+      // 4 pixels per step, the products of both pixels of a 64 bit half add up in the same lanes: r g b a
+      vec_w = w & ~3u;
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+      const __m128i alpha_one = _mm_set_epi16(1, 0, 0, 0, 1, 0, 0, 0);
+      __m128i acc = _mm_setzero_si128();
+      for (uint32_t y = y0; y < y1; ++y) {
+        const uint8_t* px = src + (static_cast<size_t>(y) * src_w + x0) * 4;
+        for (uint32_t x = 0; x < vec_w; x += 4) {
+          const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + 4 * x));
+          const __m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+          for (const __m128i& p : halves) {
+            const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, 0xFF), 0xFF);
+            const __m128i prod = _mm_mullo_epi16(p, _mm_or_si128(_mm_and_si128(a, rgb_mask), alpha_one));
+            acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(prod, zero), _mm_unpackhi_epi16(prod, zero)));
+          }
+        }
+      }
+      alignas(16) uint32_t lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+      s = { lanes[0], lanes[1], lanes[2], lanes[3] };
+#elif defined(PIXELS_NEON)
+      // 8 pixels per step, deinterleaved into channels
+      vec_w = w & ~7u;
+      uint32x4_t acc_r = vdupq_n_u32(0), acc_g = vdupq_n_u32(0), acc_b = vdupq_n_u32(0), acc_a = vdupq_n_u32(0);
+      for (uint32_t y = y0; y < y1; ++y) {
+        const uint8_t* px = src + (static_cast<size_t>(y) * src_w + x0) * 4;
+        for (uint32_t x = 0; x < vec_w; x += 8) {
+          const uint8x8x4_t v = vld4_u8(px + 4 * x);
+          acc_r = vpadalq_u16(acc_r, vmull_u8(v.val[0], v.val[3]));
+          acc_g = vpadalq_u16(acc_g, vmull_u8(v.val[1], v.val[3]));
+          acc_b = vpadalq_u16(acc_b, vmull_u8(v.val[2], v.val[3]));
+          acc_a = vpadalq_u16(acc_a, vmovl_u8(v.val[3]));
+        }
+      }
+      s = { sum_lanes(acc_r), sum_lanes(acc_g), sum_lanes(acc_b), sum_lanes(acc_a) };
+#endif
+    }
+
+    for (uint32_t y = y0; y < y1; ++y) {
+      sum_pixels(src + (static_cast<size_t>(y) * src_w + x0 + vec_w) * 4, w - vec_w, s);
+    }
+    return s;
+  }
+
+}  // namespace
+
+
+void Pixels::resize(const uint8_t* src, uint32_t src_w, uint32_t src_h, uint8_t* dst, uint32_t dst_w,
+                    uint32_t dst_h) {
+  if (src_w == dst_w && src_h == dst_h) {
+    std::copy(src, src + static_cast<size_t>(src_w) * src_h * 4, dst);
+    return;
+  }
+
+  for (uint32_t dy = 0; dy < dst_h; ++dy) {
+    const uint32_t y0 = static_cast<uint32_t>(static_cast<uint64_t>(dy) * src_h / dst_h);
+    const uint32_t y1 = std::max(y0 + 1, static_cast<uint32_t>(static_cast<uint64_t>(dy + 1) * src_h / dst_h));
+    for (uint32_t dx = 0; dx < dst_w; ++dx) {
+      const uint32_t x0 = static_cast<uint32_t>(static_cast<uint64_t>(dx) * src_w / dst_w);
+      const uint32_t x1 = std::max(x0 + 1, static_cast<uint32_t>(static_cast<uint64_t>(dx + 1) * src_w / dst_w));
+
+      const Sums s = sum_rect(src, src_w, x0, x1, y0, y1);
+      const uint64_t area = static_cast<uint64_t>(x1 - x0) * (y1 - y0);
+      uint8_t* out = dst + (static_cast<size_t>(dy) * dst_w + dx) * 4;
+      if (s.a_ == 0) {
+        std::fill(out, out + 4, 0);
+        continue;
+      }
+      // colors are averaged weighted by alpha, so transparent pixels don't darken the edges
+      out[0] = static_cast<uint8_t>((s.r_ + s.a_ / 2) / s.a_);
+      out[1] = static_cast<uint8_t>((s.g_ + s.a_ / 2) / s.a_);
+      out[2] = static_cast<uint8_t>((s.b_ + s.a_ / 2) / s.a_);
+      out[3] = static_cast<uint8_t>((s.a_ + area / 2) / area);
+    }
+  }
+}
+
+void Pixels::blend_rgb565(const uint8_t* rgba, size_t n, uint32_t background, bool swap, uint8_t* dst) {
+  const uint8_t bg[3] = { static_cast<uint8_t>(background >> 16), static_cast<uint8_t>(background >> 8),
+                          static_cast<uint8_t>(background) };
+  size_t i = 0;
+
+#if defined(PIXELS_AVX2)
+  if (use_avx2) {
+    i = AVX2::blend_rgb565(rgba, n, bg, swap, dst);
+  }
+#endif
+#if defined(PIXELS_SSE2)
+  const __m128i bg16 = _mm_set_epi16(0, bg[2], bg[1], bg[0], 0, bg[2], bg[1], bg[0]);
+  for (; i + 8 <= n; i += 8) {
+    const __m128i lo = blend4_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 4 * i)), bg16);
+    const __m128i hi = blend4_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 4 * i + 16)), bg16);
+    const __m128i packed = _mm_packs_epi32(to565_sse2(lo, swap), to565_sse2(hi, swap));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), packed);
+  }
+#elif defined(PIXELS_NEON)
+  const uint8x8_t bg_r = vdup_n_u8(bg[0]), bg_g = vdup_n_u8(bg[1]), bg_b = vdup_n_u8(bg[2]);
+  for (; i + 8 <= n; i += 8) {
+    const uint8x8x4_t px = vld4_u8(rgba + 4 * i);
+    const uint8x8_t inv = vmvn_u8(px.val[3]);
+    const uint8x8_t r = blend8_neon(px.val[0], px.val[3], inv, bg_r);
+    const uint8x8_t g = blend8_neon(px.val[1], px.val[3], inv, bg_g);
+    const uint8x8_t b = blend8_neon(px.val[2], px.val[3], inv, bg_b);
+    uint16x8_t v = vorrq_u16(vshll_n_u8(vand_u8(r, vdup_n_u8(0xF8)), 8),
+                             vorrq_u16(vshll_n_u8(vand_u8(g, vdup_n_u8(0xFC)), 3), vmovl_u8(vshr_n_u8(b, 3))));
+    if (swap) {
+      v = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(v)));
+    }
+    vst1q_u8(dst + 2 * i, vreinterpretq_u8_u16(v));
+  }
+#endif
+
+  for (; i < n; ++i) {
+    uint8_t out[3];
+    blend_pixel(rgba + 4 * i, bg, out);
+    store16(dst + 2 * i, pack565(out[0], out[1], out[2]), swap);
+  }
+}
+
+void Pixels::blend_rgb888(const uint8_t* rgba, size_t n, uint32_t background, uint8_t* dst) {
+  const uint8_t bg[3] = { static_cast<uint8_t>(background >> 16), static_cast<uint8_t>(background >> 8),
+                          static_cast<uint8_t>(background) };
+  size_t i = 0;
+
+#if defined(PIXELS_AVX2)
+  if (use_avx2) {
+    i = AVX2::blend_rgb888(rgba, n, bg, dst);
+  }
+#endif
+#if defined(PIXELS_SSE2)
+  const __m128i bg16 = _mm_set_epi16(0, bg[2], bg[1], bg[0], 0, bg[2], bg[1], bg[0]);
+  for (; i + 4 <= n; i += 4) {
+    alignas(16) uint8_t blended[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(blended),
+                    blend4_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + 4 * i)), bg16));
+    for (int k = 0; k < 4; ++k) std::copy(blended + 4 * k, blended + 4 * k + 3, dst + 3 * (i + k));
+  }
+#elif defined(PIXELS_NEON)
+  const uint8x8_t bg_r = vdup_n_u8(bg[0]), bg_g = vdup_n_u8(bg[1]), bg_b = vdup_n_u8(bg[2]);
+  for (; i + 8 <= n; i += 8) {
+    const uint8x8x4_t px = vld4_u8(rgba + 4 * i);
+    const uint8x8_t inv = vmvn_u8(px.val[3]);
+    uint8x8x3_t out;
+    out.val[0] = blend8_neon(px.val[0], px.val[3], inv, bg_r);
+    out.val[1] = blend8_neon(px.val[1], px.val[3], inv, bg_g);
+    out.val[2] = blend8_neon(px.val[2], px.val[3], inv, bg_b);
+    vst3_u8(dst + 3 * i, out);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    blend_pixel(rgba + 4 * i, bg, dst + 3 * i);
+  }
+}
+
+void Pixels::to_rgb565a8(const uint8_t* rgba, size_t n, bool swap, uint8_t* dst) {
+  for (size_t i = 0; i < n; ++i, rgba += 4, dst += 3) {
+    store16(dst, pack565(rgba[0], rgba[1], rgba[2]), swap);
+    dst[2] = rgba[3];
+  }
+}
+
+void Pixels::to_rgb888a8(const uint8_t* rgba, size_t n, uint8_t* dst) {
+  std::copy(rgba, rgba + 4 * n, dst);
+}
+
+void Pixels::swap_rb(uint8_t* px, size_t n) {
+  size_t i = 0;
+
+#if defined(PIXELS_SSE2)
+  const __m128i keep = _mm_set1_epi32(0xFF00FF00);
+  const __m128i low = _mm_set1_epi32(0xFF);
+  for (; i + 4 <= n; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(px + 4 * i);
+    const __m128i v = _mm_loadu_si128(p);
+    const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+    const __m128i b = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(v, keep), _mm_or_si128(r, b)));
+  }
+#elif defined(PIXELS_NEON)
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x4_t v = vld4_u8(px + 4 * i);
+    const uint8x8_t tmp = v.val[0];
+    v.val[0] = v.val[2];
+    v.val[2] = tmp;
+    vst4_u8(px + 4 * i, v);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    std::swap(px[4 * i], px[4 * i + 2]);
+  }
+}
+
+void Pixels::apply_and_mask(const uint8_t* mask, size_t n, uint8_t* rgba) {
+  size_t i = 0;
+
+#if defined(PIXELS_SSE2)
+  // one mask byte covers 8 pixels, spread its bits to bytes and then to the alpha of each pixel
+  const __m128i bits = _mm_set_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, static_cast<char>(0x80));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i color = _mm_set1_epi32(0x00FFFFFF);
+  for (; i + 8 <= n; i += 8) {
+    const __m128i m = _mm_and_si128(_mm_set1_epi8(static_cast<char>(mask[i / 8])), bits);
+    const __m128i alpha = _mm_cmpeq_epi8(m, zero);
+    const __m128i alpha16 = _mm_unpacklo_epi8(zero, alpha);
+    __m128i* p = reinterpret_cast<__m128i*>(rgba + 4 * i);
+    const __m128i lo = _mm_or_si128(_mm_and_si128(_mm_loadu_si128(p), color), _mm_unpacklo_epi16(zero, alpha16));
+    const __m128i hi = _mm_or_si128(_mm_and_si128(_mm_loadu_si128(p + 1), color), _mm_unpackhi_epi16(zero, alpha16));
+    _mm_storeu_si128(p, lo);
+    _mm_storeu_si128(p + 1, hi);
+  }
+#elif defined(PIXELS_NEON)
+  const uint8_t bit_vals[8] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+  const uint8x8_t bits = vld1_u8(bit_vals);
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x4_t v = vld4_u8(rgba + 4 * i);
+    v.val[3] = vceq_u8(vand_u8(vdup_n_u8(mask[i / 8]), bits), vdup_n_u8(0));
+    vst4_u8(rgba + 4 * i, v);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    const bool transparent = (mask[i / 8] >> (7 - i % 8)) & 1;
+    rgba[4 * i + 3] = transparent ? 0 : 255;
+  }
+}
+
+void Pixels::premultiply(uint8_t* rgba, size_t n) {
+  size_t i = 0;
+
+#if defined(PIXELS_SSE2)
+  // blending over black is premultiplying
+  const __m128i black = _mm_setzero_si128();
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+  for (; i + 4 <= n; i += 4) {
+    __m128i* p = reinterpret_cast<__m128i*>(rgba + 4 * i);
+    const __m128i v = _mm_loadu_si128(p);
+    const __m128i colors = _mm_andnot_si128(alpha, blend4_sse2(v, black));
+    _mm_storeu_si128(p, _mm_or_si128(colors, _mm_and_si128(v, alpha)));
+  }
+#elif defined(PIXELS_NEON)
+  const uint8x8_t black = vdup_n_u8(0);
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x4_t v = vld4_u8(rgba + 4 * i);
+    const uint8x8_t inv = vmvn_u8(v.val[3]);
+    for (int c = 0; c < 3; ++c) v.val[c] = blend8_neon(v.val[c], v.val[3], inv, black);
+    vst4_u8(rgba + 4 * i, v);
+  }
+#endif
+
+  for (; i < n; ++i) {
+    uint8_t* px = rgba + 4 * i;
+    for (int c = 0; c < 3; ++c) px[c] = div255(px[c] * px[3]);
+  }
+}
+
+const char* Pixels::kernel_name() {
+#if defined(PIXELS_AVX2)
+  if (use_avx2) {
+    return "avx2";
+  }
+#endif
+#if defined(PIXELS_SSE2)
+  return "sse2";
+#elif defined(PIXELS_NEON)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
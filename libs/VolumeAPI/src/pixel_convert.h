@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/// @brief Conversion of RGBA images to the raw pixel formats of the board's display.
+/// The hot loops use SSE2 or NEON kernels, depending on the target, with a scalar fallback. On x86-64 the blend
+/// loops switch to AVX2 when the CPU supports it.
+namespace Pixels {
+
+  /// @brief Scale an image with area averaging, weighted by alpha. Upscaling repeats pixels
+  /// @param src RGBA pixels, non-premultiplied
+  /// @param dst output RGBA pixels, @p dst_w * @p dst_h * 4 bytes
+  void resize(const uint8_t* src, uint32_t src_w, uint32_t src_h, uint8_t* dst, uint32_t dst_w, uint32_t dst_h);
+
+  /// @brief Blend @p n RGBA pixels over @p background and convert them to RGB565
+  /// @param background 0x00RRGGBB
+  /// @param swap store the 16 bit values big-endian
+  /// @param dst output, 2 bytes per pixel
+  void blend_rgb565(const uint8_t* rgba, size_t n, uint32_t background, bool swap, uint8_t* dst);
+
+  /// @brief Blend @p n RGBA pixels over @p background and convert them to RGB888
+  /// @param background 0x00RRGGBB
+  /// @param dst output, 3 bytes per pixel
+  void blend_rgb888(const uint8_t* rgba, size_t n, uint32_t background, uint8_t* dst);
+
+  /// @brief Convert @p n RGBA pixels to RGB565 followed by an 8 bit alpha, without blending
+  void to_rgb565a8(const uint8_t* rgba, size_t n, bool swap, uint8_t* dst);
+
+  /// @brief Convert @p n RGBA pixels to RGB888 followed by an 8 bit alpha, without blending
+  void to_rgb888a8(const uint8_t* rgba, size_t n, uint8_t* dst);
+
+  /// @brief Swap the R and B channels of @p n 4 byte pixels in place, turning BGRA into RGBA
+  void swap_rb(uint8_t* px, size_t n);
+
+  /// @brief Set the alpha of @p n RGBA pixels from a 1 bpp AND mask, set bits are transparent
+  /// @param mask mask bits of one row, most significant bit first
+  void apply_and_mask(const uint8_t* mask, size_t n, uint8_t* rgba);
+
+  /// @brief Multiply the colors of @p n RGBA pixels by their alpha, in place
+  void premultiply(uint8_t* rgba, size_t n);
+
+  /// @brief name of the kernels in use
+  [[nodiscard]] const char* kernel_name();
+
+};  // namespace Pixels
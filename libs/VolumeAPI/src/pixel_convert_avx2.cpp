@@ -0,0 +1,74 @@
+#include "pixel_convert_avx2.h"
+#include <cstring>
+#include <immintrin.h>
+
+// Compiled with AVX2 enabled. Inline functions of other headers would be compiled with AVX2 too, and the linker may
+// pick them for the whole program, so this file only uses intrinsics and memcpy.
+
+
+namespace {
+
+  __m256i blend8(__m256i px, __m256i bg16) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i c128 = _mm256_set1_epi16(128);
+
+    // unpack works on the 128 bit lanes separately, packus restores the order
+    __m256i res[2];
+    const __m256i halves[2] = { _mm256_unpacklo_epi8(px, zero), _mm256_unpackhi_epi8(px, zero) };
+    for (int i = 0; i < 2; ++i) {
+      const __m256i p = halves[i];
+      const __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, 0xFF), 0xFF);
+      __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(p, a), _mm256_mullo_epi16(bg16, _mm256_sub_epi16(c255, a)));
+      x = _mm256_add_epi16(x, c128);
+      res[i] = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    }
+    return _mm256_packus_epi16(res[0], res[1]);
+  }
+
+  /// @brief RGBX pixels in 32 bit lanes to RGB565 values in 32 bit lanes, sign extended for _mm256_packs_epi32
+  __m256i to565(__m256i v, bool swap) {
+    const __m256i r = _mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xF8)), 8);
+    const __m256i g = _mm256_srli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xFC00)), 5);
+    const __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 19), _mm256_set1_epi32(0x1F));
+    __m256i x = _mm256_or_si256(_mm256_or_si256(r, g), b);
+    if (swap) {
+      x = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(x, _mm256_set1_epi32(0xFF)), 8),
+                          _mm256_srli_epi32(x, 8));
+    }
+    return _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+  }
+
+  __m256i background16(const uint8_t* bg) {
+    return _mm256_set_epi16(0, bg[2], bg[1], bg[0], 0, bg[2], bg[1], bg[0], 0, bg[2], bg[1], bg[0], 0, bg[2], bg[1],
+                            bg[0]);
+  }
+
+}  // namespace
+
+
+size_t Pixels::AVX2::blend_rgb565(const uint8_t* rgba, size_t n, const uint8_t* bg, bool swap, uint8_t* dst) {
+  const __m256i bg16 = background16(bg);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m256i lo = blend8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + 4 * i)), bg16);
+    const __m256i hi = blend8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + 4 * i + 32)), bg16);
+    const __m256i packed = _mm256_packs_epi32(to565(lo, swap), to565(hi, swap));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+  return i;
+}
+
+size_t Pixels::AVX2::blend_rgb888(const uint8_t* rgba, size_t n, const uint8_t* bg, uint8_t* dst) {
+  const __m256i bg16 = background16(bg);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    alignas(32) uint8_t blended[32];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(blended),
+                       blend8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + 4 * i)), bg16));
+    for (int k = 0; k < 8; ++k) {
+      std::memcpy(dst + 3 * (i + k), blended + 4 * k, 3);
+    }
+  }
+  return i;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+/// @brief AVX2 kernels of Pixels, compiled with AVX2 enabled in their own translation unit. Only call them after
+/// checking the CPU, see pixel_convert.cpp. Each converts whole blocks of pixels and leaves the rest to the caller
+namespace Pixels::AVX2 {
+
+  /// @param bg background, r g b
+  /// @return pixels converted
+  size_t blend_rgb565(const uint8_t* rgba, size_t n, const uint8_t* bg, bool swap, uint8_t* dst);
+
+  /// @param bg background, r g b
+  /// @return pixels converted
+  size_t blend_rgb888(const uint8_t* rgba, size_t n, const uint8_t* bg, uint8_t* dst);
+
+};  // namespace Pixels::AVX2
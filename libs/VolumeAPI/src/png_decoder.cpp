@@ -0,0 +1,319 @@
+#include "png_decoder.h"
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace {
+
+  constexpr uint16_t len_base[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+  constexpr uint8_t len_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  constexpr uint16_t dist_base[30] = { 1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                       33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+  constexpr uint8_t dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+  constexpr uint8_t cl_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+
+  /// @brief Reads a deflate bit stream, least significant bit first
+  class BitReader {
+  public:
+    BitReader(const uint8_t* data, size_t len) : data_(data), len_(len) {
+    }
+
+    /// @brief read @p count bits
+    /// @return false at the end of the stream
+    bool get(unsigned count, uint32_t& out) {
+      while (n_bits_ < count) {
+        if (pos_ >= len_) return false;
+        acc_ |= static_cast<uint64_t>(data_[pos_++]) << n_bits_;
+        n_bits_ += 8;
+      }
+      out = static_cast<uint32_t>(acc_ & ((1ull << count) - 1));
+      acc_ >>= count;
+      n_bits_ -= count;
+      return true;
+    }
+
+    /// @brief skip to the next byte boundary
+    void align() {
+      acc_ >>= n_bits_ % 8;
+      n_bits_ -= n_bits_ % 8;
+    }
+
+  private:
+    const uint8_t* data_;
+    size_t len_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;
+    unsigned n_bits_ = 0;
+  };
+
+
+  /// @brief Canonical huffman code, decoded one bit at a time
+  struct Huffman {
+    uint16_t count_[16] = {};  ///< number of codes of each length
+    uint16_t symbol_[288] = {};
+
+    /// @return false if the code is over-subscribed
+    bool build(const uint8_t* lengths, unsigned n) {
+      for (unsigned i = 0; i < n; ++i) ++count_[lengths[i]];
+      count_[0] = 0;
+
+      int left = 1;
+      for (unsigned len = 1; len < 16; ++len) {
+        left = (left << 1) - count_[len];
+        if (left < 0) return false;
+      }
+
+      uint16_t offs[16] = {};
+      for (unsigned len = 1; len < 15; ++len) offs[len + 1] = offs[len] + count_[len];
+      for (unsigned i = 0; i < n; ++i) {
+        if (lengths[i]) symbol_[offs[lengths[i]]++] = static_cast<uint16_t>(i);
+      }
+      return true;
+    }
+
+    /// @return the symbol, -1 on error
+    int decode(BitReader& br) const {
+      int code = 0, first = 0, index = 0;
+      for (unsigned len = 1; len < 16; ++len) {
+        uint32_t bit;
+        if (not br.get(1, bit)) return -1;
+        code |= bit;
+        const int count = count_[len];
+        if (code - count < first) return symbol_[index + (code - first)];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+      }
+      return -1;
+    }
+  };
+
+
+  bool inflate_codes(BitReader& br, std::vector<uint8_t>& out, const Huffman& lit, const Huffman& dist) {
+    for (;;) {
+      const int sym = lit.decode(br);
+      if (sym < 0 || sym > 285) return false;
+      if (sym < 256) {
+        out.push_back(static_cast<uint8_t>(sym));
+        continue;
+      }
+      if (sym == 256) return true;
+
+      uint32_t extra;
+      if (not br.get(len_extra[sym - 257], extra)) return false;
+      const size_t len = len_base[sym - 257] + extra;
+
+      const int dsym = dist.decode(br);
+      if (dsym < 0 || dsym > 29 || not br.get(dist_extra[dsym], extra)) return false;
+      const size_t d = dist_base[dsym] + extra;
+      if (d > out.size()) return false;
+
+      const size_t from = out.size() - d;
+      for (size_t i = 0; i < len; ++i) out.push_back(out[from + i]);
+    }
+  }
+
+  bool inflate_dynamic(BitReader& br, std::vector<uint8_t>& out) {
+    uint32_t n_lit, n_dist, n_cl;
+    if (not br.get(5, n_lit) || not br.get(5, n_dist) || not br.get(4, n_cl)) return false;
+    n_lit += 257;
+    n_dist += 1;
+    n_cl += 4;
+
+    uint8_t lengths[320] = {};
+    for (unsigned i = 0; i < n_cl; ++i) {
+      uint32_t l;
+      if (not br.get(3, l)) return false;
+      lengths[cl_order[i]] = static_cast<uint8_t>(l);
+    }
+    Huffman cl;
+    if (not cl.build(lengths, 19)) return false;
+
+    for (unsigned i = 0; i < n_lit + n_dist;) {
+      const int sym = cl.decode(br);
+      if (sym < 0) return false;
+      if (sym < 16) {
+        lengths[i++] = static_cast<uint8_t>(sym);
+        continue;
+      }
+      uint8_t val = 0;
+      uint32_t rep;
+      if (sym == 16) {
+        if (i == 0 || not br.get(2, rep)) return false;
+        val = lengths[i - 1];
+        rep += 3;
+      } else if (sym == 17) {
+        if (not br.get(3, rep)) return false;
+        rep += 3;
+      } else {
+        if (not br.get(7, rep)) return false;
+        rep += 11;
+      }
+      if (i + rep > n_lit + n_dist) return false;
+      while (rep--) lengths[i++] = val;
+    }
+
+    Huffman lit, dist;
+    if (not lit.build(lengths, n_lit) || not dist.build(lengths + n_lit, n_dist)) return false;
+    return inflate_codes(br, out, lit, dist);
+  }
+
+  bool inflate_fixed(BitReader& br, std::vector<uint8_t>& out) {
+    uint8_t lengths[288 + 30];
+    for (unsigned i = 0; i < 144; ++i) lengths[i] = 8;
+    for (unsigned i = 144; i < 256; ++i) lengths[i] = 9;
+    for (unsigned i = 256; i < 280; ++i) lengths[i] = 7;
+    for (unsigned i = 280; i < 288; ++i) lengths[i] = 8;
+    for (unsigned i = 288; i < 288 + 30; ++i) lengths[i] = 5;
+
+    Huffman lit, dist;
+    lit.build(lengths, 288);
+    dist.build(lengths + 288, 30);
+    return inflate_codes(br, out, lit, dist);
+  }
+
+  bool inflate_stored(BitReader& br, std::vector<uint8_t>& out) {
+    br.align();
+    uint32_t len, nlen;
+    if (not br.get(16, len) || not br.get(16, nlen) || len != (~nlen & 0xFFFF)) return false;
+    for (uint32_t i = 0; i < len; ++i) {
+      uint32_t b;
+      if (not br.get(8, b)) return false;
+      out.push_back(static_cast<uint8_t>(b));
+    }
+    return true;
+  }
+
+
+  uint32_t get_be32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+  }
+
+}  // namespace
+
+
+bool PNG::zlib_decompress(const uint8_t* data, size_t len, std::vector<uint8_t>& out) {
+  // deflate method, no preset dictionary
+  if (len < 2 || (data[0] & 0x0F) != 8 || (data[1] & 0x20) || ((data[0] << 8) | data[1]) % 31) {
+    return false;
+  }
+
+  BitReader br(data + 2, len - 2);
+  for (uint32_t last = 0; not last;) {
+    uint32_t type;
+    if (not br.get(1, last) || not br.get(2, type)) return false;
+    bool ok = false;
+    switch (type) {
+      case 0:
+        ok = inflate_stored(br, out);
+        break;
+      case 1:
+        ok = inflate_fixed(br, out);
+        break;
+      case 2:
+        ok = inflate_dynamic(br, out);
+        break;
+      default:
+        break;
+    }
+    if (not ok) return false;
+  }
+  return true;
+}
+
+bool PNG::decode(const uint8_t* png, size_t len, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height) {
+  static constexpr uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  if (len < sizeof(signature) || not std::equal(signature, signature + sizeof(signature), png)) {
+    return false;
+  }
+
+  unsigned channels = 0;
+  std::vector<uint8_t> idat;
+  for (size_t pos = sizeof(signature); pos + 12 <= len;) {
+    const uint32_t chunk_len = get_be32(png + pos);
+    const uint8_t* type = png + pos + 4;
+    const uint8_t* body = png + pos + 8;
+    if (chunk_len > len - pos - 12) {
+      return false;
+    }
+
+    if (std::equal(type, type + 4, "IHDR")) {
+      if (chunk_len < 13) return false;
+      width = get_be32(body);
+      height = get_be32(body + 4);
+      const uint8_t depth = body[8], color = body[9], interlace = body[12];
+      if (depth != 8 || interlace != 0 || (color != 2 && color != 6)) {
+        return false;
+      }
+      channels = color == 6 ? 4 : 3;
+    } else if (std::equal(type, type + 4, "IDAT")) {
+      idat.insert(idat.end(), body, body + chunk_len);
+    } else if (std::equal(type, type + 4, "IEND")) {
+      break;
+    }
+    pos += 12 + chunk_len;
+  }
+  if (channels == 0 || width == 0 || height == 0 || width > 4096 || height > 4096) {
+    return false;
+  }
+
+  std::vector<uint8_t> raw;
+  const size_t stride = static_cast<size_t>(width) * channels;
+  raw.reserve((stride + 1) * height);
+  if (not zlib_decompress(idat.data(), idat.size(), raw) || raw.size() < (stride + 1) * height) {
+    return false;
+  }
+
+  // undo the filters in place
+  for (uint32_t y = 0; y < height; ++y) {
+    uint8_t* row = raw.data() + y * (stride + 1) + 1;
+    const uint8_t* prev = y ? row - stride - 1 : nullptr;
+    const uint8_t type = row[-1];
+    for (size_t i = 0; i < stride; ++i) {
+      const int a = i >= channels ? row[i - channels] : 0;
+      const int b = prev ? prev[i] : 0;
+      const int c = (prev && i >= channels) ? prev[i - channels] : 0;
+      int pred = 0;
+      switch (type) {
+        case 0:
+          break;
+        case 1:
+          pred = a;
+          break;
+        case 2:
+          pred = b;
+          break;
+        case 3:
+          pred = (a + b) / 2;
+          break;
+        case 4: {
+          const int p = a + b - c;
+          const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+          pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        } break;
+        default:
+          return false;
+      }
+      row[i] = static_cast<uint8_t>(row[i] + pred);
+    }
+  }
+
+  rgba.resize(static_cast<size_t>(width) * height * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* src = raw.data() + y * (stride + 1) + 1;
+    uint8_t* dst = rgba.data() + static_cast<size_t>(y) * width * 4;
+    for (uint32_t x = 0; x < width; ++x) {
+      dst[4 * x + 0] = src[channels * x + 0];
+      dst[4 * x + 1] = src[channels * x + 1];
+      dst[4 * x + 2] = src[channels * x + 2];
+      dst[4 * x + 3] = channels == 4 ? src[channels * x + 3] : 255;
+    }
+  }
+  return true;
+}
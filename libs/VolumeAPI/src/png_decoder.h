@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace PNG {
+
+  /// @brief Decode a non-interlaced, 8 bit RGB or RGBA PNG, like the ones produced by PNG::encode
+  /// @param png the PNG file contents
+  /// @param len length of @p png
+  /// @param rgba output pixels, 4 bytes per pixel, top-down rows, non-premultiplied alpha
+  /// @param width output width
+  /// @param height output height
+  /// @return true on success
+  bool decode(const uint8_t* png, size_t len, std::vector<uint8_t>& rgba, uint32_t& width, uint32_t& height);
+
+  /// @brief decompress a zlib stream
+  /// @return true on success
+  bool zlib_decompress(const uint8_t* data, size_t len, std::vector<uint8_t>& out);
+
+};  // namespace PNG
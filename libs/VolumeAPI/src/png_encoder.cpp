@@ -0,0 +1,494 @@
+#include "png_encoder.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <queue>
+
+
+namespace {
+
+  /// @brief Writes a deflate bit stream, least significant bit first
+  class BitWriter {
+  public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {
+    }
+
+    void put(uint32_t bits, unsigned count) {
+      acc_ |= static_cast<uint64_t>(bits) << n_bits_;
+      n_bits_ += count;
+      while (n_bits_ >= 8) {
+        out_.push_back(static_cast<uint8_t>(acc_));
+        acc_ >>= 8;
+        n_bits_ -= 8;
+      }
+    }
+
+    /// @brief write a huffman code, these are stored most significant bit first
+    void put_code(uint32_t code, unsigned len) {
+      uint32_t rev = 0;
+      for (unsigned i = 0; i < len; ++i) {
+        rev = (rev << 1) | ((code >> i) & 1);
+      }
+      put(rev, len);
+    }
+
+    void flush() {
+      if (n_bits_) {
+        out_.push_back(static_cast<uint8_t>(acc_));
+      }
+      acc_ = 0;
+      n_bits_ = 0;
+    }
+
+  private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    unsigned n_bits_ = 0;
+  };
+
+
+  constexpr unsigned num_lit_codes = 286;
+  constexpr unsigned num_dist_codes = 30;
+  constexpr unsigned num_cl_codes = 19;
+  constexpr unsigned end_of_block = 256;
+
+  constexpr uint16_t len_base[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+  constexpr uint8_t len_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+  constexpr uint16_t dist_base[30] = { 1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                       193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+  constexpr uint8_t dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+  constexpr uint8_t cl_order[num_cl_codes] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+
+  /// @brief A literal (dist_ == 0) or a back reference
+  struct Token {
+    uint16_t len_;  ///< literal byte or match length
+    uint16_t dist_;
+  };
+
+  unsigned len_code(unsigned len) {
+    unsigned i = 0;
+    while (i < 28 && len_base[i + 1] <= len) ++i;
+    return i;
+  }
+
+  unsigned dist_code(unsigned dist) {
+    unsigned i = 0;
+    while (i < 29 && dist_base[i + 1] <= dist) ++i;
+    return i;
+  }
+
+
+  /// @brief LZ77 with hash chains over a 32K window
+  std::vector<Token> lz77(const uint8_t* data, size_t len) {
+    constexpr size_t window = 32768;
+    constexpr size_t hash_size = 1 << 15;
+    constexpr unsigned max_chain = 128;
+    constexpr unsigned min_match = 3;
+    constexpr unsigned max_match = 258;
+
+    std::vector<Token> tokens;
+    tokens.reserve(len / 2 + 16);
+    std::vector<int32_t> head(hash_size, -1);
+    std::vector<int32_t> prev(window, -1);
+
+    auto hash = [data](size_t i) {
+      return ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & (hash_size - 1);
+    };
+    auto insert = [&](size_t i) {
+      if (i + min_match > len) return;
+      const auto h = hash(i);
+      prev[i % window] = head[h];
+      head[h] = static_cast<int32_t>(i);
+    };
+
+    for (size_t i = 0; i < len;) {
+      unsigned best_len = 0;
+      size_t best_dist = 0;
+
+      if (i + min_match <= len) {
+        const size_t limit = std::min<size_t>(max_match, len - i);
+        int32_t candidate = head[hash(i)];
+        for (unsigned chain = 0; candidate >= 0 && chain < max_chain; ++chain) {
+          const size_t dist = i - candidate;
+          if (dist > window) break;
+          unsigned l = 0;
+          while (l < limit && data[candidate + l] == data[i + l]) ++l;
+          if (l > best_len) {
+            best_len = l;
+            best_dist = dist;
+            if (l == limit) break;
+          }
+          const int32_t next = prev[candidate % window];
+          if (next >= candidate) break;  // slot was overwritten by a newer position
+          candidate = next;
+        }
+      }
+
+      if (best_len >= min_match) {
+        tokens.push_back({ static_cast<uint16_t>(best_len), static_cast<uint16_t>(best_dist) });
+        for (unsigned k = 0; k < best_len; ++k) insert(i + k);
+        i += best_len;
+      } else {
+        tokens.push_back({ data[i], 0 });
+        insert(i);
+        ++i;
+      }
+    }
+    return tokens;
+  }
+
+
+  /// @brief Compute huffman code lengths for @p freqs, limited to @p max_len bits
+  std::vector<uint8_t> huffman_lengths(std::vector<uint32_t> freqs, unsigned max_len) {
+    const size_t n = freqs.size();
+    std::vector<uint8_t> lengths(n, 0);
+
+    // deflate decoders need a complete code, so always use at least 2 symbols
+    size_t used = std::count_if(freqs.begin(), freqs.end(), [](uint32_t f) { return f != 0; });
+    for (size_t i = 0; used < 2 && i < n; ++i) {
+      if (freqs[i] == 0) {
+        freqs[i] = 1;
+        ++used;
+      }
+    }
+
+    for (;;) {
+      struct Node {
+        uint32_t freq_;
+        int left_, right_;
+      };
+      std::vector<Node> nodes;
+      using item_t = std::pair<uint32_t, int>;
+      std::priority_queue<item_t, std::vector<item_t>, std::greater<item_t>> queue;
+      for (size_t i = 0; i < n; ++i) {
+        if (freqs[i]) {
+          nodes.push_back({ freqs[i], -1, static_cast<int>(i) });
+          queue.push({ freqs[i], static_cast<int>(nodes.size() - 1) });
+        }
+      }
+      while (queue.size() > 1) {
+        const auto a = queue.top();
+        queue.pop();
+        const auto b = queue.top();
+        queue.pop();
+        nodes.push_back({ a.first + b.first, a.second, b.second });
+        queue.push({ a.first + b.first, static_cast<int>(nodes.size() - 1) });
+      }
+
+      // walk the tree, leaves have left_ == -1 and the symbol in right_
+      unsigned longest = 0;
+      std::vector<std::pair<int, unsigned>> stack{ { queue.top().second, 0u } };
+      while (not stack.empty()) {
+        const auto [idx, depth] = stack.back();
+        stack.pop_back();
+        if (nodes[idx].left_ < 0) {
+          lengths[nodes[idx].right_] = static_cast<uint8_t>(depth);
+          longest = std::max(longest, depth);
+        } else {
+          stack.push_back({ nodes[idx].left_, depth + 1 });
+          stack.push_back({ nodes[idx].right_, depth + 1 });
+        }
+      }
+
+      if (longest <= max_len) {
+        return lengths;
+      }
+      // too deep, flatten the distribution and try again
+      for (auto& f : freqs) {
+        if (f) f = (f >> 1) | 1;
+      }
+    }
+  }
+
+  /// @brief Canonical huffman codes from code lengths
+  std::vector<uint16_t> huffman_codes(const std::vector<uint8_t>& lengths) {
+    uint16_t bl_count[16] = {};
+    for (const auto l : lengths) ++bl_count[l];
+    bl_count[0] = 0;
+
+    uint16_t next_code[16] = {};
+    uint16_t code = 0;
+    for (unsigned bits = 1; bits < 16; ++bits) {
+      code = (code + bl_count[bits - 1]) << 1;
+      next_code[bits] = code;
+    }
+
+    std::vector<uint16_t> codes(lengths.size(), 0);
+    for (size_t i = 0; i < lengths.size(); ++i) {
+      if (lengths[i]) codes[i] = next_code[lengths[i]]++;
+    }
+    return codes;
+  }
+
+  /// @brief Run length encode the code lengths of a dynamic block header
+  /// @return pairs of code length symbol and its extra bits
+  std::vector<std::pair<uint8_t, uint8_t>> rle_lengths(const std::vector<uint8_t>& lengths) {
+    std::vector<std::pair<uint8_t, uint8_t>> out;
+    for (size_t i = 0; i < lengths.size();) {
+      const uint8_t l = lengths[i];
+      size_t run = 1;
+      while (i + run < lengths.size() && lengths[i + run] == l) ++run;
+
+      if (l == 0 && run >= 3) {
+        const size_t n = std::min<size_t>(run, 138);
+        if (n >= 11) {
+          out.push_back({ 18, static_cast<uint8_t>(n - 11) });
+        } else {
+          out.push_back({ 17, static_cast<uint8_t>(n - 3) });
+        }
+        i += n;
+      } else if (l != 0 && run >= 4) {
+        out.push_back({ l, 0 });
+        const size_t n = std::min<size_t>(run - 1, 6);
+        out.push_back({ 16, static_cast<uint8_t>(n - 3) });
+        i += n + 1;
+      } else {
+        out.push_back({ l, 0 });
+        ++i;
+      }
+    }
+    return out;
+  }
+
+
+  void write_tokens(BitWriter& bw, const std::vector<Token>& tokens, const std::vector<uint8_t>& lit_len,
+                    const std::vector<uint16_t>& lit_code, const std::vector<uint8_t>& dist_len,
+                    const std::vector<uint16_t>& d_code) {
+    for (const auto& t : tokens) {
+      if (t.dist_ == 0) {
+        bw.put_code(lit_code[t.len_], lit_len[t.len_]);
+        continue;
+      }
+      const unsigned lc = len_code(t.len_);
+      bw.put_code(lit_code[257 + lc], lit_len[257 + lc]);
+      bw.put(t.len_ - len_base[lc], len_extra[lc]);
+      const unsigned dc = dist_code(t.dist_);
+      bw.put_code(d_code[dc], dist_len[dc]);
+      bw.put(t.dist_ - dist_base[dc], dist_extra[dc]);
+    }
+    bw.put_code(lit_code[end_of_block], lit_len[end_of_block]);
+  }
+
+  size_t tokens_cost(const std::vector<uint32_t>& lit_freq, const std::vector<uint32_t>& dist_freq,
+                     const std::vector<uint8_t>& lit_len, const std::vector<uint8_t>& dist_len) {
+    size_t bits = 0;
+    for (unsigned i = 0; i < num_lit_codes; ++i) {
+      bits += static_cast<size_t>(lit_freq[i]) * (lit_len[i] + (i > 256 ? len_extra[i - 257] : 0));
+    }
+    for (unsigned i = 0; i < num_dist_codes; ++i) {
+      bits += static_cast<size_t>(dist_freq[i]) * (dist_len[i] + dist_extra[i]);
+    }
+    return bits;
+  }
+
+
+  /// @brief Emit @p data as a single deflate block, fixed or dynamic huffman, whichever is smaller
+  void deflate(const uint8_t* data, size_t len, std::vector<uint8_t>& out) {
+    const auto tokens = lz77(data, len);
+
+    std::vector<uint32_t> lit_freq(num_lit_codes, 0);
+    std::vector<uint32_t> dist_freq(num_dist_codes, 0);
+    for (const auto& t : tokens) {
+      if (t.dist_ == 0) {
+        ++lit_freq[t.len_];
+      } else {
+        ++lit_freq[257 + len_code(t.len_)];
+        ++dist_freq[dist_code(t.dist_)];
+      }
+    }
+    lit_freq[end_of_block] = 1;
+
+    // fixed codes, RFC 1951 3.2.6
+    std::vector<uint8_t> fixed_lit(288, 8);
+    std::fill(fixed_lit.begin() + 144, fixed_lit.begin() + 256, 9);
+    std::fill(fixed_lit.begin() + 256, fixed_lit.begin() + 280, 7);
+    const std::vector<uint8_t> fixed_dist(num_dist_codes, 5);
+    const size_t fixed_cost = tokens_cost(lit_freq, dist_freq, fixed_lit, fixed_dist);
+
+    // dynamic codes
+    const auto lit_len = huffman_lengths(lit_freq, 15);
+    const auto dist_len = huffman_lengths(dist_freq, 15);
+
+    size_t n_lit = num_lit_codes;
+    while (n_lit > 257 && lit_len[n_lit - 1] == 0) --n_lit;
+    size_t n_dist = num_dist_codes;
+    while (n_dist > 1 && dist_len[n_dist - 1] == 0) --n_dist;
+
+    std::vector<uint8_t> all_lengths(lit_len.begin(), lit_len.begin() + n_lit);
+    all_lengths.insert(all_lengths.end(), dist_len.begin(), dist_len.begin() + n_dist);
+    const auto rle = rle_lengths(all_lengths);
+
+    std::vector<uint32_t> cl_freq(num_cl_codes, 0);
+    for (const auto& [sym, extra] : rle) ++cl_freq[sym];
+    const auto cl_len = huffman_lengths(cl_freq, 7);
+    const auto cl_code = huffman_codes(cl_len);
+
+    size_t n_cl = num_cl_codes;
+    while (n_cl > 4 && cl_len[cl_order[n_cl - 1]] == 0) --n_cl;
+
+    size_t dynamic_cost = 14 + 3 * n_cl + tokens_cost(lit_freq, dist_freq, lit_len, dist_len);
+    for (const auto& [sym, extra] : rle) {
+      dynamic_cost += cl_len[sym] + (sym == 16 ? 2 : sym == 17 ? 3 : sym == 18 ? 7 : 0);
+    }
+
+    BitWriter bw(out);
+    bw.put(1, 1);  // BFINAL
+    if (fixed_cost <= dynamic_cost) {
+      bw.put(1, 2);  // BTYPE fixed
+      write_tokens(bw, tokens, fixed_lit, huffman_codes(fixed_lit), fixed_dist, huffman_codes(fixed_dist));
+    } else {
+      bw.put(2, 2);  // BTYPE dynamic
+      bw.put(static_cast<uint32_t>(n_lit - 257), 5);
+      bw.put(static_cast<uint32_t>(n_dist - 1), 5);
+      bw.put(static_cast<uint32_t>(n_cl - 4), 4);
+      for (size_t i = 0; i < n_cl; ++i) {
+        bw.put(cl_len[cl_order[i]], 3);
+      }
+      for (const auto& [sym, extra] : rle) {
+        bw.put_code(cl_code[sym], cl_len[sym]);
+        if (sym == 16) bw.put(extra, 2);
+        if (sym == 17) bw.put(extra, 3);
+        if (sym == 18) bw.put(extra, 7);
+      }
+      write_tokens(bw, tokens, lit_len, huffman_codes(lit_len), dist_len, huffman_codes(dist_len));
+    }
+    bw.flush();
+  }
+
+
+  uint32_t adler32(const uint8_t* data, size_t len) {
+    constexpr uint32_t mod = 65521;
+    uint32_t a = 1, b = 0;
+    while (len) {
+      // 5552 is the largest block, where the sums can't overflow
+      const size_t block = std::min<size_t>(len, 5552);
+      for (size_t i = 0; i < block; ++i) {
+        a += data[i];
+        b += a;
+      }
+      a %= mod;
+      b %= mod;
+      data += block;
+      len -= block;
+    }
+    return (b << 16) | a;
+  }
+
+  constexpr std::array<uint32_t, 256> crc_table = [] {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    return table;
+  }();
+
+
+  void put_be32(std::vector<uint8_t>& out, uint32_t val) {
+    out.push_back(static_cast<uint8_t>(val >> 24));
+    out.push_back(static_cast<uint8_t>(val >> 16));
+    out.push_back(static_cast<uint8_t>(val >> 8));
+    out.push_back(static_cast<uint8_t>(val));
+  }
+
+  void put_chunk(std::vector<uint8_t>& out, const char (&type)[5], const std::vector<uint8_t>& data) {
+    put_be32(out, static_cast<uint32_t>(data.size()));
+    const size_t crc_start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_be32(out, PNG::crc32(out.data() + crc_start, out.size() - crc_start));
+  }
+
+
+  /// @brief Apply PNG filter @p type to one row
+  void filter_row(uint8_t type, const uint8_t* row, const uint8_t* prev, size_t len, uint8_t* out) {
+    constexpr size_t bpp = 4;
+    for (size_t i = 0; i < len; ++i) {
+      const int a = i >= bpp ? row[i - bpp] : 0;
+      const int b = prev ? prev[i] : 0;
+      const int c = (prev && i >= bpp) ? prev[i - bpp] : 0;
+      int pred = 0;
+      switch (type) {
+        case 1:
+          pred = a;
+          break;
+        case 2:
+          pred = b;
+          break;
+        case 3:
+          pred = (a + b) / 2;
+          break;
+        case 4: {
+          const int p = a + b - c;
+          const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+          pred = (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        } break;
+        default:
+          break;
+      }
+      out[i] = static_cast<uint8_t>(row[i] - pred);
+    }
+  }
+
+}  // namespace
+
+
+uint32_t PNG::crc32(const void* buffer, size_t len, uint32_t crc) {
+  const uint8_t* buf = reinterpret_cast<const uint8_t*>(buffer);
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = crc_table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+std::vector<uint8_t> PNG::zlib_compress(const uint8_t* data, size_t len) {
+  std::vector<uint8_t> out = { 0x78, 0x9C };  // deflate, 32K window, default level
+  deflate(data, len, out);
+  const uint32_t adler = adler32(data, len);
+  put_be32(out, adler);
+  return out;
+}
+
+std::vector<uint8_t> PNG::encode(const uint8_t* rgba, uint32_t width, uint32_t height) {
+  const size_t stride = static_cast<size_t>(width) * 4;
+
+  // pick the filter with the smallest sum of absolute differences for each row
+  std::vector<uint8_t> filtered((stride + 1) * height);
+  std::vector<uint8_t> candidate(stride);
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t* row = rgba + y * stride;
+    const uint8_t* prev = y ? row - stride : nullptr;
+    uint8_t* out = filtered.data() + y * (stride + 1);
+
+    uint64_t best_score = UINT64_MAX;
+    for (uint8_t type = 0; type < 5; ++type) {
+      filter_row(type, row, prev, stride, candidate.data());
+      uint64_t score = 0;
+      for (const uint8_t v : candidate) score += v < 128 ? v : 256 - v;
+      if (score < best_score) {
+        best_score = score;
+        out[0] = type;
+        std::copy(candidate.begin(), candidate.end(), out + 1);
+      }
+    }
+  }
+
+  std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+  std::vector<uint8_t> ihdr;
+  put_be32(ihdr, width);
+  put_be32(ihdr, height);
+  ihdr.insert(ihdr.end(), { 8, 6, 0, 0, 0 });  // 8 bit depth, RGBA, deflate, adaptive filter, no interlace
+  put_chunk(png, "IHDR", ihdr);
+  put_chunk(png, "IDAT", zlib_compress(filtered.data(), filtered.size()));
+  put_chunk(png, "IEND", {});
+
+  return png;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace PNG {
+
+  /// @brief Encode an image to PNG in memory
+  /// @param rgba pixels, 4 bytes per pixel, top-down rows, non-premultiplied alpha
+  /// @param width width of the image in pixels
+  /// @param height height of the image in pixels
+  /// @return the PNG file contents
+  [[nodiscard]] std::vector<uint8_t> encode(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+  /// @brief compress @p data into a zlib stream
+  [[nodiscard]] std::vector<uint8_t> zlib_compress(const uint8_t* data, size_t len);
+
+  /// @brief the CRC used by PNG chunks and zip
+  uint32_t crc32(const void* buffer, size_t len, uint32_t crc = 0);
+
+};  // namespace PNG
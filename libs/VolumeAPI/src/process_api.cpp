@@ -4,10 +4,8 @@
 #include <Psapi.h>
 #include <filesystem>
 #include <memory>
-#include <locale>
-#include <codecvt>
-#include <fstream>
-#include "special_icons.h"
+#include "ico_decoder.h"
+#include "png_encoder.h"
 
 struct ICONDIRENTRY {
   UCHAR nWidth;
@@ -161,75 +159,106 @@ std::wstring ProcessAPI::get_path_from_pid(int pid) {
 }
 
 
-static std::vector<uint8_t> get_process_icon_from_pid(int pid) {
-  std::wstring path = ProcessAPI::get_path_from_pid(pid);
-
-  UINT num_icons = ExtractIconEx(path.c_str(), -1, NULL, NULL, 0);
-
-  std::vector<uint8_t> out;
-  if (num_icons) {
-    HICON ilarge{};
-    ExtractIconEx(path.c_str(), 0, &ilarge, NULL, 1);
-    GetIconData(ilarge, 32, out);
-    DestroyIcon(ilarge);
+uint64_t ProcessAPI::get_start_time_from_pid(int pid) {
+  HANDLE process_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (process_handle == NULL) {
+    return 0;
   }
 
-  return out;
+  FILETIME creation{}, exit_time{}, kernel{}, user{};
+  uint64_t start_time = 0;
+  if (GetProcessTimes(process_handle, &creation, &exit_time, &kernel, &user)) {
+    start_time = (static_cast<uint64_t>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+  }
+  CloseHandle(process_handle);
+  return start_time;
 }
 
-static std::vector<uint8_t> get_process_png_from_pid(int pid) {
-  // get .ico data
-  const auto ico_data = get_process_icon_from_pid(pid);
 
-  // get temp directory path
-  namespace fs = std::filesystem;
-  const auto temp_dir = fs::temp_directory_path();
+/// @brief Layout of SYSTEM_PROCESS_INFORMATION, winternl.h hides the fields we need in Reserved members
+struct SYSTEM_PROCESS_INFO {
+  ULONG NextEntryOffset;
+  ULONG NumberOfThreads;
+  LARGE_INTEGER WorkingSetPrivateSize;
+  ULONG HardFaultCount;
+  ULONG NumberOfThreadsHighWatermark;
+  ULONGLONG CycleTime;
+  LARGE_INTEGER CreateTime;  // same value as the creation time from GetProcessTimes
+  LARGE_INTEGER UserTime;
+  LARGE_INTEGER KernelTime;
+  struct {
+    USHORT Length;
+    USHORT MaximumLength;
+    PWSTR Buffer;
+  } ImageName;
+  LONG BasePriority;
+  HANDLE UniqueProcessId;
+};
+
+typedef LONG(WINAPI* FN_NtQuerySystemInformation)(ULONG SystemInformationClass, PVOID SystemInformation,
+                                                  ULONG SystemInformationLength, PULONG ReturnLength);
+
+std::vector<ProcessAPI::ProcessKey> ProcessAPI::get_process_snapshot() {
+  constexpr ULONG system_process_information = 5;
+  constexpr LONG status_info_length_mismatch = static_cast<LONG>(0xC0000004);
 
-  // create unique files with needed extensions
-  const auto ico_path = temp_dir / L"VOL001.ico";
-  const auto png_path = temp_dir / L"VOL001.png";
+  static const auto query = reinterpret_cast<FN_NtQuerySystemInformation>(
+      GetProcAddress(GetModuleHandle(L"ntdll.dll"), "NtQuerySystemInformation"));
 
+  std::vector<ProcessKey> ret;
+  if (query == NULL) {
+    return ret;
+  }
 
-  // write .ico file to temp
-  std::ofstream ico_file(ico_path, std::ios::out | std::ios::binary);
-  for (const auto val : ico_data) {
-    ico_file << val;
+  // the table can grow between two calls, keep some headroom
+  std::vector<uint8_t> buff(256 * 1024);
+  ULONG needed = 0;
+  LONG status = 0;
+  while ((status = query(system_process_information, buff.data(), static_cast<ULONG>(buff.size()), &needed)) ==
+         status_info_length_mismatch) {
+    buff.resize(needed + 64 * 1024);
+  }
+  if (status < 0) {
+    return ret;
   }
-  ico_file.close();  // make sure to close before going further
 
-  // construct command to convert .ico to .png
-  std::wstring command;
-  command += L"magick ";
-  command += ico_path.wstring();
-  command += L" ";
-  command += png_path.wstring();
-  std::string cmd = std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t>().to_bytes(command);
+  for (size_t offset = 0;;) {
+    const auto* info = reinterpret_cast<const SYSTEM_PROCESS_INFO*>(buff.data() + offset);
+    ret.push_back({ static_cast<int>(reinterpret_cast<ULONG_PTR>(info->UniqueProcessId)),
+                    static_cast<uint64_t>(info->CreateTime.QuadPart) });
+    if (info->NextEntryOffset == 0) {
+      break;
+    }
+    offset += info->NextEntryOffset;
+  }
 
-  // call magick
-  std::system(cmd.c_str());
+  return ret;
+}
 
-  // read .png file
-  std::ifstream png_file(png_path, std::ios::in | std::ios::binary);
 
-  std::vector<uint8_t> png_data((std::istreambuf_iterator<char>(png_file)), std::istreambuf_iterator<char>());
+static std::vector<uint8_t> get_process_icon_from_path(const std::wstring& path) {
+  UINT num_icons = ExtractIconEx(path.c_str(), -1, NULL, NULL, 0);
 
-  png_file.close();
-  fs::remove(ico_path);
-  fs::remove(png_path);
+  std::vector<uint8_t> out;
+  if (num_icons) {
+    HICON ilarge{};
+    ExtractIconEx(path.c_str(), 0, &ilarge, NULL, 1);
+    GetIconData(ilarge, 32, out);
+    DestroyIcon(ilarge);
+  }
 
-  return png_data;
+  return out;
 }
 
+std::vector<uint8_t> ProcessAPI::extract_png_from_path(const std::wstring& path) {
+  // get .ico data
+  const auto ico_data = get_process_icon_from_path(path);
 
-std::vector<uint8_t> ProcessAPI::get_png_from_pid(int pid) {
-  if (pid == -1) {
-    // master icon
-    return std::vector<uint8_t>(icon_master.begin(), icon_master.end());
-  }
-  if (pid == 0) {
-    // system icon
-    return std::vector<uint8_t>(icon_system.begin(), icon_system.end());
+  std::vector<uint8_t> rgba;
+  uint32_t width = 0, height = 0;
+  if (not ICO::decode(ico_data.data(), ico_data.size(), rgba, width, height, ICO::Alpha::STRAIGHT)) {
+    return {};
   }
 
-  return get_process_png_from_pid(pid);
-}
\ No newline at end of file
+  return PNG::encode(rgba.data(), width, height);
+}
@@ -1,11 +1,61 @@
 #pragma once
+#include <cstdint>
+#include <filesystem>
 #include <string>
 #include <vector>
+#include "VolumeAPI/VolumeAPI.h"
 
 
 namespace ProcessAPI {
 
+  /// @brief Identifies one process instance. PIDs are reused by the OS, the start time tells the instances apart
+  struct ProcessKey {
+    int pid_;              ///< process ID
+    uint64_t start_time_;  ///< OS specific creation timestamp, 0 if unknown
+  };
+
   [[nodiscard]] std::wstring get_path_from_pid(int pid);
-  [[nodiscard]] std::vector<uint8_t> get_png_from_pid(int pid);
 
-};  // namespace ProcessAPI
\ No newline at end of file
+  /// @brief Get the creation time of @p pid
+  /// @return OS specific timestamp, 0 if the process can't be queried
+  [[nodiscard]] uint64_t get_start_time_from_pid(int pid);
+
+  /// @brief Read the whole process table in one go
+  /// @return PID and start time of every running process
+  [[nodiscard]] std::vector<ProcessKey> get_process_snapshot();
+
+  /// @brief Extract the icon of the executable at @p path and encode it to PNG
+  /// @return the PNG data, empty if the executable has no icon
+  [[nodiscard]] std::vector<uint8_t> extract_png_from_path(const std::wstring& path);
+
+  /// @brief Open the persistent icon cache, used by get_png_from_pid()
+  /// @param file path of the pack file
+  /// @param max_bytes size limit of the pack
+  /// @return true on success
+  bool open_icon_cache(const std::filesystem::path& file, uint64_t max_bytes);
+
+  /// @brief Get the PNG icon of @p pid, from the record of the process, or from the icon cache if possible
+  [[nodiscard]] VolumeControl::IconData get_png_from_pid(int pid);
+
+  /// @brief Get the PNG icon of the executable at @p path, from the icon cache if possible
+  [[nodiscard]] VolumeControl::IconData get_png_from_path(const std::wstring& path);
+
+  /// @brief Look up the hash of the cached PNG icon of @p path, nothing is extracted or encoded.
+  /// A missing icon is handed to prefetch_png()
+  /// @return the CRC-32 of the PNG, 0 if it isn't cached
+  [[nodiscard]] uint32_t find_png_hash(const std::wstring& path);
+
+  /// @brief Convert the PNG icon @p png to @p format. Decoding the PNG is cheap, compared to extracting the icon
+  /// @return the pixels, empty if @p png can't be decoded
+  [[nodiscard]] VolumeControl::IconData get_raw_from_png(const VolumeControl::IconData& png,
+                                                         const VolumeControl::RawIconFormat& format);
+
+  /// @brief Extract and cache the icon of @p path on a worker thread
+  void prefetch_png(const std::wstring& path);
+
+  /// @brief Enable or disable prefetch_png()
+  void set_prefetch(bool enable);
+
+  [[nodiscard]] VolumeControl::IconStats get_icon_stats();
+
+};  // namespace ProcessAPI
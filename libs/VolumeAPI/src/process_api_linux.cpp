@@ -0,0 +1,76 @@
+#include "process_api.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+
+/// @brief Read the start time of the process from /proc/<pid>/stat
+/// @return clock ticks since boot, 0 on failure
+static uint64_t read_start_time(const fs::path& proc_dir) {
+  std::ifstream stat_file(proc_dir / "stat");
+  std::string stat;
+  if (not std::getline(stat_file, stat)) {
+    return 0;
+  }
+
+  // the 2nd field is the executable name in parentheses, which may contain spaces
+  const auto name_end = stat.rfind(')');
+  if (name_end == std::string::npos) {
+    return 0;
+  }
+
+  // starttime is the 22nd field, the 20th after the name
+  std::istringstream fields(stat.substr(name_end + 1));
+  std::string field;
+  for (int i = 0; i < 20; ++i) {
+    if (not(fields >> field)) {
+      return 0;
+    }
+  }
+
+  try {
+    return std::stoull(field);
+  } catch (const std::exception&) {
+    return 0;
+  }
+}
+
+
+std::wstring ProcessAPI::get_path_from_pid(int pid) {
+  std::error_code ec;
+  const auto path = fs::read_symlink(fs::path("/proc") / std::to_string(pid) / "exe", ec);
+  if (ec) {
+    return {};
+  }
+  return path.wstring();
+}
+
+uint64_t ProcessAPI::get_start_time_from_pid(int pid) {
+  return read_start_time(fs::path("/proc") / std::to_string(pid));
+}
+
+std::vector<ProcessAPI::ProcessKey> ProcessAPI::get_process_snapshot() {
+  std::vector<ProcessKey> ret;
+  std::error_code ec;
+
+  for (const auto& entry : fs::directory_iterator("/proc", ec)) {
+    const std::string name = entry.path().filename().string();
+    if (name.empty() || name.find_first_not_of("0123456789") != std::string::npos) {
+      continue;
+    }
+    const uint64_t start_time = read_start_time(entry.path());
+    if (start_time) {
+      ret.push_back({ std::stoi(name), start_time });
+    }
+  }
+
+  return ret;
+}
+
+std::vector<uint8_t> ProcessAPI::extract_png_from_path(const std::wstring&) {
+  // executables don't carry icons on linux
+  return {};
+}
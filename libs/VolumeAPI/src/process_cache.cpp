@@ -0,0 +1,83 @@
+#include "process_cache.h"
+#include <mutex>
+
+
+/// records of the session processes, refreshed with each snapshot of the sessions
+static ProcessAPI::PathCache shared_cache;
+static std::mutex shared_cache_mutex;
+
+
+const ProcessAPI::PathCache::record_t& ProcessAPI::PathCache::make_record(int pid, uint64_t start_time) {
+  record_t& record = entries_[pid];
+  record = std::make_shared<const VolumeControl::SessionRecord>(pid, start_time);
+  return record;
+}
+
+std::vector<int> ProcessAPI::PathCache::refresh(const std::vector<int>& pids) {
+  return refresh(pids, get_process_snapshot());
+}
+
+std::vector<int> ProcessAPI::PathCache::refresh(const std::vector<int>& pids,
+                                                const std::vector<ProcessKey>& processes) {
+  std::unordered_map<int, uint64_t> running;
+  running.reserve(processes.size());
+  for (const auto& proc : processes) {
+    running.emplace(proc.pid_, proc.start_time_);
+  }
+
+  // forget processes, which are no longer running
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (running.count(it->first)) {
+      ++it;
+    } else {
+      it = entries_.erase(it);
+    }
+  }
+
+  std::vector<int> added;
+  for (const int pid : pids) {
+    const auto proc = running.find(pid);
+    const uint64_t start_time = proc == running.end() ? 0 : proc->second;
+
+    const auto cached = entries_.find(pid);
+    if (cached != entries_.end() && cached->second->start_time() == start_time) {
+      continue;
+    }
+    make_record(pid, start_time);
+    added.push_back(pid);
+  }
+  return added;
+}
+
+ProcessAPI::PathCache::record_t ProcessAPI::PathCache::get(int pid) {
+  const uint64_t start_time = get_start_time_from_pid(pid);
+  const auto cached = entries_.find(pid);
+  if (cached != entries_.end() && cached->second->start_time() == start_time) {
+    return cached->second;
+  }
+  return make_record(pid, start_time);
+}
+
+ProcessAPI::PathCache::record_t ProcessAPI::PathCache::find(int pid) const {
+  const auto cached = entries_.find(pid);
+  return cached == entries_.end() ? nullptr : cached->second;
+}
+
+void ProcessAPI::PathCache::clear() {
+  entries_.clear();
+}
+
+
+std::vector<int> ProcessAPI::refresh_records(const std::vector<int>& pids) {
+  std::lock_guard lock(shared_cache_mutex);
+  return shared_cache.refresh(pids);
+}
+
+ProcessAPI::PathCache::record_t ProcessAPI::get_record(int pid) {
+  std::lock_guard lock(shared_cache_mutex);
+  // the snapshots keep the records current, only a pid they haven't seen queries the process
+  if (auto record = shared_cache.find(pid)) {
+    return record;
+  }
+  return shared_cache.get(pid);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "VolumeAPI/VolumeAPI.h"
+#include "process_api.h"
+
+
+namespace ProcessAPI {
+
+  /// @brief Keeps the session record of each process, keyed by PID and process start time.
+  /// Making a record is cheap, it resolves the path of the executable when the path is first read
+  class PathCache {
+  public:
+    using record_t = std::shared_ptr<const VolumeControl::SessionRecord>;
+
+    /// @brief Check every PID in @p pids against a single process table snapshot.
+    /// Records of exited processes, and of PIDs reused by a new process are dropped.
+    /// @return the PIDs, which got a new record now, because they were new or reused
+    std::vector<int> refresh(const std::vector<int>& pids);
+
+    /// @brief refresh() against the process table @p processes
+    std::vector<int> refresh(const std::vector<int>& pids, const std::vector<ProcessKey>& processes);
+
+    /// @brief Get the record of @p pid, a new one is made when it's missing or stale
+    record_t get(int pid);
+
+    /// @brief Get the record of @p pid as of the last refresh(), without querying the process
+    /// @return nullptr if @p pid is not cached
+    [[nodiscard]] record_t find(int pid) const;
+
+    void clear();
+
+    [[nodiscard]] size_t size() const {
+      return entries_.size();
+    }
+
+  private:
+    const record_t& make_record(int pid, uint64_t start_time);
+
+    std::unordered_map<int, record_t> entries_;
+  };
+
+  /// @brief Refresh the records shared by the audio backend and the icon lookups, see PathCache::refresh()
+  std::vector<int> refresh_records(const std::vector<int>& pids);
+
+  /// @brief Get the shared record of @p pid as of the last refresh_records(), or a new one if there is none
+  [[nodiscard]] PathCache::record_t get_record(int pid);
+
+};  // namespace ProcessAPI
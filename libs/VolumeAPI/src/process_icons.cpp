@@ -0,0 +1,184 @@
+#include "process_api.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include "icon_cache.h"
+#include "icon_prefetcher.h"
+#include "pixel_convert.h"
+#include "process_cache.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+#include "special_icons.h"
+
+
+/// encoded icons of the executables, persisted across runs
+static IconCache icon_cache;
+static std::mutex icon_mutex;  ///< guards icon_cache, icon_stats and prefetched_keys
+
+static VolumeControl::IconStats icon_stats{};
+static std::unordered_set<uint64_t> prefetched_keys;  ///< icons cached by the prefetcher, not yet requested
+static bool prefetch_enabled = true;
+
+
+/// @brief Extract and cache the icon of @p path, if it isn't cached yet
+static void cache_png_from_path(const std::wstring& path, uint64_t key, bool prefetch) {
+  {
+    std::lock_guard lock(icon_mutex);
+    if (icon_cache.find(key)) {
+      return;
+    }
+  }
+
+  auto png = ProcessAPI::extract_png_from_path(path);
+  if (png.empty()) {
+    return;
+  }
+
+  std::lock_guard lock(icon_mutex);
+  icon_cache.put(key, std::move(png));
+  if (prefetch) {
+    prefetched_keys.insert(key);
+  }
+}
+
+static std::unique_ptr<IconPrefetcher> prefetcher;  ///< started by the first prefetch_png()
+static std::once_flag prefetcher_once;
+static std::atomic<bool> prefetcher_started{ false };
+
+/// @brief Get the prefetcher, its threads are started on the first call and not during static initialization
+static IconPrefetcher& start_prefetcher() {
+  std::call_once(prefetcher_once, [] {
+    prefetcher = std::make_unique<IconPrefetcher>(
+        [](const std::wstring& path) {
+          if (const uint64_t key = IconCache::make_key(path)) {
+            cache_png_from_path(path, key, true);
+          }
+        },
+        2, 64);
+    prefetcher_started = true;
+  });
+  return *prefetcher;
+}
+
+
+bool ProcessAPI::open_icon_cache(const std::filesystem::path& file, uint64_t max_bytes) {
+  std::lock_guard lock(icon_mutex);
+  return icon_cache.open(file, max_bytes);
+}
+
+void ProcessAPI::prefetch_png(const std::wstring& path) {
+  {
+    std::lock_guard lock(icon_mutex);
+    if (not prefetch_enabled) {
+      return;
+    }
+  }
+  if (not path.empty()) {
+    start_prefetcher().request(path);
+  }
+}
+
+void ProcessAPI::set_prefetch(bool enable) {
+  std::lock_guard lock(icon_mutex);
+  prefetch_enabled = enable;
+}
+
+VolumeControl::IconStats ProcessAPI::get_icon_stats() {
+  std::lock_guard lock(icon_mutex);
+  return icon_stats;
+}
+
+VolumeControl::IconData ProcessAPI::get_png_from_pid(int pid) {
+  if (pid == -1) {
+    // master icon
+    static const uint32_t hash = PNG::crc32(icon_master.data(), icon_master.size());
+    return { icon_master.data(), icon_master.size(), nullptr, hash };
+  }
+  if (pid == 0) {
+    // system icon
+    static const uint32_t hash = PNG::crc32(icon_system.data(), icon_system.size());
+    return { icon_system.data(), icon_system.size(), nullptr, hash };
+  }
+  // the record of the process instance keeps its icon, later calls don't touch the process or the executable
+  return get_record(pid)->icon();
+}
+
+VolumeControl::IconData ProcessAPI::get_png_from_path(const std::wstring& path) {
+  const uint64_t key = IconCache::make_key(path);
+  if (key == 0) {
+    auto png = extract_png_from_path(path);
+    const uint32_t hash = PNG::crc32(png.data(), png.size());
+    return VolumeControl::IconData(std::move(png), hash);
+  }
+
+  // don't extract the same icon twice, if a worker is already on it
+  if (prefetcher_started) {
+    prefetcher->wait_or_cancel(path);
+  }
+
+  std::unique_lock lock(icon_mutex);
+  ++icon_stats.requests_;
+  auto blob = icon_cache.find(key);
+  if (blob) {
+    if (prefetched_keys.erase(key)) {
+      ++icon_stats.prefetch_hits_;
+    } else {
+      ++icon_stats.cache_hits_;
+    }
+  } else {
+    ++icon_stats.misses_;
+    lock.unlock();
+    cache_png_from_path(path, key, false);
+    lock.lock();
+    blob = icon_cache.find(key);
+  }
+
+  return { blob.data_, blob.size_, std::move(blob.owner_), blob.hash_ };
+}
+
+uint32_t ProcessAPI::find_png_hash(const std::wstring& path) {
+  const uint64_t key = IconCache::make_key(path);
+  if (key == 0) {
+    return 0;
+  }
+  {
+    std::lock_guard lock(icon_mutex);
+    if (const auto blob = icon_cache.find(key)) {
+      return blob.hash_;
+    }
+  }
+  prefetch_png(path);
+  return 0;
+}
+
+VolumeControl::IconData ProcessAPI::get_raw_from_png(const VolumeControl::IconData& png,
+                                                     const VolumeControl::RawIconFormat& format) {
+  std::vector<uint8_t> rgba;
+  uint32_t width = 0, height = 0;
+  if (not PNG::decode(png.data(), png.size(), rgba, width, height)) {
+    return {};
+  }
+  const size_t n_pixels = static_cast<size_t>(format.width_) * format.height_;
+  std::vector<uint8_t> scaled(n_pixels * 4);
+  Pixels::resize(rgba.data(), width, height, scaled.data(), format.width_, format.height_);
+
+  std::vector<uint8_t> out;
+  const bool rgb565 = format.format_ == VolumeControl::PixelFormat::RGB565;
+  if (format.keep_alpha_) {
+    out.resize(n_pixels * (rgb565 ? 3 : 4));
+    if (rgb565) {
+      Pixels::to_rgb565a8(scaled.data(), n_pixels, format.swap_bytes_, out.data());
+    } else {
+      Pixels::to_rgb888a8(scaled.data(), n_pixels, out.data());
+    }
+  } else {
+    out.resize(n_pixels * (rgb565 ? 2 : 3));
+    if (rgb565) {
+      Pixels::blend_rgb565(scaled.data(), n_pixels, format.background_, format.swap_bytes_, out.data());
+    } else {
+      Pixels::blend_rgb888(scaled.data(), n_pixels, format.background_, out.data());
+    }
+  }
+  return VolumeControl::IconData(std::move(out));
+}
@@ -0,0 +1,64 @@
+#include "scan_pool.h"
+#include <algorithm>
+
+
+ScanPool::ScanPool(size_t max_workers) : max_workers_(max_workers) {
+}
+
+ScanPool::~ScanPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto& t : workers_) {
+    t.join();
+  }
+}
+
+void ScanPool::run(size_t n, const job_t& job) {
+  if (n == 0) {
+    return;
+  }
+  std::lock_guard run_lock(run_mutex_);
+  std::unique_lock lock(mutex_);
+  while (workers_.size() < std::min(n - 1, max_workers_)) {
+    workers_.emplace_back(&ScanPool::worker, this);
+  }
+  job_ = &job;
+  next_ = 0;
+  count_ = n;
+  pending_ = n;
+  work_cv_.notify_all();
+
+  while (run_next(lock)) {
+  }
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+  job_ = nullptr;
+}
+
+bool ScanPool::run_next(std::unique_lock<std::mutex>& lock) {
+  if (not job_ || next_ >= count_) {
+    return false;
+  }
+  const size_t i = next_++;
+  const job_t& job = *job_;
+  lock.unlock();
+  job(i);
+  lock.lock();
+  if (--pending_ == 0) {
+    done_cv_.notify_all();
+  }
+  return true;
+}
+
+void ScanPool::worker() {
+  std::unique_lock lock(mutex_);
+  for (;;) {
+    work_cv_.wait(lock, [this] { return stop_ || (job_ && next_ < count_); });
+    if (stop_) {
+      return;
+    }
+    run_next(lock);
+  }
+}
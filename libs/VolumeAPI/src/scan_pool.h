@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/// @brief Worker threads, which run the jobs of one call in parallel, like the scans of the audio devices.
+/// The calling thread takes jobs too, so a single job runs without a thread switch. Workers are started on demand
+/// and kept for later calls. Calls from several threads run one after the other.
+class ScanPool {
+public:
+  using job_t = std::function<void(size_t)>;
+
+  /// @param max_workers most threads started besides the calling one
+  explicit ScanPool(size_t max_workers);
+  ScanPool(const ScanPool&) = delete;
+  ScanPool& operator=(const ScanPool&) = delete;
+  ~ScanPool();
+
+  /// @brief Call @p job with 0 .. @p n - 1, and wait until all calls returned
+  void run(size_t n, const job_t& job);
+
+private:
+  void worker();
+
+  /// @brief Take the next job of the current call and run it, expects mutex_ locked
+  /// @return false if there was none
+  bool run_next(std::unique_lock<std::mutex>& lock);
+
+  const size_t max_workers_;
+  std::mutex run_mutex_;  ///< one call at a time
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  const job_t* job_ = nullptr;  ///< the job of the current call
+  size_t next_ = 0;             ///< next index to run
+  size_t count_ = 0;            ///< indices of the current call
+  size_t pending_ = 0;          ///< calls which didn't return yet
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+};
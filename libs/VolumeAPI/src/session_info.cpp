@@ -0,0 +1,61 @@
+#include "VolumeAPI/VolumeAPI.h"
+#include "process_api.h"
+
+// The parts of the public API, which don't depend on the audio backend
+
+namespace VC = VolumeControl;
+
+
+std::wostream& operator<<(std::wostream& out, const VolumeControl::AudioSessionInfo& audio) {
+  // the hash of a cached icon only, printing a list must not extract every icon
+  out << audio.filename_ << std::wstring(L"\n\tpath: ") << audio.path_ << std::wstring(L"\n\tvolume: ")
+      << std::to_wstring(audio.volume_) << std::wstring(L"\n\tmuted: ") << std::to_wstring(audio.muted_)
+      << std::wstring(L"\n\ticon hash: ") << std::to_wstring(audio.get_icon_hash()) << std::wstring(L"\n\tPID: ")
+      << std::to_wstring(audio.pid_) << std::wstring(L"\n\tendpoint: ") << std::to_wstring(audio.endpoint_);
+
+  return out;
+}
+
+VC::IconData VC::AudioSessionInfo::get_icon_data() const {
+  // the record keeps the icon, printing or hashing the sessions again doesn't fetch it again
+  return record_ ? record_->icon() : ProcessAPI::get_png_from_pid(pid_);
+}
+
+uint32_t VC::AudioSessionInfo::get_icon_hash() const {
+  if (record_) {
+    return record_->icon_hash();
+  }
+  return pid_ <= 0 ? ProcessAPI::get_png_from_pid(pid_).hash() : 0;
+}
+
+VC::IconData VC::AudioSessionInfo::get_icon_raw(const RawIconFormat& format) const {
+  return ProcessAPI::get_raw_from_png(get_icon_data(), format);
+}
+
+std::vector<VC::AudioSessionInfo> VC::get_all_sessions_info() {
+  return get_session_snapshot().infos();
+}
+
+float VC::get_volume(int pid) {
+  return apply({ Operation::get(pid) })[0].volume_;
+}
+
+void VC::set_volume(int pid, float volume) {
+  (void)apply({ Operation::set_volume(pid, volume) });
+}
+
+bool VC::get_muted(int pid) {
+  return apply({ Operation::get(pid) })[0].muted_;
+}
+
+void VC::set_muted(int pid, bool mute) {
+  (void)apply({ Operation::set_muted(pid, mute) });
+}
+
+void VC::set_icon_prefetch(bool enable) {
+  ProcessAPI::set_prefetch(enable);
+}
+
+VC::IconStats VC::get_icon_stats() {
+  return ProcessAPI::get_icon_stats();
+}
@@ -0,0 +1,86 @@
+#include "VolumeAPI/VolumeAPI.h"
+#include <atomic>
+#include <filesystem>
+#include "process_api.h"
+#include "utf8.h"
+
+namespace fs = std::filesystem;
+namespace VC = VolumeControl;
+
+
+static std::atomic<uint32_t> resolved_paths{ 0 };
+static std::atomic<uint32_t> resolved_icons{ 0 };
+
+
+VC::SessionRecord::SessionRecord(int pid, uint64_t start_time) : pid_(pid), start_time_(start_time), fixed_(false) {
+}
+
+VC::SessionRecord::SessionRecord(int pid, std::wstring filename)
+  : pid_(pid), start_time_(0), fixed_(true), filename_(std::move(filename)) {
+  name_utf8_ = UTF8::from_wide(filename_);
+}
+
+VC::SessionRecord::SessionRecord(int pid, std::wstring filename, IconData icon)
+  : SessionRecord(pid, std::move(filename)) {
+  icon_ = std::move(icon);
+}
+
+void VC::SessionRecord::resolve_names() const {
+  std::call_once(names_once_, [this] {
+    if (fixed_) {
+      return;
+    }
+    ++resolved_paths;
+    path_ = ProcessAPI::get_path_from_pid(pid_);
+    filename_ = fs::path(path_).filename().stem().wstring();
+    name_utf8_ = UTF8::from_wide(filename_);
+  });
+}
+
+const std::wstring& VC::SessionRecord::path() const {
+  resolve_names();
+  return path_;
+}
+
+const std::wstring& VC::SessionRecord::filename() const {
+  resolve_names();
+  return filename_;
+}
+
+const std::string& VC::SessionRecord::name_utf8() const {
+  resolve_names();
+  return name_utf8_;
+}
+
+VC::IconData VC::SessionRecord::icon() const {
+  std::call_once(icon_once_, [this] {
+    if (fixed_) {
+      // built-in icons of the master and the system sounds, other fixed records have none or a given one
+      if (pid_ <= 0 && icon_.empty()) {
+        icon_ = ProcessAPI::get_png_from_pid(pid_);
+      }
+      return;
+    }
+    ++resolved_icons;
+    icon_ = ProcessAPI::get_png_from_path(path());
+  });
+  icon_hash_ = icon_.hash();
+  return icon_;
+}
+
+uint32_t VC::SessionRecord::icon_hash() const {
+  if (const uint32_t hash = icon_hash_) {
+    return hash;
+  }
+  if (fixed_) {
+    return icon().hash();
+  }
+  const uint32_t hash = ProcessAPI::find_png_hash(path());
+  icon_hash_ = hash;
+  return hash;
+}
+
+
+VC::ResolveStats VC::get_resolve_stats() {
+  return { resolved_paths.load(), resolved_icons.load() };
+}
@@ -0,0 +1,98 @@
+#include "VolumeAPI/VolumeAPI.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+
+namespace VC = VolumeControl;
+
+
+void VC::SessionSnapshot::Builder::add(int pid, uint8_t endpoint, float volume, bool muted, record_t record) {
+  rows_.push_back({ pid, endpoint, volume, muted, std::move(record) });
+}
+
+void VC::SessionSnapshot::Builder::merge(Builder&& other) {
+  rows_.insert(rows_.end(), std::make_move_iterator(other.rows_.begin()), std::make_move_iterator(other.rows_.end()));
+  other.rows_.clear();
+}
+
+VC::SessionSnapshot VC::SessionSnapshot::Builder::build(const SessionSnapshot& previous) {
+  // the devices are scanned in parallel, the endpoint keeps the order from depending on which finished first
+  std::stable_sort(rows_.begin(), rows_.end(), [](const Row& l, const Row& r) {
+    return l.pid_ != r.pid_ ? l.pid_ < r.pid_ : l.endpoint_ < r.endpoint_;
+  });
+
+  SessionSnapshot ret;
+  const size_t n = rows_.size();
+  ret.pids_.resize(n);
+  ret.endpoints_.resize(n);
+  ret.volumes_.resize(n);
+  ret.muted_.resize(n);
+  ret.generations_.resize(n);
+  auto records = std::make_shared<std::vector<record_t>>(n);
+  for (size_t i = 0; i < n; ++i) {
+    ret.pids_[i] = rows_[i].pid_;
+    ret.endpoints_[i] = rows_[i].endpoint_;
+    ret.volumes_[i] = rows_[i].volume_;
+    ret.muted_[i] = rows_[i].muted_;
+    (*records)[i] = std::move(rows_[i].record_);
+  }
+  ret.records_ = std::move(records);
+
+  // sessions of the previous snapshot are matched in order, both are sorted by pid and endpoint
+  const auto key = [](const SessionSnapshot& snapshot, size_t i) {
+    return std::make_pair(snapshot.pids_[i], snapshot.endpoints_[i]);
+  };
+  const uint64_t next = previous.generation_ + 1;
+  bool changed = n != previous.size() || previous.generation_ == 0;
+  size_t j = 0;
+  for (size_t i = 0; i < n; ++i) {
+    while (j < previous.size() && key(previous, j) < key(ret, i)) {
+      ++j;
+    }
+    if (j < previous.size() && key(previous, j) == key(ret, i) && ret.same_session(i, previous, j)) {
+      ret.generations_[i] = previous.generations_[j++];
+    } else {
+      ret.generations_[i] = next;
+      changed = true;
+    }
+  }
+  ret.generation_ = changed ? next : previous.generation_;
+
+  rows_.clear();
+  return ret;
+}
+
+
+bool VC::SessionSnapshot::same_session(size_t i, const SessionSnapshot& other, size_t j) const {
+  // there is one record per process instance, comparing them doesn't resolve the names
+  return volumes_[i] == other.volumes_[j] && muted_[i] == other.muted_[j] && record(i) == other.record(j);
+}
+
+size_t VC::SessionSnapshot::find(int pid) const {
+  const auto it = std::lower_bound(pids_.begin(), pids_.end(), pid);
+  return it != pids_.end() && *it == pid ? static_cast<size_t>(it - pids_.begin()) : npos;
+}
+
+VC::AudioSessionInfo VC::SessionSnapshot::info(size_t i) const {
+  AudioSessionInfo ret{};
+  const auto& rec = record(i);
+  ret.path_ = rec->path();
+  ret.filename_ = rec->filename();
+  ret.name_utf8_ = rec->name_utf8();
+  ret.pid_ = pids_[i];
+  ret.endpoint_ = endpoints_[i];
+  ret.volume_ = volumes_[i];
+  ret.muted_ = muted_[i];
+  ret.record_ = rec;
+  return ret;
+}
+
+std::vector<VC::AudioSessionInfo> VC::SessionSnapshot::infos() const {
+  std::vector<AudioSessionInfo> ret;
+  ret.reserve(size());
+  for (size_t i = 0; i < size(); ++i) {
+    ret.push_back(info(i));
+  }
+  return ret;
+}
@@ -0,0 +1,303 @@
+#include "VolumeAPI/simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include "meter_samples.h"
+#include "operation_batch.h"
+#include "png_encoder.h"
+#include "scan_pool.h"
+#include "utf8.h"
+
+namespace VC = VolumeControl;
+namespace Sim = VolumeControl::Simulation;
+
+
+namespace {
+
+  /// @brief Meter level generator, with the time it was set
+  struct SimLevel {
+    Sim::level_fn level_;
+    std::chrono::steady_clock::time_point start_;
+
+    [[nodiscard]] float peak(std::chrono::steady_clock::time_point now) const {
+      return level_ ? std::clamp(level_(now - start_), 0.0f, 1.0f) : 0.0f;
+    }
+  };
+
+  struct SimSession {
+    int pid_;
+    float volume_;
+    bool muted_;
+    std::shared_ptr<const VC::SessionRecord> record_;
+    SimLevel level_;
+  };
+
+  struct SimEndpoint {
+    uint8_t id_;
+    std::wstring name_;
+    std::vector<SimSession> sessions_;
+  };
+
+  /// @brief Volume of a simulated session, as OperationBatch uses it
+  class SimVolume {
+  public:
+    explicit SimVolume(SimSession& session) : session_(session) {
+    }
+
+    float volume() const {
+      return session_.volume_;
+    }
+
+    bool muted() const {
+      return session_.muted_;
+    }
+
+    void set_volume(float level) {
+      session_.volume_ = level;
+    }
+
+    void set_muted(bool mute) {
+      session_.muted_ = mute;
+    }
+
+  private:
+    SimSession& session_;
+  };
+
+  /// @brief Wait for @p cost. The audio API mostly waits for the audio service, so the bulk of a long cost is
+  /// slept and other threads run meanwhile. The rest is busy waited, sleeping is far too coarse for it
+  void spend(std::chrono::nanoseconds cost) {
+    constexpr auto max_spin = std::chrono::microseconds(200);
+    if (cost.count() <= 0) {
+      return;
+    }
+    const auto until = std::chrono::steady_clock::now() + cost;
+    if (cost > max_spin) {
+      std::this_thread::sleep_until(until - max_spin);
+    }
+    while (std::chrono::steady_clock::now() < until) {
+    }
+  }
+
+  SimSession make_master() {
+    return { -1, 100, false, std::make_shared<const VC::SessionRecord>(-1, std::wstring(L"Master")), {} };
+  }
+
+  std::vector<SimEndpoint> make_endpoints() {
+    std::vector<SimEndpoint> ret;
+    ret.push_back({ 0, L"Speakers", {} });
+    return ret;
+  }
+
+}  // namespace
+
+
+static std::mutex sim_mutex;  ///< guards the state below
+static std::vector<SimEndpoint> endpoints = make_endpoints();  ///< the default device first
+static SimSession master = make_master();
+static Sim::Costs costs{};
+static uint64_t n_enumerations = 0;
+static VC::SessionSnapshot last_snapshot;
+static ScanPool scan_pool(7);  ///< scans the devices of a snapshot, the caller scans one of them
+
+
+/// @brief Visit the sessions of @p endpoint like the audio API does. If @p callback returns true, it stops
+/// @return the return of the last call of @p callback
+template <class Callback>
+static bool endpoint_enumerate(SimEndpoint& endpoint, Callback& callback) {
+  spend(costs.endpoint_);
+  for (auto& session : endpoint.sessions_) {
+    spend(costs.session_);
+    if (callback(endpoint.id_, session)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @brief Visit the sessions of every device one after the other, the default device first.
+/// If @p callback returns true, the enumeration stops
+template <class Callback>
+static void session_enumerate(Callback callback) {
+  ++n_enumerations;
+  for (auto& endpoint : endpoints) {
+    if (endpoint_enumerate(endpoint, callback)) {
+      break;
+    }
+  }
+}
+
+
+Sim::level_fn Sim::fading(float amplitude, std::chrono::milliseconds period) {
+  const double seconds = std::chrono::duration<double>(period).count();
+  return [amplitude, seconds](std::chrono::nanoseconds t) {
+    const double phase = std::chrono::duration<double>(t).count() / seconds;
+    return static_cast<float>(amplitude * (0.5 - 0.5 * std::cos(2 * 3.14159265358979 * phase)));
+  };
+}
+
+Sim::level_fn Sim::pulses(float amplitude, std::chrono::milliseconds on, std::chrono::milliseconds off) {
+  return [amplitude, on, off](std::chrono::nanoseconds t) { return t % (on + off) < on ? amplitude : 0.0f; };
+}
+
+
+void Sim::reset() {
+  std::lock_guard lock(sim_mutex);
+  endpoints = make_endpoints();
+  master = make_master();
+  costs = {};
+  n_enumerations = 0;
+  // an empty snapshot, the generations keep counting, so caches keyed on them don't mistake a new session for an old
+  last_snapshot = VC::SessionSnapshot::Builder().build(last_snapshot);
+}
+
+void Sim::set_costs(const Costs& new_costs) {
+  std::lock_guard lock(sim_mutex);
+  costs = new_costs;
+}
+
+uint8_t Sim::add_endpoint(std::wstring name) {
+  std::lock_guard lock(sim_mutex);
+  const auto id = static_cast<uint8_t>(endpoints.back().id_ + 1);
+  endpoints.push_back({ id, std::move(name), {} });
+  return id;
+}
+
+void Sim::add_session(int pid, std::wstring name, float volume, bool muted, uint8_t endpoint) {
+  auto record = std::make_shared<const SessionRecord>(pid, std::move(name));
+  std::lock_guard lock(sim_mutex);
+  for (auto& device : endpoints) {
+    if (device.id_ == endpoint) {
+      device.sessions_.push_back({ pid, volume, muted, std::move(record), {} });
+      return;
+    }
+  }
+}
+
+void Sim::remove_sessions(int pid) {
+  std::lock_guard lock(sim_mutex);
+  for (auto& endpoint : endpoints) {
+    auto& sessions = endpoint.sessions_;
+    sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [pid](const auto& s) { return s.pid_ == pid; }),
+                   sessions.end());
+  }
+}
+
+void Sim::set_icon(int pid, std::vector<uint8_t> png) {
+  const uint32_t hash = PNG::crc32(png.data(), png.size());
+  const VC::IconData icon(std::move(png), hash);
+  std::lock_guard lock(sim_mutex);
+  for (auto& endpoint : endpoints) {
+    for (auto& session : endpoint.sessions_) {
+      if (session.pid_ == pid) {
+        session.record_ = std::make_shared<const SessionRecord>(pid, session.record_->filename(), icon);
+      }
+    }
+  }
+}
+
+void Sim::set_level(int pid, level_fn level) {
+  std::lock_guard lock(sim_mutex);
+  const SimLevel generator{ std::move(level), std::chrono::steady_clock::now() };
+  if (pid == -1) {
+    master.level_ = generator;
+  }
+  for (auto& endpoint : endpoints) {
+    for (auto& session : endpoint.sessions_) {
+      if (session.pid_ == pid) {
+        session.level_ = generator;
+      }
+    }
+  }
+}
+
+uint64_t Sim::enumerations() {
+  std::lock_guard lock(sim_mutex);
+  return n_enumerations;
+}
+
+
+bool VC::init() {
+  return true;
+}
+
+VC::SessionSnapshot VC::get_session_snapshot() {
+  std::lock_guard lock(sim_mutex);
+  ++n_enumerations;
+
+  // each device into its own builder, the scans only read the state, which the lock keeps
+  std::vector<SessionSnapshot::Builder> scans(endpoints.size());
+  scan_pool.run(endpoints.size(), [&scans](size_t i) {
+    auto add = [&builder = scans[i]](uint8_t endpoint, const SimSession& session) {
+      builder.add(session.pid_, endpoint, session.volume_, session.muted_, session.record_);
+      return false;
+    };
+    endpoint_enumerate(endpoints[i], add);
+  });
+
+  SessionSnapshot::Builder builder;
+  for (auto& scan : scans) {
+    builder.merge(std::move(scan));
+  }
+  spend(costs.endpoint_);
+  builder.add(-1, endpoints.front().id_, master.volume_, master.muted_, master.record_);
+
+  last_snapshot = builder.build(last_snapshot);
+  return last_snapshot;
+}
+
+VC::SessionSnapshot VC::get_cached_snapshot() {
+  std::lock_guard lock(sim_mutex);
+  return last_snapshot;
+}
+
+std::vector<VC::EndpointInfo> VC::get_endpoints() {
+  std::lock_guard lock(sim_mutex);
+  std::vector<EndpointInfo> ret;
+  for (const auto& endpoint : endpoints) {
+    ret.push_back({ endpoint.id_, endpoint.name_, UTF8::from_wide(endpoint.name_), &endpoint == &endpoints.front() });
+  }
+  return ret;
+}
+
+std::vector<VC::OperationResult> VC::apply(const std::vector<Operation>& ops) {
+  std::lock_guard lock(sim_mutex);
+  OperationBatch batch(ops);
+
+  if (batch.wants(-1)) {
+    spend(costs.endpoint_);
+    SimVolume volume(master);
+    batch.serve(-1, volume);
+  }
+
+  if (not batch.done()) {
+    session_enumerate([&batch](uint8_t, SimSession& session) {
+      if (batch.wants(session.pid_)) {
+        SimVolume volume(session);
+        batch.serve(session.pid_, volume);
+      }
+      return batch.done();
+    });
+  }
+  return batch.take_results();
+}
+
+std::vector<VC::MeterSample> VC::get_meter_samples() {
+  std::lock_guard lock(sim_mutex);
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<MeterSample> samples;
+  float loudest = 0;
+  const uint8_t default_endpoint = endpoints.front().id_;
+  session_enumerate([&](uint8_t endpoint, const SimSession& session) {
+    const float peak = session.level_.peak(now);
+    samples.push_back({ session.pid_, peak });
+    if (endpoint == default_endpoint) {
+      loudest = std::max(loudest, peak);
+    }
+    return false;
+  });
+  spend(costs.endpoint_);
+  samples.push_back({ -1, master.level_.level_ ? master.level_.peak(now) : loudest });
+  return merge_meter_samples(std::move(samples));
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <cstdint>
 
 inline constexpr std::array<uint8_t, 2178> icon_system = {
   0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00,
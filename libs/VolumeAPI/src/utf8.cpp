@@ -0,0 +1,167 @@
+#include "utf8.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define UTF8_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define UTF8_NEON
+#endif
+
+
+namespace {
+
+  constexpr char32_t replacement = 0xFFFD;
+
+  inline size_t put(char32_t cp, char* dst) {
+    if (cp < 0x80) {
+      dst[0] = static_cast<char>(cp);
+      return 1;
+    }
+    if (cp < 0x800) {
+      dst[0] = static_cast<char>(0xC0 | (cp >> 6));
+      dst[1] = static_cast<char>(0x80 | (cp & 0x3F));
+      return 2;
+    }
+    if (cp < 0x10000) {
+      dst[0] = static_cast<char>(0xE0 | (cp >> 12));
+      dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      dst[2] = static_cast<char>(0x80 | (cp & 0x3F));
+      return 3;
+    }
+    dst[0] = static_cast<char>(0xF0 | (cp >> 18));
+    dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    dst[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+  }
+
+  inline bool is_surrogate(char32_t c) {
+    return c >= 0xD800 && c <= 0xDFFF;
+  }
+
+
+  /// @brief Copy the leading ASCII characters of @p src, a vector at a time
+  /// @return characters copied, a multiple of the vector width
+  size_t ascii_run16(const char16_t* src, size_t len, char* dst) {
+    size_t i = 0;
+#if defined(UTF8_SSE2)
+    const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= len; i += 8) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, high), zero)) != 0xFFFF) {
+        break;
+      }
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(v, v));
+    }
+#elif defined(UTF8_NEON)
+    for (; i + 8 <= len; i += 8) {
+      const uint16x8_t v = vld1q_u16(reinterpret_cast<const uint16_t*>(src + i));
+      if (vmaxvq_u16(v) >= 0x80) {
+        break;
+      }
+      vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vmovn_u16(v));
+    }
+#else
+    (void)src;
+    (void)len;
+    (void)dst;
+#endif
+    return i;
+  }
+
+  size_t ascii_run32(const char32_t* src, size_t len, char* dst) {
+    size_t i = 0;
+#if defined(UTF8_SSE2)
+    const __m128i high = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= len; i += 8) {
+      const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(_mm_or_si128(lo, hi), high), zero)) != 0xFFFF) {
+        break;
+      }
+      const __m128i words = _mm_packs_epi32(lo, hi);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+    }
+#elif defined(UTF8_NEON)
+    for (; i + 8 <= len; i += 8) {
+      const uint32x4_t lo = vld1q_u32(reinterpret_cast<const uint32_t*>(src + i));
+      const uint32x4_t hi = vld1q_u32(reinterpret_cast<const uint32_t*>(src + i + 4));
+      if (vmaxvq_u32(vorrq_u32(lo, hi)) >= 0x80) {
+        break;
+      }
+      vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi))));
+    }
+#else
+    (void)src;
+    (void)len;
+    (void)dst;
+#endif
+    return i;
+  }
+
+}  // namespace
+
+
+size_t UTF8::from_utf16(const char16_t* src, size_t len, char* dst) {
+  size_t out = 0;
+  for (size_t i = 0; i < len;) {
+    if (src[i] < 0x80) {
+      const size_t run = ascii_run16(src + i, len - i, dst + out);
+      i += run;
+      out += run;
+      // the tail of the run, or a non-ASCII character within the vector
+      for (; i < len && src[i] < 0x80; ++i) {
+        dst[out++] = static_cast<char>(src[i]);
+      }
+      continue;
+    }
+
+    char32_t cp = src[i++];
+    if (cp >= 0xD800 && cp <= 0xDBFF && i < len && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+      cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i++] - 0xDC00);
+    } else if (is_surrogate(cp)) {
+      cp = replacement;
+    }
+    out += put(cp, dst + out);
+  }
+  return out;
+}
+
+size_t UTF8::from_utf32(const char32_t* src, size_t len, char* dst) {
+  size_t out = 0;
+  for (size_t i = 0; i < len;) {
+    if (src[i] < 0x80) {
+      const size_t run = ascii_run32(src + i, len - i, dst + out);
+      i += run;
+      out += run;
+      for (; i < len && src[i] < 0x80; ++i) {
+        dst[out++] = static_cast<char>(src[i]);
+      }
+      continue;
+    }
+
+    char32_t cp = src[i++];
+    if (is_surrogate(cp) || cp > 0x10FFFF) {
+      cp = replacement;
+    }
+    out += put(cp, dst + out);
+  }
+  return out;
+}
+
+size_t UTF8::from_wide(const wchar_t* src, size_t len, char* dst) {
+  if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+    return from_utf16(reinterpret_cast<const char16_t*>(src), len, dst);
+  } else {
+    return from_utf32(reinterpret_cast<const char32_t*>(src), len, dst);
+  }
+}
+
+std::string UTF8::from_wide(const std::wstring& str) {
+  std::string ret(max_length(str.size()), '\0');
+  ret.resize(from_wide(str.data(), str.size(), ret.data()));
+  return ret;
+}
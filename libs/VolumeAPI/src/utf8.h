@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/// @brief Conversion of wide strings to UTF-8. Runs of ASCII are converted with SSE2 or NEON, depending on the
+/// target, with a scalar fallback. Both 16 bit wchar_t (UTF-16, windows) and 32 bit wchar_t (UTF-32) are handled.
+namespace UTF8 {
+
+  /// @brief most UTF-8 bytes @p len wide characters encode to
+  constexpr size_t max_length(size_t len) {
+    // 3 bytes per UTF-16 unit, a surrogate pair makes 4; 4 bytes per UTF-32 unit
+    return len * (sizeof(wchar_t) == 2 ? 3 : 4);
+  }
+
+  /// @brief Convert UTF-16 to UTF-8. Unpaired surrogates become U+FFFD
+  /// @param dst output, at least 3 * @p len bytes
+  /// @return bytes written
+  size_t from_utf16(const char16_t* src, size_t len, char* dst);
+
+  /// @brief Convert UTF-32 to UTF-8. Surrogates and values beyond U+10FFFF become U+FFFD
+  /// @param dst output, at least 4 * @p len bytes
+  /// @return bytes written
+  size_t from_utf32(const char32_t* src, size_t len, char* dst);
+
+  /// @brief Convert a wide string to UTF-8
+  /// @param dst output, at least max_length(@p len) bytes
+  /// @return bytes written
+  size_t from_wide(const wchar_t* src, size_t len, char* dst);
+
+  std::string from_wide(const std::wstring& str);
+
+}  // namespace UTF8
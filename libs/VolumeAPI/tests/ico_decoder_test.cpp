@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "ico_decoder.h"
+
+// Decodes the .ico files in fixtures/ and compares the pixels:
+// - png.ico: one PNG compressed 3x2 image
+// - bmp32.ico: a 1x1 and a 2x2 32 bpp image with alpha, the 2x2 one has to be picked
+// - mask1.ico: an 8x2 1 bpp image with a black and white palette, the AND mask hides the right half of the top row
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  std::vector<uint8_t> read_fixture(const std::string& name) {
+    std::ifstream file(std::string(FIXTURE_DIR) + "/" + name, std::ios::binary);
+    return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+  }
+
+  /// @brief decode a fixture and compare it with the expected top-down RGBA pixels
+  void check_decode(const std::string& name, uint32_t exp_w, uint32_t exp_h, const std::vector<uint8_t>& expected,
+                    ICO::Alpha alpha) {
+    const std::vector<uint8_t> data = read_fixture(name);
+    check(not data.empty(), name + ": fixture missing");
+
+    std::vector<uint8_t> rgba;
+    uint32_t w = 0, h = 0;
+    const bool ok = ICO::decode(data.data(), data.size(), rgba, w, h, alpha);
+    check(ok, name + ": decode failed");
+    check(w == exp_w && h == exp_h, name + ": wrong size " + std::to_string(w) + "x" + std::to_string(h));
+    check(rgba == expected, name + (alpha == ICO::Alpha::STRAIGHT ? ": wrong pixels" : ": wrong premultiplied pixels"));
+  }
+
+  void test_png() {
+    check_decode("png.ico", 3, 2,
+                 { 255, 0,  0,  255, 0,  255, 0,  128, 0,   0,   255, 0,
+                   10,  20, 30, 255, 40, 50,  60, 200, 255, 255, 255, 255 },
+                 ICO::Alpha::STRAIGHT);
+    check_decode("png.ico", 3, 2,
+                 { 255, 0,  0,  255, 0,  128, 0,  128, 0,   0,   0,   0,
+                   10,  20, 30, 255, 31, 39,  47, 200, 255, 255, 255, 255 },
+                 ICO::Alpha::PREMULTIPLIED);
+  }
+
+  void test_bmp32() {
+    check_decode("bmp32.ico", 2, 2, { 255, 0, 0, 255, 0, 0, 255, 128, 0, 255, 0, 64, 1, 2, 3, 255 },
+                 ICO::Alpha::STRAIGHT);
+    check_decode("bmp32.ico", 2, 2, { 255, 0, 0, 255, 0, 0, 128, 128, 0, 64, 0, 64, 1, 2, 3, 255 },
+                 ICO::Alpha::PREMULTIPLIED);
+  }
+
+  void test_mask() {
+    std::vector<uint8_t> expected;
+    for (uint32_t y = 0; y < 2; ++y) {
+      for (uint32_t x = 0; x < 8; ++x) {
+        const bool white = y == 0 ? x % 2 == 0 : x < 4;
+        const uint8_t c = white ? 255 : 0;
+        const bool transparent = y == 0 && x >= 4;
+        expected.insert(expected.end(), { c, c, c, static_cast<uint8_t>(transparent ? 0 : 255) });
+      }
+    }
+    check_decode("mask1.ico", 8, 2, expected, ICO::Alpha::STRAIGHT);
+
+    for (size_t i = 0; i < expected.size(); i += 4) {
+      if (expected[i + 3] == 0) {
+        expected[i] = expected[i + 1] = expected[i + 2] = 0;
+      }
+    }
+    check_decode("mask1.ico", 8, 2, expected, ICO::Alpha::PREMULTIPLIED);
+  }
+
+  void test_truncated() {
+    for (const char* name : { "png.ico", "bmp32.ico", "mask1.ico" }) {
+      const std::vector<uint8_t> data = read_fixture(name);
+      std::vector<uint8_t> rgba;
+      uint32_t w = 0, h = 0;
+      bool any_ok = false;
+      for (size_t len = 0; len < data.size(); ++len) {
+        // a copy, so reading past the cut shows up in sanitizer builds
+        const std::vector<uint8_t> cut(data.begin(), data.begin() + len);
+        any_ok |= ICO::decode(cut.data(), cut.size(), rgba, w, h);
+      }
+      check(not any_ok, std::string(name) + ": truncated file decoded");
+    }
+  }
+
+}  // namespace
+
+
+int main() {
+  test_png();
+  test_bmp32();
+  test_mask();
+  test_truncated();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
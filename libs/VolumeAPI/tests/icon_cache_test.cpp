@@ -0,0 +1,132 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "icon_cache.h"
+
+// Fills an IconCache in a temporary directory:
+// - icons put in one run are served from the mapping in the next
+// - a full pack stops growing during a run, while a blob of its mapping is held, and is compacted by the next open()
+// - a torn record at the end of the pack is dropped
+
+
+namespace {
+
+  namespace fs = std::filesystem;
+
+  constexpr uint64_t max_bytes = 1024;
+  constexpr size_t icon_size = 200;
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  std::vector<uint8_t> icon(uint64_t key) {
+    return std::vector<uint8_t>(icon_size, static_cast<uint8_t>(key));
+  }
+
+  bool holds(const IconCache::Blob& blob, uint64_t key) {
+    return blob && std::vector<uint8_t>(blob.data_, blob.data_ + blob.size_) == icon(key);
+  }
+
+  fs::path pack_path(const std::string& name) {
+    const fs::path dir = fs::temp_directory_path() / "icon_cache_test";
+    fs::create_directories(dir);
+    fs::remove(dir / name);
+    return dir / name;
+  }
+
+  void test_reopen() {
+    const fs::path file = pack_path("reopen.pack");
+    {
+      IconCache cache;
+      check(cache.open(file, max_bytes), "reopen: open failed");
+      check(holds(cache.put(1, icon(1)), 1), "reopen: put returned the wrong payload");
+      check(holds(cache.find(1), 1), "reopen: fresh icon not found");
+      check(not cache.find(2), "reopen: found a missing icon");
+    }
+    IconCache cache;
+    check(cache.open(file, max_bytes), "reopen: second open failed");
+    check(holds(cache.find(1), 1), "reopen: icon not found in the pack");
+  }
+
+  void test_compact_held() {
+    const fs::path file = pack_path("compact.pack");
+    IconCache cache;
+    check(cache.open(file, max_bytes), "compact: open failed");
+    for (uint64_t key = 1; key <= 4; ++key) {
+      cache.put(key, icon(key));
+    }
+
+    // the blob maps the pack of this open(), the pack is full after a few more icons
+    check(cache.open(file, max_bytes), "compact: reopen failed");
+    const IconCache::Blob held = cache.find(4);
+    check(holds(held, 4), "compact: mapped icon not found");
+    for (uint64_t key = 5; key <= 16; ++key) {
+      cache.put(key, icon(key));
+    }
+    check(fs::file_size(file) <= 2 * max_bytes, "compact: the pack grew past twice the limit");
+    check(cache.is_open(), "compact: the cache closed while a blob is held");
+    check(holds(held, 4), "compact: held blob changed during the run");
+    check(holds(cache.find(16), 16), "compact: newest icon not found");
+
+    // the next open() compacts, the blob still maps the old pack
+    check(cache.open(file, max_bytes), "compact: open with a held blob failed");
+    check(cache.is_open(), "compact: the cache closed after the compaction");
+    check(holds(held, 4), "compact: held blob changed by the compaction");
+    check(fs::file_size(file) <= max_bytes, "compact: the pack wasn't compacted");
+    check(not cache.find(1), "compact: the oldest icon wasn't evicted");
+
+    // the newest icons written during the run survive
+    bool any = false;
+    for (uint64_t key = 5; key <= 16; ++key) {
+      const auto blob = cache.find(key);
+      check(not blob || holds(blob, key), "compact: wrong payload of icon " + std::to_string(key));
+      any |= static_cast<bool>(blob);
+    }
+    check(any, "compact: no icon of the run kept");
+  }
+
+  void test_torn() {
+    const fs::path file = pack_path("torn.pack");
+    {
+      IconCache cache;
+      cache.open(file, max_bytes);
+      cache.put(1, icon(1));
+    }
+    {
+      std::ofstream out(file, std::ios::binary | std::ios::app);
+      out.write("torn", 4);
+    }
+    {
+      IconCache cache;
+      check(cache.open(file, max_bytes), "torn: open failed");
+      check(holds(cache.find(1), 1), "torn: icon before the torn record lost");
+      cache.put(2, icon(2));
+    }
+    IconCache cache;
+    check(cache.open(file, max_bytes), "torn: reopen failed");
+    check(holds(cache.find(2), 2), "torn: icon put after the torn record lost");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_reopen();
+  test_compact_held();
+  test_torn();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "process_cache.h"
+
+// Refreshes a PathCache against hand made process tables:
+// - a process keeps its record while it runs
+// - a pid reused by a new process, with another start time, gets a new record
+// - records of exited processes are dropped
+
+
+namespace {
+
+  using ProcessAPI::PathCache;
+  using ProcessAPI::ProcessKey;
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  void test_reuse() {
+    PathCache cache;
+    auto added = cache.refresh({ 100, 200 }, { { 100, 1000 }, { 200, 2000 }, { 300, 3000 } });
+    check(added == std::vector<int>{ 100, 200 }, "reuse: new processes not added");
+    check(cache.size() == 2, "reuse: a process without a session was cached");
+    const auto first = cache.find(100);
+    check(first && first->start_time() == 1000, "reuse: wrong record");
+
+    added = cache.refresh({ 100, 200 }, { { 100, 1000 }, { 200, 2000 } });
+    check(added.empty(), "reuse: running processes added again");
+    check(cache.find(100) == first, "reuse: record of a running process replaced");
+
+    // pid 100 exited and a new process got its pid
+    added = cache.refresh({ 100, 200 }, { { 100, 5000 }, { 200, 2000 } });
+    check(added == std::vector<int>{ 100 }, "reuse: reused pid not added");
+    const auto second = cache.find(100);
+    check(second && second != first && second->start_time() == 5000, "reuse: reused pid kept the old record");
+    check(first->start_time() == 1000, "reuse: the old record changed");
+  }
+
+  void test_exit() {
+    PathCache cache;
+    (void)cache.refresh({ 100, 200 }, { { 100, 1000 }, { 200, 2000 } });
+    const auto added = cache.refresh({ 100 }, { { 100, 1000 } });
+    check(added.empty(), "exit: running process added again");
+    check(cache.find(200) == nullptr, "exit: record of an exited process kept");
+    check(cache.find(100) != nullptr, "exit: record of a running process dropped");
+
+    // a session of a process the table doesn't know yet, like one started after the table was read
+    (void)cache.refresh({ 400 }, { { 100, 1000 } });
+    const auto unknown = cache.find(400);
+    check(unknown && unknown->start_time() == 0, "exit: session without a process not cached");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_reuse();
+  test_exit();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
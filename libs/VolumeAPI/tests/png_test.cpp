@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "png_decoder.h"
+#include "png_encoder.h"
+
+// Encodes images with PNG::encode and decodes them again with PNG::decode, the pixels have to match exactly:
+// - flat, gradient and noisy images, so every row filter and both Huffman modes are used
+// - sizes from 1x1 to 256x256, including odd widths
+// Also checks the CRC-32 against its reference value, and the zlib stream on its own
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  enum class Pattern { FLAT, GRADIENT, NOISE };
+
+  std::vector<uint8_t> make_image(uint32_t width, uint32_t height, Pattern pattern) {
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    uint32_t seed = 12345;
+    for (uint32_t y = 0; y < height; ++y) {
+      for (uint32_t x = 0; x < width; ++x) {
+        uint8_t* px = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+        switch (pattern) {
+          case Pattern::FLAT:
+            px[0] = 30, px[1] = 144, px[2] = 255, px[3] = 255;
+            break;
+          case Pattern::GRADIENT:
+            px[0] = static_cast<uint8_t>(x * 255 / width);
+            px[1] = static_cast<uint8_t>(y * 255 / height);
+            px[2] = static_cast<uint8_t>(x + y);
+            px[3] = static_cast<uint8_t>(x < width / 2 ? 255 : y * 4);
+            break;
+          case Pattern::NOISE:
+            for (int c = 0; c < 4; ++c) {
+              seed = seed * 1103515245 + 12345;
+              px[c] = static_cast<uint8_t>(seed >> 16);
+            }
+            break;
+        }
+      }
+    }
+    return rgba;
+  }
+
+  void check_round_trip(uint32_t width, uint32_t height, Pattern pattern) {
+    const std::string what = std::to_string(width) + "x" + std::to_string(height) + " pattern " +
+                             std::to_string(static_cast<int>(pattern));
+    const auto rgba = make_image(width, height, pattern);
+    const auto png = PNG::encode(rgba.data(), width, height);
+    check(png.size() > 8, what + ": nothing encoded");
+
+    std::vector<uint8_t> decoded;
+    uint32_t w = 0, h = 0;
+    check(PNG::decode(png.data(), png.size(), decoded, w, h), what + ": decode failed");
+    check(w == width && h == height, what + ": wrong size");
+    check(decoded == rgba, what + ": wrong pixels");
+  }
+
+  void test_round_trip() {
+    for (const Pattern pattern : { Pattern::FLAT, Pattern::GRADIENT, Pattern::NOISE }) {
+      for (const uint32_t size : { 1u, 7u, 16u, 32u, 48u, 256u }) {
+        check_round_trip(size, size, pattern);
+      }
+      check_round_trip(33, 5, pattern);
+    }
+  }
+
+  void test_compression() {
+    // a flat icon compresses far below its raw size
+    const auto flat = make_image(256, 256, Pattern::FLAT);
+    check(PNG::encode(flat.data(), 256, 256).size() < flat.size() / 50, "compression: flat image not compressed");
+
+    const auto noise = make_image(64, 64, Pattern::NOISE);
+    const auto packed = PNG::zlib_compress(noise.data(), noise.size());
+    std::vector<uint8_t> unpacked;
+    check(PNG::zlib_decompress(packed.data(), packed.size(), unpacked) && unpacked == noise,
+          "compression: wrong zlib round trip");
+    check(not PNG::zlib_decompress(packed.data(), packed.size() / 2, unpacked), "compression: truncated stream");
+  }
+
+  void test_crc() {
+    const char reference[] = "123456789";
+    check(PNG::crc32(reference, 9) == 0xCBF43926, "crc: wrong reference value");
+    // continued over two calls
+    check(PNG::crc32(reference + 4, 5, PNG::crc32(reference, 4)) == 0xCBF43926, "crc: wrong continued value");
+  }
+
+  void test_invalid() {
+    const auto rgba = make_image(16, 16, Pattern::GRADIENT);
+    auto png = PNG::encode(rgba.data(), 16, 16);
+    std::vector<uint8_t> decoded;
+    uint32_t w = 0, h = 0;
+    check(not PNG::decode(png.data(), 20, decoded, w, h), "invalid: truncated PNG decoded");
+    png[0] = 0;
+    check(not PNG::decode(png.data(), png.size(), decoded, w, h), "invalid: PNG without signature decoded");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_round_trip();
+  test_compression();
+  test_crc();
+  test_invalid();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <string>
+#include "utf8.h"
+
+// Converts UTF-16 and UTF-32 to UTF-8:
+// - the limits of the 1, 2, 3 and 4 byte sequences
+// - surrogate pairs, and unpaired or reversed surrogates, which become U+FFFD
+// - UTF-32 surrogates and values beyond U+10FFFF, which become U+FFFD
+// - a non-ASCII character at each position of ASCII runs, around the vector width of the fast path
+
+
+namespace {
+
+  int failures = 0;
+
+  void check(bool ok, const std::string& what) {
+    if (not ok) {
+      std::printf("FAILED: %s\n", what.c_str());
+      ++failures;
+    }
+  }
+
+  const std::string replacement = "\xEF\xBF\xBD";
+
+  std::string convert(const std::u16string& str) {
+    std::string out(3 * str.size(), '\0');
+    out.resize(UTF8::from_utf16(str.data(), str.size(), out.data()));
+    return out;
+  }
+
+  std::string convert(const std::u32string& str) {
+    std::string out(4 * str.size(), '\0');
+    out.resize(UTF8::from_utf32(str.data(), str.size(), out.data()));
+    return out;
+  }
+
+  void test_lengths() {
+    check(convert(std::u16string{ 0x7F }) == "\x7F", "utf16: U+007F");
+    check(convert(std::u16string{ 0x80 }) == "\xC2\x80", "utf16: U+0080");
+    check(convert(std::u16string{ 0x7FF }) == "\xDF\xBF", "utf16: U+07FF");
+    check(convert(std::u16string{ 0x800 }) == "\xE0\xA0\x80", "utf16: U+0800");
+    check(convert(std::u16string{ 0xFFFF }) == "\xEF\xBF\xBF", "utf16: U+FFFF");
+    check(convert(std::u16string{ 0xD800, 0xDC00 }) == "\xF0\x90\x80\x80", "utf16: U+10000");
+    check(convert(std::u16string{ 0xD83D, 0xDE00 }) == "\xF0\x9F\x98\x80", "utf16: U+1F600");
+    check(convert(std::u16string{ 0xDBFF, 0xDFFF }) == "\xF4\x8F\xBF\xBF", "utf16: U+10FFFF");
+
+    check(convert(std::u32string{ 0x80 }) == "\xC2\x80", "utf32: U+0080");
+    check(convert(std::u32string{ 0xFFFF }) == "\xEF\xBF\xBF", "utf32: U+FFFF");
+    check(convert(std::u32string{ 0x1F600 }) == "\xF0\x9F\x98\x80", "utf32: U+1F600");
+    check(convert(std::u32string{ 0x10FFFF }) == "\xF4\x8F\xBF\xBF", "utf32: U+10FFFF");
+  }
+
+  void test_surrogates() {
+    check(convert(std::u16string{ 0xD800 }) == replacement, "utf16: high surrogate at the end");
+    check(convert(std::u16string{ 0xD800, 'a' }) == replacement + "a", "utf16: high surrogate before ASCII");
+    check(convert(std::u16string{ 0xD800, 0xD800, 0xDC00 }) == replacement + "\xF0\x90\x80\x80",
+          "utf16: high surrogate before a pair");
+    check(convert(std::u16string{ 0xDC00, 'a' }) == replacement + "a", "utf16: low surrogate");
+    check(convert(std::u16string{ 0xDC00, 0xD800 }) == replacement + replacement, "utf16: reversed pair");
+    check(convert(std::u16string{ 0xD800, 0xE000 }) == replacement + "\xEE\x80\x80",
+          "utf16: high surrogate before U+E000");
+  }
+
+  void test_invalid_utf32() {
+    check(convert(std::u32string{ 0xD800 }) == replacement, "utf32: high surrogate");
+    check(convert(std::u32string{ 0xDFFF }) == replacement, "utf32: low surrogate");
+    check(convert(std::u32string{ 0xD83D, 0xDE00 }) == replacement + replacement, "utf32: surrogate pair");
+    check(convert(std::u32string{ 0x110000 }) == replacement, "utf32: U+110000");
+    check(convert(std::u32string{ 0xFFFFFFFF, 'a' }) == replacement + "a", "utf32: 0xFFFFFFFF");
+  }
+
+  void test_ascii_runs() {
+    for (size_t len = 0; len < 40; ++len) {
+      std::string ascii;
+      for (size_t i = 0; i < len; ++i) {
+        ascii += static_cast<char>(i % 2 ? 0x7F : 'a' + i % 26);
+      }
+      const std::u16string ascii16(ascii.begin(), ascii.end());
+      const std::u32string ascii32(ascii.begin(), ascii.end());
+      const std::string what = " in an ASCII run of " + std::to_string(len);
+      check(convert(ascii16) == ascii, "utf16: ASCII run of " + std::to_string(len));
+      check(convert(ascii32) == ascii, "utf32: ASCII run of " + std::to_string(len));
+
+      for (size_t at = 0; at <= len; ++at) {
+        const std::string expected = ascii.substr(0, at) + "\xC2\x80" + ascii.substr(at);
+        auto str16 = ascii16;
+        str16.insert(at, 1, 0x80);
+        check(convert(str16) == expected, "utf16: U+0080 at " + std::to_string(at) + what);
+        auto str32 = ascii32;
+        str32.insert(at, 1, 0x80);
+        check(convert(str32) == expected, "utf32: U+0080 at " + std::to_string(at) + what);
+      }
+    }
+  }
+
+  void test_wide() {
+    check(UTF8::from_wide(L"caf\u00E9 \u20AC") == "caf\xC3\xA9 \xE2\x82\xAC", "wide: BMP string");
+    check(UTF8::from_wide(L"\U0001F600!") == "\xF0\x9F\x98\x80!", "wide: emoji");
+    check(UTF8::from_wide(std::wstring()).empty(), "wide: empty string");
+  }
+
+}  // namespace
+
+
+int main() {
+  test_lengths();
+  test_surrogates();
+  test_invalid_utf32();
+  test_ascii_runs();
+  test_wide();
+
+  if (failures) {
+    std::printf("%d checks failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}